@@ -117,10 +117,11 @@ class PHTTPSpace : public PContainer
     void EndRead() const
       { mutex->EndRead(); }
 
-    /** This function attempts to acquire the mutex for writing.
+    /** This function attempts to acquire the mutex for writing. If the name
+        space was moved from, it first gets its own contents to write to.
      */
     void StartWrite() const
-      { mutex->StartWrite(); }
+      { const_cast<PHTTPSpace *>(this)->MakeWritable(); mutex->StartWrite(); }
 
     /** This function attempts to release the mutex for writing.
      */
@@ -210,6 +211,7 @@ class PHTTP : public PInternetProtocol
       Gone,                        ///< 410 - resource gone away
       LengthRequired,              ///< 411 - no Content-Length
       UnlessTrue,                  ///< 412 - no Range header for true Unless
+      RequestedRangeNotSatisfiable = 416, ///< 416 - Range header outside of resource
       InternalServerError = 500,   ///< 500 - server has encountered an unexpected error
       NotImplemented,              ///< 501 - server does not implement request
       BadGateway,                  ///< 502 - error whilst acting as gateway
@@ -253,6 +255,10 @@ class PHTTP : public PInternetProtocol
     static const PCaselessString & ForwardedTag();
     static const PCaselessString & SetCookieTag();
     static const PCaselessString & CookieTag();
+    static const PCaselessString & RangeTag();
+    static const PCaselessString & IfRangeTag();
+    static const PCaselessString & ContentRangeTag();
+    static const PCaselessString & AcceptRangesTag();
 
   protected:
     /** Create a TCP/IP HTTP protocol channel.
@@ -475,11 +481,38 @@ class PHTTPClient : public PHTTP
 
 
   // New functions for class.
-    /// Connect at transport level to remote, based on URL
+    /** Connect at transport level to remote, based on URL.
+        If persistent mode is on, an idle connection to the same scheme, host
+        and port is taken from the process wide connection pool in preference
+        to making a new connection.
+      */
     bool ConnectURL(
       const PURL & url
     );
 
+    /** Release the transport connection.
+        If the last response was completely read and the server allows
+        keep-alive, the connection is returned to the process wide connection
+        pool for use by any PHTTPClient, otherwise it is closed. This is done
+        automatically on destruction, and when ConnectURL() is used for a
+        different host.
+      */
+    void ReleaseConnection();
+
+    /** Set the limits for the process wide connection pool.
+        At most \p maxPerHost idle connections are kept for each scheme, host
+        and port, and any connection idle for longer than \p idleTimeout is
+        closed rather than reused. A \p maxPerHost of zero disables pooling.
+        The defaults are 8 connections and 15 seconds.
+      */
+    static void SetConnectionPoolLimits(
+      unsigned maxPerHost,
+      const PTimeInterval & idleTimeout
+    );
+
+    /// Close all idle connections in the process wide connection pool.
+    static void ClearConnectionPool();
+
     /// Call back to process the body of the HTTP command
     typedef PHTTPContentProcessor ContentProcessor;
 
@@ -754,6 +787,13 @@ class PHTTPClient : public PHTTP
     PString m_privateKey;   // File or data
 #endif
     PHTTPClientAuthentication * m_authentication;
+
+    PString m_connectionKey;  // Pool key for current connection, empty if not from URL
+    bool    m_connectionIdle; // Last response fully read and connection reusable
+
+  private:
+    bool InternalReadContentBody(PMIMEInfo & replyMIME, ContentProcessor & processor);
+    void SetConnectionIdle(const PMIMEInfo & replyMIME);
 };
 
 
@@ -766,6 +806,12 @@ class PHTTPClient : public PHTTP
     framing rules.
     
     Note the WebSocket handshake is assumed to have already occurred.
+
+    Reads from the underlying channel are buffered, so frames may be held in
+    this object after the socket itself has nothing left to read. A caller
+    that waits for the socket to be readable, e.g. with PSocket::Select() or
+    PSocketReactor, must keep reading until HasBufferedData() is false before
+    waiting again.
 */
 
 class PWebSocket : public PIndirectChannel
@@ -813,13 +859,44 @@ class PWebSocket : public PIndirectChannel
     );
 
 
-    /// Read a complete WebSocket message
+    /** Read a complete WebSocket message.
+        The buffer grows as the payload arrives, not by the length the peer
+        claims. If the message is larger than GetMaxMessageSize(), false is
+        returned with the BufferTooSmall error, the rest of the message is not
+        read and the WebSocket should be closed.
+      */
     virtual bool ReadMessage(
       PBYTEArray & msg
     );
 
+    /** Read a complete WebSocket message into a caller supplied buffer.
+        The payload is read and unmasked in place, with no intermediate copy.
+        If the message is larger than \p size, false is returned with the
+        BufferTooSmall error, \p length is set to \p size, and the remainder
+        of the message may be obtained with Read().
+      */
+    virtual bool ReadMessage(
+      void * buffer,    ///< Buffer to receive message
+      PINDEX size,      ///< Size of buffer
+      PINDEX & length   ///< Length of message read
+    );
+
+    /// Set the largest message ReadMessage() will accept into a PBYTEArray.
+    void SetMaxMessageSize(
+      PINDEX size
+    ) { m_maxMessageSize = size; }
+
+    /// Get the largest message ReadMessage() will accept into a PBYTEArray.
+    PINDEX GetMaxMessageSize() const { return m_maxMessageSize; }
+
     /// Indicate the last Read() completed the WebSocket message.
-    bool IsMessageComplete() const { return m_fragmentedRead && m_remainingPayload == 0; }
+    bool IsMessageComplete() const { return !m_fragmentedRead && m_remainingPayload == 0; }
+
+    /** Indicate data has been read from the underlying channel and not yet
+        returned by Read() or ReadMessage(). This data does not make the
+        socket readable, so it must be drained before waiting on the socket.
+      */
+    virtual bool HasBufferedData() const { return m_readAheadPos < m_readAheadLen || PIndirectChannel::HasBufferedData(); }
 
     /** Indicate Write() calls are fragments of a large or indeterminate
         message. The user should call SetFragmenting(false) before sending
@@ -868,9 +945,14 @@ class PWebSocket : public PIndirectChannel
     );
 
     bool WriteMasked(
-      const uint32_t * data,
+      const BYTE * data,
       PINDEX len,
-      uint32_t mask
+      uint32_t & mask
+    );
+
+    bool ReadBuffered(
+      void * buf,
+      PINDEX len
     );
 
     bool     m_client;
@@ -880,8 +962,13 @@ class PWebSocket : public PIndirectChannel
     uint64_t m_remainingPayload;
     int64_t  m_currentMask;
     bool     m_fragmentedRead;
+    PINDEX   m_maxMessageSize;
 
     bool     m_recursiveRead;
+
+    BYTE     m_readAhead[4096];
+    PINDEX   m_readAheadPos;
+    PINDEX   m_readAheadLen;
 };
 
 #endif // P_SSL
@@ -1933,6 +2020,41 @@ class PHTTPString : public PHTTPResource
 };
 
 
+//////////////////////////////////////////////////////////////////////////////
+// PHTTPHistogramResource
+
+/** This object describes a HyperText Transport Protocol resource which
+   reports the percentiles of the latency histograms registered with
+   <code>PProfiling::GetHistogram()</code>. A "reset" query parameter clears
+   the histograms after they have been reported.
+ */
+class PHTTPHistogramResource : public PHTTPString
+{
+  PCLASSINFO(PHTTPHistogramResource, PHTTPString)
+
+  public:
+    /** Contruct a new histogram resource for the HTTP space.
+     */
+    PHTTPHistogramResource(
+      const PURL & url             // Name of the resource in URL space.
+    );
+    PHTTPHistogramResource(
+      const PURL & url,            // Name of the resource in URL space.
+      const PHTTPAuthority & auth  // Authorisation for the resource.
+    );
+
+  // Overrides from class PHTTPString
+    /** Get the current histogram percentiles as a HTML table.
+
+       @return
+       String for loaded text.
+     */
+    virtual PString LoadText(
+      PHTTPRequest & request    // Information on this request.
+    );
+};
+
+
 //////////////////////////////////////////////////////////////////////////////
 // PHTTPFile
 
@@ -2005,6 +2127,20 @@ class PHTTPFile : public PHTTPResource
       PHTTPRequest & request    // Information on this request.
     );
 
+    /**Send the data associated with a command.
+
+       Files that are not text are sent directly from the file to the
+       socket, using the operating system zero copy mechanism if the server
+       is a plain TCP socket, or in blocks if not, e.g. over SSL. A single
+       "Range" in the request is honoured for these files.
+
+       Text files are passed through <code>LoadText()</code> and
+       <code>OnLoadedText()</code> as usual, so they may be altered.
+    */
+    virtual void SendData(
+      PHTTPRequest & request    // information for this request
+    );
+
     /** Get a block of data that the resource contains.
 
        @return
@@ -2035,6 +2171,11 @@ class PHTTPFile : public PHTTPResource
     );
     // Constructor used by PHTTPDirectory
 
+    // Set up streaming and any Range for the open file, called by LoadHeaders()
+    bool LoadFileHeaders(
+      PHTTPRequest & request
+    );
+
 
     PFilePath filePath;
 };
@@ -2053,6 +2194,9 @@ class PHTTPFileRequest : public PHTTPRequest
     );
 
     PFile file;
+    bool  m_streamFile; ///< File is sent directly rather than via LoadData()
+    off_t m_offset;     ///< Position in file to start sending
+    off_t m_length;     ///< Number of bytes of file to send
 };
 
 
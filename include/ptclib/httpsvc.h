@@ -37,6 +37,7 @@
 #include <ptlib/sockets.h>
 #include <ptclib/httpform.h>
 #include <ptclib/cypher.h>
+#include <ptclib/threadpool.h>
 
 
 class PHTTPServiceProcess;
@@ -119,6 +120,7 @@ class PHTTPServiceProcess : public PServiceProcess
     static const PString & GetDefaultSection();
 
     class ClearLogPage;
+    class MemoryUsagePage;
 
     struct Params
     {
@@ -154,6 +156,10 @@ class PHTTPServiceProcess : public PServiceProcess
       ClearLogPage  * m_clearLogPage;   // Output
       PHTTPTailFile * m_tailLogPage;    // Output
 
+      // Diagnostics, set m_memoryUsagePageName, e.g. "MemoryUsage", to add the page
+      const char      * m_memoryUsagePageName;
+      MemoryUsagePage * m_memoryUsagePage; // Output
+
       // HTTP access
       const char *  m_httpPortKey;
       const char *  m_httpInterfacesKey;
@@ -181,6 +187,49 @@ class PHTTPServiceProcess : public PServiceProcess
       PINDEX stackSize = 0x4000
     );
 
+    /**Set the HTTP connections to be serviced by a pool of worker threads.
+       By default each connection is given its own thread for its lifetime.
+       When \p maxWorkers is non-zero, connections are instead monitored by
+       a PSocketReactor and only those with a request ready to be read are
+       queued to a thread pool of at most \p maxWorkers threads. The server
+       for a new connection, see CreateHTTPServer(), is also created by a
+       worker, as it may block, e.g. for a TLS handshake.
+
+       If \p maxInFlight is non-zero, no more than that many requests are
+       queued or executing at once, further ready connections wait until
+       one completes.
+
+       Connections that have not sent a request for \p idleTimeout are
+       closed, and it is also the read timeout for new connections, bounding
+       how long a worker waits on, e.g., a TLS handshake.
+
+       This must be called before ListenForHTTP().
+      */
+    void SetHTTPThreadPool(
+      unsigned maxWorkers,
+      unsigned maxInFlight = 0,
+      const PTimeInterval & idleTimeout = PTimeInterval(0, 30)
+    );
+
+    /// Statistics for HTTP thread pool, see SetHTTPThreadPool()
+    struct HTTPPoolStatistics
+    {
+      HTTPPoolStatistics();
+
+      unsigned      m_connections;        ///< Currently open connections
+      unsigned      m_inFlight;           ///< Requests queued or executing
+      unsigned      m_deferred;           ///< Ready connections waiting on maxInFlight
+      uint64_t      m_requests;           ///< Total ready connections dispatched to workers
+      PTimeInterval m_totalQueueLatency;  ///< Total time from ready to start of processing
+      PTimeInterval m_maxQueueLatency;    ///< Maximum time from ready to start of processing
+
+      /// Average time from ready to start of processing
+      PTimeInterval GetAverageQueueLatency() const;
+    };
+
+    /// Get statistics for HTTP thread pool.
+    HTTPPoolStatistics GetHTTPPoolStatistics() const;
+
     virtual PString GetPageGraphic();
     void GetPageHeader(PHTML &);
     void GetPageHeader(PHTML &, const PString & title);
@@ -243,6 +292,48 @@ class PHTTPServiceProcess : public PServiceProcess
     ThreadList m_httpThreads;
     PMutex     m_httpThreadsMutex;
 
+    struct HTTPConnection
+    {
+      HTTPConnection(PTCPSocket * socket, PHTTPServer * server);
+      ~HTTPConnection();
+
+      PTCPSocket  * m_socket;
+      PHTTPServer * m_server;     // NULL until created by a worker
+      PTimeInterval m_lastActivity;
+      bool          m_waiting;    // Registered in reactor, waiting for next request
+      bool          m_idleClosed; // Shut down by OnHTTPIdleCheck()
+    };
+
+    struct HTTPWork
+    {
+      HTTPWork(PHTTPServiceProcess & process, HTTPConnection * connection)
+        : m_process(process), m_connection(connection), m_readyTime(PTimer::Tick()) { }
+      void Work() { m_process.ProcessHTTPWork(*m_connection, m_readyTime); }
+
+      PHTTPServiceProcess & m_process;
+      HTTPConnection      * m_connection;
+      PTimeInterval         m_readyTime;
+    };
+
+    void StartHTTPThreadPool();
+    void StopHTTPThreadPool();
+    void QueueHTTPWork(HTTPConnection * connection);
+    void ProcessHTTPWork(HTTPConnection & connection, const PTimeInterval & readyTime);
+    PDECLARE_SocketReactorNotifier(PHTTPServiceProcess, OnHTTPReadable);
+    PDECLARE_NOTIFIER(PTimer, PHTTPServiceProcess, OnHTTPIdleCheck);
+
+    unsigned                      m_httpMaxWorkers;
+    unsigned                      m_httpMaxInFlight;
+    PTimeInterval                 m_httpIdleTimeout;
+    PSocketReactor              * m_httpReactor;
+    PQueuedThreadPool<HTTPWork> * m_httpThreadPool;
+    typedef std::map<PSocket *, HTTPConnection *> HTTPConnectionMap;
+    HTTPConnectionMap             m_httpConnections;
+    std::list<HTTPConnection *>   m_httpDeferred;
+    HTTPPoolStatistics            m_httpStatistics;
+    PTimer                        m_httpIdleTimer;
+    mutable PMutex                m_httpPoolMutex;
+
   friend class PConfigPage;
   friend class PConfigSectionsPage;
   friend class PHTTPServiceThread;
@@ -553,6 +644,24 @@ class PHTTPServiceProcess::ClearLogPage : public PServiceHTTPString
 };
 
 
+/**Page showing memory usage by class, see PMemoryUsage.
+   The "max" query parameter limits the number of classes shown.
+  */
+class PHTTPServiceProcess::MemoryUsagePage : public PServiceHTTPString
+{
+    PCLASSINFO(MemoryUsagePage, PServiceHTTPString);
+  public:
+    MemoryUsagePage(PHTTPServiceProcess & process, const PURL & url, const PHTTPAuthority & auth);
+
+    virtual PString LoadText(
+      PHTTPRequest & request    // Information on this request.
+      );
+
+  protected:
+    PHTTPServiceProcess & m_process;
+};
+
+
 #endif // P_HTTPFORMS
 
 #endif // PTLIB_HTTPSVC_H
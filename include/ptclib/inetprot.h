@@ -102,6 +102,12 @@ class PInternetProtocol : public PIndirectChannel
      */
     virtual int ReadChar();
 
+    /** Indicate data is held for reading.
+       This override includes characters read ahead, or "put back" with
+       <A>UnRead()</A>, as well as any held by the read channel.
+     */
+    virtual bool HasBufferedData() const;
+
     /** Low level write to the channel.
 
        This override assures that the sequence CR/LF/./CR/LF does not occur by
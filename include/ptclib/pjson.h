@@ -66,6 +66,7 @@ class PJSON : public PObject
     class Object : public Base, public std::map<PString, Base *>
     {
       public:
+        explicit Object(PArena * arena = NULL) : m_arena(arena) { }
         ~Object();
         virtual bool IsType(Types type) const;
         virtual void ReadFrom(istream & strm);
@@ -90,11 +91,15 @@ class PJSON : public PObject
         bool SetString(const PString & name, const PString & value);
         bool SetNumber(const PString & name, double value);
         bool SetBoolean(const PString & name, bool value);
+
+      protected:
+        PArena * m_arena;
     };
 
     class Array : public Base, public std::vector<Base *>
     {
       public:
+        explicit Array(PArena * arena = NULL) : m_arena(arena) { }
         ~Array();
         virtual bool IsType(Types type) const;
         virtual void ReadFrom(istream & strm);
@@ -118,6 +123,9 @@ class PJSON : public PObject
         void AppendString(const PString & value);
         void AppendNumber(double value);
         void AppendBoolean(bool value);
+
+      protected:
+        PArena * m_arena;
     };
 
     class String : public Base, public PString
@@ -166,12 +174,16 @@ class PJSON : public PObject
         virtual void PrintOn(ostream & strm) const;
     };
 
-    ///< Constructor
-    PJSON();
-    explicit PJSON(Types type);
-    explicit PJSON(const PString & str);
+    /**Constructor.
+       If an arena is provided, all values in the tree are allocated from it,
+       and it must outlive this object. Destroying the tree then only runs
+       the destructors, the memory is recovered by PArena::Release().
+      */
+    explicit PJSON(PArena * arena = NULL);
+    explicit PJSON(Types type, PArena * arena = NULL);
+    explicit PJSON(const PString & str, PArena * arena = NULL);
 
-    ~PJSON() { delete m_root; }
+    ~PJSON();
 
     virtual void ReadFrom(istream & strm);
     virtual void PrintOn(ostream & strm) const;
@@ -192,8 +204,9 @@ class PJSON : public PObject
     Boolean & GetBoolean() const { return GetAs<Boolean>(); }
 
   protected:
-    Base * m_root;
-    bool   m_valid;
+    PArena * m_arena;
+    Base   * m_root;
+    bool     m_valid;
 };
 
 
@@ -247,6 +247,17 @@ class PMonitoredSockets : public PSafeObject
     /// Return the local port number being used by the socket(s)
     WORD GetPort() const { return m_localPort; }
 
+    /** Set the number of datagrams ReadFromBundle() takes from a socket in
+        one system call, see PIPDatagramSocket::ReadFromMulti(). Datagrams
+        beyond the first are queued and returned by subsequent reads without
+        going back to the operating system. A value of one, the default,
+        disables the queue.
+      */
+    void SetReadBatchSize(unsigned size) { m_readBatchSize = PMAX(size, 1U); }
+
+    /// Get the number of datagrams ReadFromBundle() takes in one system call.
+    unsigned GetReadBatchSize() const { return m_readBatchSize; }
+
     /// Get the local address for the given interface.
     virtual PBoolean GetAddress(
       const PString & iface,        ///< Interface to get address for
@@ -340,6 +351,18 @@ class PMonitoredSockets : public PSafeObject
     );
 
   protected:
+    // Datagrams read from a socket in one system call, not yet returned
+    struct ReadBatch {
+      ReadBatch()
+        : m_count(0)
+        , m_index(0)
+      { }
+
+      PIPDatagramSocket::Datagrams m_datagrams;
+      PINDEX                       m_count;
+      PINDEX                       m_index;
+    };
+
     struct SocketInfo {
       SocketInfo()
         : socket(NULL)
@@ -350,6 +373,7 @@ class PMonitoredSockets : public PSafeObject
 
       PUDPSocket * socket;
       bool         inUse;
+      ReadBatch    readBatch;
     };
     friend struct SocketInfo;
 
@@ -367,7 +391,16 @@ class PMonitoredSockets : public PSafeObject
 
     void ReadFromSocketList(
       PSocket::SelectList & readers,
-      PUDPSocket * & socket,
+      SocketInfo & info,
+      BundleParams & param
+    );
+    bool ReadFromBatch(
+      ReadBatch & batch,
+      BundleParams & param
+    );
+    void ReadFromSocket(
+      PUDPSocket * socket,
+      ReadBatch * batch,
       BundleParams & param
     );
 
@@ -379,6 +412,8 @@ class PMonitoredSockets : public PSafeObject
 
     bool          m_opened;
     PUDPSocket    m_interfaceAddedSignal;
+
+    unsigned      m_readBatchSize;
 };
 
 typedef PSafePtr<PMonitoredSockets> PMonitoredSocketsPtr;
@@ -583,13 +618,23 @@ class PMonitoredSocketBundle : public PMonitoredSockets
     PInterfaceMonitor::Notifier m_onInterfaceChange;
 
     typedef std::map<std::string, SocketInfo> SocketInfoMap_T;
+    typedef std::map<PUDPSocket *, SocketInfoMap_T::iterator> SocketLookup_T;
 
     void OpenSocket(const PString & iface);
     void CloseSocket(SocketInfoMap_T::iterator iterSocket);
+    void ReadFromReactor(PUDPSocket * & socket, BundleParams & param);
 
     SocketInfoMap_T m_socketInfoMap;
     PCaselessString m_fixedInterface;
     unsigned        m_ipVersion;
+
+    /* All interface sockets stay registered with the reactor between reads,
+       it is only changed when interfaces come and go. */
+    PSocketReactor  m_readReactor;
+    SocketLookup_T  m_socketLookup;
+    unsigned        m_socketGeneration; // Incremented when a socket is opened or closed
+    bool            m_readingAll;
+    unsigned        m_readingInterface;
 };
 
 
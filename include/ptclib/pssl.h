@@ -40,6 +40,7 @@
 
 struct ssl_st;
 struct ssl_ctx_st;
+struct ssl_session_st;
 struct x509_st;
 struct X509_name_st;
 struct evp_pkey_st;
@@ -809,13 +810,48 @@ class PSSLContext : public PObject
 
     Method GetMethod() const { return m_method; }
 
+    /**Set the maximum number of sessions kept for client connections.
+       When a PSSLChannel connects to a server it has connected to before
+       using this context, the previous session (or session ticket) is
+       offered so the server may resume it, avoiding a full handshake.
+       Sessions are identified by PSSLChannel::SetSessionKey(), a channel
+       without a key never resumes a session. A size of zero disables
+       client session resumption. Default is 128.
+      */
+    void SetClientSessionCacheSize(
+      PINDEX size   ///< Maximum number of sessions to cache
+    );
+
+    /**Remove all cached client sessions.
+      */
+    void ClearClientSessionCache();
+
+    /// Get number of client connections that resumed a cached session.
+    unsigned GetClientSessionHits() const { return m_clientSessionHits; }
+
+    /// Get number of client connections that needed a full handshake.
+    unsigned GetClientSessionMisses() const { return m_clientSessionMisses; }
+
   protected:
     void Construct(const void * sessionId, PINDEX idSize);
 
+    bool SetClientSession(ssl_st * ssl, const PString & key);
+    void OnClientSessionResult(ssl_st * ssl, const PString & key, bool connected);
+    static int NewSessionCallback(ssl_st * ssl, ssl_session_st * session);
+
     Method       m_method;
     ssl_ctx_st * m_context;
     PSSLPasswordNotifier m_passwordNotifier;
 
+    typedef std::map<PString, ssl_session_st *> ClientSessionMap;
+    ClientSessionMap   m_clientSessions;
+    PINDEX             m_clientSessionCacheSize;
+    PCriticalSection   m_clientSessionMutex;
+    PAtomicInteger     m_clientSessionHits;
+    PAtomicInteger     m_clientSessionMisses;
+
+  friend class PSSLChannel;
+
   private:
     PSSLContext(const PSSLContext &) { }
     void operator=(const PSSLContext &) { }
@@ -851,6 +887,9 @@ class PSSLChannel : public PIndirectChannel
     virtual PString GetErrorText(ErrorGroup group = NumErrorGroups) const;
     virtual PBoolean ConvertOSError(P_INT_PTR libcReturnValue, ErrorGroup group = LastGeneralError);
 
+    // Overrides from PIndirectChannel
+    virtual bool HasBufferedData() const;
+
     // New functions
     /**Accept a new inbound connection (server).
        This version expects that the indirect channel has already been opened
@@ -956,6 +995,22 @@ class PSSLChannel : public PIndirectChannel
 
     PSSLContext * GetContext() const { return m_context; }
 
+    /**Set the key used to find a cached session when connecting.
+       This is typically "host:port" for the server, using the name the
+       server was asked for and not its address, as virtual hosts on one
+       address must not resume each other's sessions. If no key is set,
+       sessions are not resumed.
+      */
+    void SetSessionKey(
+      const PString & key   ///< Key for client session cache
+    ) { m_sessionKey = key; }
+
+    /// Get the key used to find a cached session when connecting.
+    const PString & GetSessionKey() const { return m_sessionKey; }
+
+    /// Indicate the last handshake resumed a previous session.
+    bool IsSessionReused() const;
+
     /**Get the internal SSL context structure.
       */
     operator ssl_st *() const { return m_ssl; }
@@ -982,6 +1037,7 @@ class PSSLChannel : public PIndirectChannel
     ssl_st       * m_ssl;
     bio_st       * m_bio;
     VerifyNotifier m_verifyNotifier;
+    PString        m_sessionKey;
 
     P_REMOVE_VIRTUAL(PBoolean,RawSSLRead(void *, PINDEX &),false);
 };
@@ -44,6 +44,7 @@
 #include <ptlib/safecoll.h>
 #include <map>
 #include <queue>
+#include <deque>
 
 
 /**
@@ -385,6 +386,10 @@ class PThreadPool : public PThreadPoolBase
 
 
 /** High Level (queued work item) thread pool.
+
+    By default each work item is queued on a worker thread when it is added,
+    and is executed by that thread. Optionally, see SetWorkStealing(), a
+    worker thread that has run out of work can take items queued on others.
   */
 template <class Work_T>
 class PQueuedThreadPool : public PThreadPool<Work_T>
@@ -392,6 +397,16 @@ class PQueuedThreadPool : public PThreadPool<Work_T>
   protected:
     PTimeInterval m_workerIncreaseLatency;
     unsigned      m_workerIncreaseLimit;
+    bool          m_workStealing;
+    PProfiling::Histogram & m_queueWaitHistogram;
+
+    struct QueuedWork
+    {
+      QueuedWork() : m_time(0), m_work(NULL) { }
+      explicit QueuedWork(Work_T * work) : m_work(work) { }
+      PTime    m_time;
+      Work_T * m_work;
+    };
 
   public:
     //
@@ -407,6 +422,8 @@ class PQueuedThreadPool : public PThreadPool<Work_T>
     ) : PThreadPool<Work_T>(maxWorkers, maxWorkUnits, threadName, priority)
       , m_workerIncreaseLatency(workerIncreaseLatency)
       , m_workerIncreaseLimit(workerIncreaseLimit)
+      , m_workStealing(false)
+      , m_queueWaitHistogram(PProfiling::GetHistogram("ThreadPool wait " + this->m_threadName))
     {
         PTRACE(4, NULL, "ThreadPool", "Thread pool created:"
                                       " maxWorkers=" << maxWorkers << ","
@@ -422,6 +439,26 @@ class PQueuedThreadPool : public PThreadPool<Work_T>
     unsigned GetWorkerIncreaseLimit() const { return m_workerIncreaseLimit; }
     void SetWorkerIncreaseLimit(unsigned limit) { m_workerIncreaseLimit = limit; }
 
+    /**Set work stealing scheduler.
+       When enabled, each worker thread has its own queue, and a worker that
+       runs out of work takes the oldest item from the worker with the most
+       waiting, rather than sitting idle while another is flooded.
+
+       Only work added without a group can be stolen. All the work for a
+       group is still executed, in order, by the one worker thread.
+
+       This must be set before any work is added to the pool.
+      */
+    void SetWorkStealing(bool enable)
+    {
+      PWaitAndSignal mutex(this->m_mutex);
+      if (PAssert(this->m_workers.empty(), "Cannot change scheduler with active workers"))
+        m_workStealing = enable;
+    }
+
+    /// Indicate work stealing scheduler is in use.
+    bool IsWorkStealing() const { return m_workStealing; }
+
     class QueuedWorkerThread : public PThreadPool<Work_T>::WorkerThread
     {
       public:
@@ -457,6 +494,7 @@ class PQueuedThreadPool : public PThreadPool<Work_T>
 
             PQueuedThreadPool & pool = dynamic_cast<PQueuedThreadPool &>(this->m_pool);
             PTimeInterval latency = item.m_time.GetElapsed();
+            pool.m_queueWaitHistogram.Record(latency);
 
             item.m_work->Work();
 
@@ -477,17 +515,190 @@ class PQueuedThreadPool : public PThreadPool<Work_T>
         }
 
       protected:
-        struct QueuedWork
-        {
-          QueuedWork() : m_time(0), m_work(NULL) { }
-          explicit QueuedWork(Work_T * work) : m_work(work) { }
-          PTime    m_time;
-          Work_T * m_work;
-        };
         PSyncQueue<QueuedWork> m_queue;
         bool                   m_working;
     };
 
+    class StealingWorkerThread : public PThreadPool<Work_T>::WorkerThread
+    {
+      public:
+        StealingWorkerThread(PQueuedThreadPool & pool,
+                             PThread::Priority priority = PThread::NormalPriority,
+                             const char * threadName = NULL)
+          : PThreadPool<Work_T>::WorkerThread(pool, priority, threadName)
+          , m_wakeUp(0, INT_MAX)
+          , m_working(false)
+          , m_idle(false)
+        {
+        }
+
+        // Called with the pool mutex locked
+        void AddWork(Work_T * work)
+        {
+          if (PAssertNULL(work) == NULL)
+            return;
+
+          PQueuedThreadPool & pool = dynamic_cast<PQueuedThreadPool &>(this->m_pool);
+          typename PThreadPool<Work_T>::ExternalToInternalWorkMap_T::iterator it = pool.m_externalToInternalWorkMap.find(work);
+          bool grouped = it != pool.m_externalToInternalWorkMap.end() && !it->second.m_group.empty();
+
+          m_queueMutex.Wait();
+          if (grouped)
+            m_grouped.push_back(QueuedWork(work));
+          else
+            m_ungrouped.push_back(QueuedWork(work));
+          m_queueMutex.Signal();
+
+          m_wakeUp.Signal();
+
+          // We are busy, so tell someone else there is something to steal
+          if (!grouped && !m_idle)
+            pool.WakeIdleWorker();
+        }
+
+        void RemoveWork(Work_T * work)
+        {
+          delete work;
+        }
+
+        unsigned GetWorkSize() const
+        {
+          PWaitAndSignal mutex(m_queueMutex);
+          return (unsigned)(m_grouped.size()+m_ungrouped.size())+m_working;
+        }
+
+        size_t GetStealableSize() const
+        {
+          PWaitAndSignal mutex(m_queueMutex);
+          return m_ungrouped.size();
+        }
+
+        // Take the oldest of our own work, grouped or not.
+        bool Dequeue(QueuedWork & item)
+        {
+          PWaitAndSignal mutex(m_queueMutex);
+
+          if (!m_grouped.empty() && (m_ungrouped.empty() || m_grouped.front().m_time <= m_ungrouped.front().m_time)) {
+            item = m_grouped.front();
+            m_grouped.pop_front();
+            return true;
+          }
+
+          if (!m_ungrouped.empty()) {
+            item = m_ungrouped.front();
+            m_ungrouped.pop_front();
+            return true;
+          }
+
+          return false;
+        }
+
+        // Take the oldest work that has no group.
+        bool Steal(QueuedWork & item)
+        {
+          PWaitAndSignal mutex(m_queueMutex);
+
+          if (m_ungrouped.empty())
+            return false;
+
+          item = m_ungrouped.front();
+          m_ungrouped.pop_front();
+          return true;
+        }
+
+        // Called with the pool mutex locked
+        bool WakeUpIfIdle()
+        {
+          if (!m_idle.exchange(false))
+            return false;
+
+          m_wakeUp.Signal();
+          return true;
+        }
+
+        void Main()
+        {
+          PQueuedThreadPool & pool = dynamic_cast<PQueuedThreadPool &>(this->m_pool);
+
+          while (!this->m_shutdown) {
+            // Flag as idle before looking, so work added after looking will wake us
+            m_idle = true;
+
+            QueuedWork item;
+            if (!Dequeue(item) && !pool.StealWork(item, *this)) {
+              m_wakeUp.Wait();
+              continue;
+            }
+
+            m_idle = false;
+            m_working = true;
+
+            PTimeInterval latency = item.m_time.GetElapsed();
+            pool.m_queueWaitHistogram.Record(latency);
+
+            item.m_work->Work();
+
+            if (!pool.RemoveWork(item.m_work))
+              this->RemoveWork(item.m_work);
+
+            m_working = false;
+
+            if (latency > pool.m_workerIncreaseLatency)
+              pool.OnMaxWaitTime(latency);
+          }
+        }
+
+        void Shutdown()
+        {
+          this->m_shutdown = true;
+          m_wakeUp.Signal();
+        }
+
+      protected:
+        std::deque<QueuedWork> m_grouped;
+        std::deque<QueuedWork> m_ungrouped;
+        PMutex                 m_queueMutex;
+        PSemaphore             m_wakeUp;
+        bool                   m_working;
+        atomic<bool>           m_idle;
+    };
+
+    // Called with the pool mutex locked
+    void WakeIdleWorker()
+    {
+      for (PThreadPoolBase::WorkerList_t::iterator it = this->m_workers.begin(); it != this->m_workers.end(); ++it) {
+        if (static_cast<StealingWorkerThread *>(*it)->WakeUpIfIdle())
+          return;
+      }
+    }
+
+    bool StealWork(QueuedWork & item, StealingWorkerThread & thief)
+    {
+      PWaitAndSignal mutex(this->m_mutex);
+
+      StealingWorkerThread * victim = NULL;
+      size_t mostWaiting = 0;
+      for (PThreadPoolBase::WorkerList_t::iterator it = this->m_workers.begin(); it != this->m_workers.end(); ++it) {
+        StealingWorkerThread * worker = static_cast<StealingWorkerThread *>(*it);
+        if (worker != &thief) {
+          size_t waiting = worker->GetStealableSize();
+          if (waiting > mostWaiting) {
+            mostWaiting = waiting;
+            victim = worker;
+          }
+        }
+      }
+
+      if (victim == NULL || !victim->Steal(item))
+        return false;
+
+      // The victim may be reclaimed before the work is finished
+      typename PThreadPool<Work_T>::ExternalToInternalWorkMap_T::iterator it = this->m_externalToInternalWorkMap.find(item.m_work);
+      if (PAssert(it != this->m_externalToInternalWorkMap.end(), "Missing work!"))
+        it->second.m_worker = &thief;
+      return true;
+    }
+
     virtual void OnMaxWaitTime(const PTimeInterval & PTRACE_PARAM(latency))
     {
       unsigned newMaxWorkers = std::min((this->m_maxWorkerCount*11+9)/10, m_workerIncreaseLimit);
@@ -506,6 +717,8 @@ class PQueuedThreadPool : public PThreadPool<Work_T>
 
     virtual PThreadPoolBase::WorkerThreadBase * CreateWorkerThread()
     {
+      if (m_workStealing)
+        return new StealingWorkerThread(*this, this->m_priority, this->m_threadName);
       return new QueuedWorkerThread(*this, this->m_priority, this->m_threadName);
     }
 };
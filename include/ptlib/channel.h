@@ -136,13 +136,7 @@ class PChannel : public PObject, public std::iostream
 
     /**Calculate a hash value for use in sets and dictionaries.
     
-       The hash function for strings will produce a value based on the sum of
-       the first three characters of the string. This is a fairly basic
-       function and make no assumptions about the string contents. A user may
-       descend from PString and override the hash function if they can take
-       advantage of the types of strings being used, eg if all strings start
-       with the letter 'A' followed by 'B or 'C' then the current hash function
-       will not perform very well.
+       The hash function for channels is simply the operating system handle.
 
        @return
        hash value for string.
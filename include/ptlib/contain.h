@@ -55,6 +55,7 @@ class PContainerReference
       , count(1)
       , deleteObjects(true)
       , constObject(isConst)
+      , shortData(false)
     {
     }
 
@@ -63,6 +64,7 @@ class PContainerReference
       , count(1)
       , deleteObjects(ref.deleteObjects)
       , constObject(false)
+      , shortData(false)
     {  
     }
 
@@ -70,6 +72,7 @@ class PContainerReference
     atomic<uint32_t> count;         // reference count to the container content - guaranteed to be atomic
     bool           deleteObjects; // Used by PCollection but put here for efficiency
     bool           constObject;   // Indicates object is constant/static, copy on write.
+    bool           shortData;     // Contents is in the same allocation, only the class that made it may take it over, see PString
 
     PDECLARE_POOL_ALLOCATOR();
 
@@ -132,6 +135,31 @@ class PContainer : public PObject
       const PContainer & cont  ///< Container to create a new reference from.
     );
 
+#if P_HAS_MOVE_SEMANTICS
+    /**Move a container reference.
+       Take over the contents of the container specified in the parameter
+       without changing the reference count. The parameter is left as a
+       valid empty container, which may be used again. It shares a constant
+       empty reference, so nothing is allocated, and takes a copy of that
+       the first time it is modified. Static contents, e.g.
+       <code>PConstString</code>, cannot be taken over and are referenced as
+       for the copy constructor.
+     */
+    PContainer(
+      PContainer && cont  ///< Container to take contents from.
+    ) noexcept;
+
+    /**Move a container reference.
+       Take over the contents of the container specified in the parameter
+       without changing the reference count. The old contents of this
+       container is dereferenced as for the copy assignment operator, and the
+       parameter is left as for the move constructor.
+     */
+    PContainer & operator=(
+      PContainer && cont  ///< Container to take contents from.
+    ) noexcept;
+#endif
+
     /**Destroy the container class.
        This will decrement the reference count on the contents and if unique,
        will destroy it using the <code>DestroyContents()</code> function.
@@ -207,6 +235,13 @@ class PContainer : public PObject
   //@}
 
   protected:
+    /**Make sure the contents may be modified. Collections are not copy on
+       write, so this must be called by anything that changes them, in case
+       the reference is a constant one, e.g. that of a container that has
+       been moved from. A unique copy is made of a constant reference.
+     */
+    __inline void MakeWritable() { if (reference->constObject) MakeUnique(); }
+
     /**Constructor used in support of the Clone() function. This creates a
        new unique reference of a copy of the contents. It does {\b not}
        create another reference.
@@ -248,6 +283,20 @@ class PContainer : public PObject
      */
     virtual void AssignContents(const PContainer & c);
 
+#if P_HAS_MOVE_SEMANTICS
+    /**Move the container contents. This takes the contents from one container
+       to another, leaving the source container as a valid empty container.
+       It is automatically declared when the <code>PCONTAINERINFO()</code>
+       macro is used.
+
+       This function will get called by the move assignment operator.
+     */
+    virtual void MoveContents(PContainer & c);
+
+    /// Determine if this container has the constant empty reference of a moved from container.
+    bool HasEmptyReference() const;
+#endif
+
     /**Copy the container contents. This copies the contents from one reference
        to another. It is automatically declared when the <code>PCONTAINERINFO()</code>
        macro is used.
@@ -279,13 +328,35 @@ class PContainer : public PObject
      */
     void CloneContents(const PContainer * src);
 
+#if P_HAS_MOVE_SEMANTICS
+    /**Reset the contents of a container that has been moved from. This is
+       called on the source of a move, after its reference has been replaced
+       by the constant empty one, and sets the members of the class to what
+       an empty container has. What they pointed to now belongs to the
+       destination, so it must not be destroyed. As with the reference, this
+       should not allocate anything, the members are set to point to shared
+       empty contents that are never destroyed, and any function that
+       modifies them calls <code>MakeWritable()</code> first. It is
+       automatically declared when the <code>PCONTAINERINFO()</code> macro
+       is used.
+
+       This function will get called once for every class in the heirarchy, so
+       the ancestor function should {\b not} be called.
+     */
+    void ResetContents();
+
+    /// Give a moved from container the constant empty reference.
+    void ResetReference();
+#endif
+
     /**Internal function called from container destructors. This will
        conditionally call <code>DestroyContents()</code> to destroy the container contents.
      */
     void Destruct();
 
     /** Destroy the PContainerReference instance.
-        Override if passing a static vallue in via ctor.
+        Override if passing a static vallue in via ctor, or if the class
+        allocates its own kind of reference, e.g. with <code>shortData</code> set.
       */
     virtual void DestroyReference();
 
@@ -329,6 +400,20 @@ class PContainer : public PObject
           Destruct();
         }
 
+        cls(cls && c)
+          : par(std::move(c))
+        {
+          CopyContents(c);
+          if (c.HasEmptyReference())
+            c.ResetContents();
+        }
+
+        cls & operator=(cls && c)
+        {
+          MoveContents(c);
+          return *this;
+        }
+
         PBoolean MakeUnique()
         {
           if (par::MakeUnique())
@@ -337,8 +422,12 @@ class PContainer : public PObject
           return false;
         }
 </code></pre>
-    Then the <code>DestroyContents()</code>, <code>CloneContents()</code> and <code>CopyContents()</code> functions
-    are declared and must be implemented by the programmer. See the
+    The move constructor and move assignment operator are only present if
+    the compiler supports them, see P_HAS_MOVE_SEMANTICS.
+
+    Then the <code>DestroyContents()</code>, <code>CloneContents()</code> and <code>CopyContents()</code> functions,
+    and <code>ResetContents()</code> with move semantics, are
+    declared and must be implemented by the programmer. See the
     <code>PContainer</code> class for more information on these functions.
  */
 #define PCONTAINERINFO(cls, par) \
@@ -356,7 +445,23 @@ class PContainer : public PObject
     void CloneContents(const cls * c); \
     void CopyContents(const cls & c); \
     virtual void AssignContents(const PContainer & c) \
-      { par::AssignContents(c); CopyContents((const cls &)c); }
+      { par::AssignContents(c); CopyContents((const cls &)c); } \
+    PCONTAINERINFO_MOVE(cls, par)
+
+#if P_HAS_MOVE_SEMANTICS
+  #define PCONTAINERINFO_MOVE(cls, par) \
+    public: \
+      cls(cls && c) noexcept : par(std::move(c)) \
+        { CopyContents(c); if (c.HasEmptyReference()) c.ResetContents(); } \
+      cls & operator=(cls && c) noexcept { MoveContents(c); return *this; } \
+    protected: \
+      void ResetContents(); \
+      virtual void MoveContents(PContainer & c) \
+        { par::MoveContents(c); cls & other = (cls &)c; CopyContents(other); \
+          if (other.HasEmptyReference()) other.ResetContents(); }
+#else
+  #define PCONTAINERINFO_MOVE(cls, par)
+#endif
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -35,6 +35,11 @@
 PINLINE PContainer & PContainer::operator=(const PContainer & cont)
   { AssignContents(cont); return *this; }
 
+#if P_HAS_MOVE_SEMANTICS
+PINLINE PContainer & PContainer::operator=(PContainer && cont) noexcept
+  { MoveContents(cont); return *this; }
+#endif
+
 PINLINE void PContainer::CloneContents(const PContainer *)
   { }
 
@@ -56,8 +61,16 @@ PINLINE PBoolean PContainer::IsUnique() const
 PINLINE PString & PString::operator=(const PString & str)
   { AssignContents(str); return *this; }
 
+#if P_HAS_MOVE_SEMANTICS
+PINLINE PString & PString::operator=(PString && str) noexcept
+  { MoveContents(str); return *this; }
+
+PINLINE PString & PString::operator=(const char * cstr)
+  { PString str(cstr); MoveContents(str); return *this; }
+#else
 PINLINE PString & PString::operator=(const char * cstr)
   { AssignContents(PString(cstr)); return *this; }
+#endif
 
 PINLINE PString & PString::operator=(char ch)
   { AssignContents(PString(ch)); return *this; }
@@ -73,6 +86,17 @@ PINLINE PString operator+(const char * cstr, const PString & str)
   
 PINLINE PString operator+(char c, const PString & str)
   { return PString(c) + str; }
+
+#if P_HAS_MOVE_SEMANTICS
+PINLINE PString operator+(PString && str, const PString & str2)
+  { return std::move(str += str2); }
+
+PINLINE PString operator+(PString && str, const char * cstr)
+  { return std::move(str += cstr); }
+
+PINLINE PString operator+(PString && str, char ch)
+  { return std::move(str += ch); }
+#endif
   
 PINLINE PString & PString::operator+=(const PString & str)
   { return operator+=((const char *)str); }
@@ -85,6 +109,17 @@ PINLINE PString operator&(const char * cstr, const PString & str)
   
 PINLINE PString operator&(char c, const PString & str)
   { return PString(c) & str; }
+
+#if P_HAS_MOVE_SEMANTICS
+PINLINE PString operator&(PString && str, const PString & str2)
+  { return std::move(str &= str2); }
+
+PINLINE PString operator&(PString && str, const char * cstr)
+  { return std::move(str &= cstr); }
+
+PINLINE PString operator&(PString && str, char ch)
+  { return std::move(str &= ch); }
+#endif
   
 PINLINE PString & PString::operator&=(const PString & str)
   { return operator&=((const char *)str); }
@@ -231,7 +266,7 @@ PINLINE PCollection::PCollection(int dummy, const PCollection * c)
   : PContainer(dummy, c) { }
 
 PINLINE void PCollection::AllowDeleteObjects(PBoolean yes)
-  { reference->deleteObjects = yes; }
+  { MakeWritable(); reference->deleteObjects = yes; }
 
 PINLINE void PCollection::DisallowDeleteObjects()
   { AllowDeleteObjects(false); }
@@ -260,7 +295,11 @@ PINLINE PINDEX PStringArray::GetStringsIndex(const PString & str) const
 ///////////////////////////////////////////////////////////////////////////////
 
 PINLINE PAbstractList::PAbstractList()
-  : info(new PListInfo) { PAssert(info != NULL, POutOfMemory); }
+  : info(new PListInfo)
+  , m_lastElement(NULL)
+  , m_lastIndex(0)
+  , m_lastChange(0)
+  { PAssert(info != NULL, POutOfMemory); }
 
 ///////////////////////////////////////////////////////////////////////////////
 
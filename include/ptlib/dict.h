@@ -98,13 +98,13 @@ class PKey : public PObject
       return EqualTo;
     }
 
-    /**This function calculates a hash table index value for the implementation
-       of <code>PSet</code> and <code>PDictionary</code> classes.
+    /**This function calculates a hash value for the implementation of
+       <code>PSet</code> and <code>PDictionary</code> classes.
 
        @return
-       hash table bucket number.
+       hash value, which is simply the key.
      */
-    virtual PINDEX HashFunction() const { return PABSINDEX(this->m_key)%23; }
+    virtual PINDEX HashFunction() const { return (PINDEX)this->m_key; }
 
     /**Output the ordinal index to the specified stream. This is identical to
        outputting the PINDEX, i.e. integer, value.
@@ -162,9 +162,7 @@ struct PHashTableElement
     PObject           * m_data;
     PHashTableElement * m_next;
     PHashTableElement * m_prev;
-    PINDEX              m_bucket;
-
-    PDECLARE_POOL_ALLOCATOR();
+    unsigned            m_hash;
 };
 
 struct PHashTableList
@@ -187,9 +185,9 @@ class PHashTableInfo : public PBaseArray<PHashTableList>
     PCLASSINFO(PCharArray, ParentClass);
   public:
     PHashTableInfo(PINDEX initialSize = 0)
-      : ParentClass(initialSize) { }
+      : ParentClass(initialSize), m_elementCount(0), m_migrateIndex(0) { }
     PHashTableInfo(PHashTableList const * buffer, PINDEX length, PBoolean dynamic = true)
-      : ParentClass(buffer, length, dynamic) { }
+      : ParentClass(buffer, length, dynamic), m_elementCount(0), m_migrateIndex(0) { }
     virtual PObject * Clone() const { return PNEW PHashTableInfo(*this, GetSize()); }
     virtual ~PHashTableInfo() { Destruct(); }
     virtual void DestroyContents();
@@ -204,6 +202,28 @@ class PHashTableInfo : public PBaseArray<PHashTableList>
 
     PBoolean deleteKeys;
 
+  protected:
+    PHashTableList * GetBuckets(bool oldBuckets, PINDEX & size) const;
+    PHashTableList * GetList(unsigned hash) const;
+    PHashTableElement * FirstElement(bool inOldBuckets, PINDEX bucket) const;
+    PHashTableElement * LastElement(bool inOldBuckets, PINDEX bucket) const;
+    void LinkElement(PHashTableList & list, PHashTableElement * element);
+    void UnlinkElement(PHashTableList & list, PHashTableElement * element);
+    void Grow();
+    void MigrateBuckets(PINDEX count);
+    void DeleteElement(PHashTableElement * element) { m_elements.Deallocate(element); }
+
+    /* The number of buckets is always a power of two, and doubles when there
+       are more elements than buckets. The elements are moved to the new
+       buckets a few at a time as new elements are added, buckets in
+       m_oldBuckets below m_migrateIndex have already been moved. */
+    PINDEX                     m_elementCount;
+    PBaseArray<PHashTableList> m_oldBuckets;
+    PINDEX                     m_migrateIndex;
+
+    // Elements are allocated from a pool per table
+    PNodePool<PHashTableElement> m_elements;
+
   friend class PHashTable;
   friend class PAbstractSet;
 };
@@ -213,11 +233,16 @@ class PHashTableInfo : public PBaseArray<PHashTableList>
    <code>PDictionary</code> classes.
 
    The hash table allows for very fast searches for an object based on a "hash
-   function". This function yields an index into an array which is directly
-   looked up to locate the object. When two key values have the same hash
-   function value, then a linear search of a linked list is made to locate
-   the object. Thus the efficiency of the hash table is highly dependent on the
-   quality of the hash function for the data being used as keys.
+   function". The value of this function is mixed and masked to an index into
+   an array which is directly looked up to locate the object. When two key
+   values fall in the same bucket, then a linear search of a linked list is
+   made to locate the object. The array grows as elements are added, so the
+   lists stay short. Thus the efficiency of the hash table is highly dependent
+   on the quality of the hash function for the data being used as keys, which
+   should use the full range of a PINDEX.
+
+   Note that the ordinal position of an element may change when other
+   elements are added, and any iterators are invalidated.
  */
 class PHashTable : public PCollection
 {
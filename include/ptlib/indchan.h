@@ -188,6 +188,16 @@ class PIndirectChannel : public PChannel
       bool localEcho
     );
 
+    /**Indicate data has been read from the underlying channel and is held in
+       this object, not yet returned by Read(). This data does not make the
+       base channel readable, so it must be drained before waiting on it, e.g.
+       with PSocket::Select() or PSocketReactor.
+
+       The behaviour for this function is to pass the query on to the read
+       channel, if it is also an indirect channel.
+      */
+    virtual bool HasBufferedData() const;
+
 
     /**This function returns the eventual base channel for reading of a series
        of indirect channels provided by descendents of <code>PIndirectChannel</code>.
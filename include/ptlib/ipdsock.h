@@ -110,6 +110,47 @@ class PIPDatagramSocket : public PIPSocket
       const PIPSocketAddressAndPort & ipAndPort
     );
 
+    /**Information on a datagram for ReadFromMulti() and WriteToMulti().
+     */
+    struct Datagram
+    {
+      Datagram(PINDEX size = 0) : m_data(size), m_length(0), m_truncated(false) { }
+
+      PBYTEArray              m_data;      ///< Buffer for datagram, size of array is maximum that can be read
+      PINDEX                  m_length;    ///< Length of datagram read, or to be written
+      PIPSocketAddressAndPort m_ipAndPort; ///< Address datagram was read from, or is to be written to
+      bool                    m_truncated; ///< Datagram read was larger than m_data, only m_length bytes kept
+    };
+    typedef std::vector<Datagram> Datagrams;
+
+    /**Read multiple datagrams from remote computers.
+       This waits, subject to the read timeout, for at least one datagram and
+       then takes as many more as are immediately available, up to the size
+       of <code>datagrams</code>. Where the platform supports it (recvmmsg)
+       this is a single system call.
+
+       GetLastReadCount() returns the number of datagrams read, entries
+       beyond that are unchanged. A datagram too large for its buffer is
+       still counted, with m_truncated set, so those after it are not lost.
+
+       @return true if at least one datagram was read.
+     */
+    virtual bool ReadFromMulti(
+      Datagrams & datagrams   ///< Datagrams to read
+    );
+
+    /**Write multiple datagrams to remote computers.
+       Where the platform supports it (sendmmsg) the datagrams are sent with
+       as few system calls as possible.
+
+       GetLastWriteCount() returns the number of datagrams written.
+
+       @return true if all the datagrams were sucessfully written.
+     */
+    virtual bool WriteToMulti(
+      const Datagrams & datagrams   ///< Datagrams to write
+    );
+
 
 // Include platform dependent part of class
 #ifdef _WIN32
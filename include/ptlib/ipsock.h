@@ -390,6 +390,18 @@ class PIPSocket : public PSocket
       */
     static bool GetSuppressCanonicalName();
 
+    /**Set the time host name lookups are kept in the name (DNS) cache.
+
+       Successful lookups are kept for \p found and failed lookups for
+       \p notFound. A successful lookup used in the last tenth of its
+       lifetime is refreshed in the background, so a busy name does not
+       block its users when it expires.
+      */
+    static void SetNameCacheTimeouts(
+      const PTimeInterval & found,    ///< Time to keep successful lookups, default 5 minutes
+      const PTimeInterval & notFound  ///< Time to keep failed lookups, default 30 seconds
+    );
+
     /**Open an IPv4 or IPv6 socket
      */
     virtual PBoolean OpenSocket(
@@ -544,6 +556,32 @@ class PIPSocket : public PSocket
       Address & addr    ///< Variable to receive hosts IP address.
     );
 
+    /**Notifier for GetHostAddressAsync(). The notifier object is a PString
+       containing the host name, the parameter is the hosts address, which is
+       invalid if the name could not be resolved.
+     */
+    typedef PNotifierTemplate<const Address &> HostAddressNotifier;
+
+    /**Get the Internet Protocol address for the specified host without
+       blocking.
+
+       If the address is an IP number, or the name is in the cache, then the
+       \p notifier is called before this function returns. Otherwise the
+       name is looked up in a background thread and the \p notifier is
+       called from that thread. Concurrent lookups of the same name, whether
+       from this function or GetHostAddress(), share a single DNS query.
+
+       @return
+       true if the \p notifier was called before returning.
+     */
+    static bool GetHostAddressAsync(
+      const PString & hostname,
+      /**< Name of host to get address for. This may be either a domain name or
+           an IP number in "dot" format.
+       */
+      const HostAddressNotifier & notifier  ///< Notifier to receive address
+    );
+
     /**Get the alias host names for the specified host. This includes all DNS
        names, CNAMEs, names in the local hosts file and IP numbers (as "dot"
        format strings) for the host.
@@ -48,16 +48,26 @@ struct PListElement
     PListElement * prev;
     PListElement * next;
     PObject * data;
-
-    PDECLARE_POOL_ALLOCATOR();
 };
 
 struct PListInfo
 {
-    PListInfo() { head = tail = NULL; }
+    PListInfo() : head(NULL), tail(NULL), m_changes(0) PTRACE_PARAM(, m_slowLookups(0)) { }
     PListElement * head;
     PListElement * tail;
 
+    // Incremented when elements are inserted or removed anywhere but the
+    // tail, so a list can tell if its remembered ordinal position is valid.
+    unsigned m_changes;
+#if PTRACING
+    atomic<uint32_t> m_slowLookups; // Counted by const lookups, so maybe from several threads
+#endif
+
+    // Elements are allocated from a pool per list
+    PListElement * NewElement(PObject * obj) { return new (m_elements.Allocate()) PListElement(obj); }
+    void DeleteElement(PListElement * element) { m_elements.Deallocate(element); }
+    PNodePool<PListElement> m_elements;
+
     PDECLARE_POOL_ALLOCATOR();
 };
 
@@ -71,6 +81,8 @@ struct PListInfo
    The class remembers the last accessed element. This state information is
    used to optimise access by the "virtual array" model of collections. If
    access via ordinal index is made sequentially there is little overhead.
+   Random access by index still walks the list, if this happens a lot on a
+   large list it is reported in the trace log at level 2.
 
    The PAbstractList class would very rarely be descended from directly by
    the user. The <code>PDECLARE_LIST</code> and <code>PLIST</code> macros would normally
@@ -310,10 +322,16 @@ class PAbstractList : public PCollection
     PListElement * FindElement(const PObject & obj, PINDEX * index) const;
     void InsertElement(PListElement * element, PObject * obj);
     PObject * RemoveElement(PListElement * element);
+    void SetLastElement(PListElement * element, PINDEX index) const;
 
     // The types below cannot be nested as DevStudio 2005 AUTOEXP.DAT doesn't like it
     typedef PListElement Element;
     PListInfo * info;
+
+    // Last element found by ordinal index, valid while m_lastChange matches info->m_changes
+    mutable PListElement * m_lastElement;
+    mutable PINDEX         m_lastIndex;
+    mutable unsigned       m_lastChange;
 };
 
 
@@ -710,8 +728,6 @@ struct PSortedListElement
   PObject            * m_data;
   PINDEX               m_subTreeSize;
   enum { Red, Black }  m_colour;
-
-  PDECLARE_POOL_ALLOCATOR();
 };
 
 struct PSortedListInfo
@@ -728,6 +744,11 @@ struct PSortedListInfo
   PINDEX ValueSelect(PSortedListElement * node, const PObject & obj, PSortedListElement * & element) const;
   PINDEX ValueSelect(const PObject & obj, PSortedListElement * & element) const { return ValueSelect(m_root, obj, element); }
 
+  // Elements are allocated from a pool per list
+  PSortedListElement * NewElement(PObject * obj) { return new (m_elements.Allocate()) PSortedListElement(&nil, obj); }
+  void DeleteElement(PSortedListElement * element) { m_elements.Deallocate(element); }
+  PNodePool<PSortedListElement> m_elements;
+
   PDECLARE_POOL_ALLOCATOR();
 };
 
@@ -1143,6 +1164,391 @@ template <class T> class PSortedList : public PAbstractSortedList
       { return PNEW cls(0, this); } \
 
 
+
+///////////////////////////////////////////////////////////////////////////////
+// Sorted array of objects
+
+struct PSortedArrayInfo
+{
+  PSortedArrayInfo() : m_sortedSize(0) { }
+
+  std::vector<PObject *> m_objects;    // Entries before m_sortedSize are in rank order
+  PINDEX                 m_sortedSize; // Entries after are waiting to be merged in
+};
+
+/**This class is a collection of objects which are descendents of the
+   <code>PObject</code> class. It is implemented as a contiguous array of
+   object pointers kept in rank order. Note that this requires that the
+   <code>PObject::Compare()</code> function be fully implemented on objects
+   contained in the collection.
+
+   This has the same interface as <code>PAbstractSortedList</code> but a
+   different balance of costs. Finding an object by value is a binary search
+   and access by ordinal index is constant time, and iteration walks a single
+   block of memory, so for read mostly collections, e.g. routing tables or
+   access lists, it is considerably faster and smaller than the red-black
+   tree. Inserting or removing a single object is o(n) as the pointers after
+   it must be moved.
+
+   When building a large collection, <code>AppendUnsorted()</code> may be used
+   to add objects without ordering them. They are sorted and merged with the
+   existing objects, in a single o(n lg n) pass, by <code>Sort()</code>, which
+   must be called before the collection is searched, indexed or iterated. The
+   const functions never reorder the array, so concurrent readers are safe.
+
+   The <code>PSortedArray</code> class or <code>PDECLARE_SORTED_ARRAY</code> macro
+   will define the correctly typed operators for subscript access
+   (operator[]).
+ */
+class PAbstractSortedArray : public PCollection
+{
+  PCONTAINERINFO(PAbstractSortedArray, PCollection);
+
+  public:
+  /**@name Construction */
+  //@{
+    /**Create a new, empty, sorted array.
+
+       Note that by default, objects placed into the array will be deleted when
+       removed or when all references to the array are destroyed.
+     */
+    PAbstractSortedArray();
+  //@}
+
+  /**@name Overrides from class PObject */
+  //@{
+    /**Get the relative rank of the two arrays. The algorithm is the same as
+       for <code>PAbstractSortedList::Compare()</code>.
+
+       @return
+       comparison of the two objects, <code>EqualTo</code> for same,
+       <code>LessThan</code> for <code>obj</code> logically less than the
+       object and <code>GreaterThan</code> for <code>obj</code> logically
+       greater than the object.
+     */
+    virtual Comparison Compare(const PObject & obj) const;
+  //@}
+
+  /**@name Overrides from class PContainer */
+  //@{
+    /**This function is meaningless for sorted arrays. The size of the
+       collection is determined by the addition and removal of objects. The
+       size cannot be set in any other way.
+
+       @return
+       Always true.
+     */
+    virtual PBoolean SetSize(
+      PINDEX newSize  // New size for the sorted array, this is ignored.
+    );
+  //@}
+
+  /**@name Overrides from class PCollection */
+  //@{
+    /**Add a new object to the collection. The object is always placed in the
+       correct ordinal position in the array, after any objects of equal
+       value. It is not placed at the "end".
+
+       @return
+       index of the newly added object.
+     */
+    virtual PINDEX Append(
+      PObject * obj   // New object to place into the collection.
+    );
+
+    /**Add a new object to the collection. The <code>before</code> parameter
+       is ignored, the object is always placed in the correct ordinal position.
+
+       @return
+       index of the newly inserted object.
+     */
+    virtual PINDEX Insert(
+      const PObject & before,   // Object value to insert before.
+      PObject * obj             // New object to place into the collection.
+    );
+
+    /**Add a new object to the collection. The <code>index</code> parameter
+       is ignored, the object is always placed in the correct ordinal position.
+
+       @return
+       index of the newly inserted object.
+     */
+    virtual PINDEX InsertAt(
+      PINDEX index,   // Index position in collection to place the object.
+      PObject * obj   // New object to place into the collection.
+    );
+
+    /**Remove the object from the collection. If the AllowDeleteObjects option
+       is set then the object is also deleted.
+
+       Note that the comparison for searching for the object in collection is
+       made by pointer, not by value. Thus the parameter must point to the
+       same instance of the object that is in the collection.
+
+       @return
+       true if the object was in the collection.
+     */
+    virtual PBoolean Remove(
+      const PObject * obj   // Existing object to remove from the collection.
+    );
+
+    /**Remove the object at the specified ordinal index from the collection.
+       If the AllowDeleteObjects option is set then the object is also deleted.
+
+       @return
+       pointer to the object being removed, or NULL if it was deleted or the
+       index was out of range.
+     */
+    virtual PObject * RemoveAt(
+      PINDEX index   // Index position in collection to place the object.
+    );
+
+    /**Remove all of the elements in the collection.
+     */
+    virtual void RemoveAll();
+
+    /**This method simply returns false as the array order is mantained by the 
+       class. Kept to mimic <code>PAbstractSortedList</code> interface.
+       
+       @return
+       false allways
+     */
+    virtual PBoolean SetAt(
+      PINDEX index,   // Index position in collection to set.
+      PObject * val   // New value to place into the collection.
+    );
+
+    /**Get the object at the specified ordinal position. If the index was
+       greater than the size of the collection then NULL is returned.
+
+       @return
+       pointer to object at the specified index.
+     */
+    virtual PObject * GetAt(
+      PINDEX index  // Index position in the collection of the object.
+    ) const;
+
+    /**Search the collection for the specific instance of the object. The
+       object pointers are compared, not the values. A binary search is
+       employed to locate the first entry of equal value, and then a check
+       is made on the pointers of the equal entries.
+
+       @return
+       ordinal index position of the object, or P_MAX_INDEX.
+     */
+    virtual PINDEX GetObjectsIndex(
+      const PObject * obj
+    ) const;
+
+    /**Search the collection for the specified value of the object. The object
+       values are compared, not the pointers.  So the objects in the
+       collection must correctly implement the <code>PObject::Compare()</code>
+       function. A binary search is employed to locate the entry.
+
+       @return
+       ordinal index position of the first object of equal value, or
+       P_MAX_INDEX.
+     */
+    virtual PINDEX GetValuesIndex(
+      const PObject & obj
+    ) const;
+  //@}
+
+  /**@name New functions for class */
+  //@{
+    /**Add a new object to the end of the collection without ordering it.
+       This is for building large collections in bulk, the objects are sorted
+       and merged into the collection by Sort(), which is o(n lg n) for all of
+       them rather than o(n) for each of them.
+
+       Sort() must be called before any const function is used, they assert
+       if there are objects waiting to be sorted. Append() and RemoveAt() sort
+       as required.
+     */
+    void AppendUnsorted(
+      PObject * obj   // New object to place into the collection.
+    );
+
+    /**Sort and merge any objects added with AppendUnsorted().
+     */
+    void Sort();
+
+    /// Indicate there are no objects waiting to be sorted.
+    bool IsSorted() const { return m_info->m_sortedSize == (PINDEX)m_info->m_objects.size(); }
+
+    /**Reserve memory for the number of objects in the collection, so it is
+       not reallocated during a bulk build.
+     */
+    void Reserve(
+      PINDEX count  // Total number of objects expected
+    ) { MakeWritable(); m_info->m_objects.reserve(count); }
+  //@}
+
+  protected:
+    bool CheckSorted() const { return PAssert(IsSorted(), "PSortedArray used before Sort() after AppendUnsorted()"); }
+    PINDEX LowerBound(const PObject & obj) const;
+
+    // The type below cannot be nested as DevStudio 2005 AUTOEXP.DAT doesn't like it
+    PSortedArrayInfo * m_info;
+};
+
+
+/**This template class maps the PAbstractSortedArray to a specific object
+   type. The functions in this class primarily do all the appropriate casting
+   of types.
+ */
+template <class T> class PSortedArray : public PAbstractSortedArray
+{
+  PCLASSINFO(PSortedArray, PAbstractSortedArray);
+
+  public:
+  /**@name Construction */
+  //@{
+    /**Create a new, empty, sorted array.
+
+       Note that by default, objects placed into the array will be deleted when
+       removed or when all references to the array are destroyed.
+     */
+    PSortedArray()
+      : PAbstractSortedArray() { }
+  //@}
+
+  /**@name Overrides from class PObject */
+  //@{
+    /**Make a complete duplicate of the array. Note that all objects in the
+       array are also cloned, so this will make a complete copy of the array.
+     */
+    virtual PObject * Clone() const
+      { return PNEW PSortedArray(0, this); }
+  //@}
+
+  /**@name New functions for class */
+  //@{
+    /**Retrieve a reference  to the object in the array. If there was not an
+       object at that ordinal position or the index was beyond the size of the
+       array then the function asserts.
+
+       @return
+       reference to the object at <code>index</code> position.
+     */
+    T & operator[](
+      PINDEX index  ///< Index for entry
+    ) const { return dynamic_cast<T &>(*this->GetAt(index)); }
+  //@}
+
+  /**@name Iterators */
+  //@{
+    typedef T value_type;
+    friend class iterator_base;
+
+  private:
+    class iterator_base : public std::iterator<std::bidirectional_iterator_tag, value_type> {
+      protected:
+        const PSortedArray<T> * m_array;
+        PINDEX                  m_index;
+
+        iterator_base(const PSortedArray<T> * a, PINDEX i) : m_array(a), m_index(i) { }
+
+        bool Valid() const { return PAssert(this->m_array != NULL && this->m_index < this->m_array->GetSize(), PInvalidArrayIndex); }
+        void Next() { if (Valid() && ++this->m_index >= this->m_array->GetSize()) this->m_index = P_MAX_INDEX; }
+        void Prev() { if (Valid() && this->m_index-- == 0) this->m_index = P_MAX_INDEX; }
+        value_type * Ptr() const { return dynamic_cast<value_type *>(Valid() ? this->m_array->m_info->m_objects[this->m_index] : NULL); }
+
+      public:
+        bool operator==(const iterator_base & it) const { return this->m_index == it.m_index; }
+        bool operator!=(const iterator_base & it) const { return this->m_index != it.m_index; }
+
+      friend class PSortedArray<T>;
+    };
+
+    PINDEX FirstIndex() const { this->CheckSorted(); return this->IsEmpty() ? P_MAX_INDEX : 0; }
+    PINDEX LastIndex() const { this->CheckSorted(); return this->IsEmpty() ? P_MAX_INDEX : this->GetSize()-1; }
+
+  public:
+    class iterator : public iterator_base {
+      public:
+        iterator() : iterator_base(NULL, P_MAX_INDEX) { }
+        iterator(PSortedArray<T> * a, PINDEX i) : iterator_base(a, i) { }
+
+        iterator operator++()    {                      this->Next(); return *this; }
+        iterator operator--()    {                      this->Prev(); return *this; }
+        iterator operator++(int) { iterator it = *this; this->Next(); return it;    }
+        iterator operator--(int) { iterator it = *this; this->Prev(); return it;    }
+
+        value_type * operator->() const { return  this->Ptr(); }
+        value_type & operator* () const { return *this->Ptr(); }
+    };
+
+    iterator begin()  { return iterator(this, this->FirstIndex()); }
+    iterator end()    { return iterator();                         }
+    iterator rbegin() { return iterator(this, this->LastIndex());  }
+    iterator rend()   { return iterator();                         }
+
+    class const_iterator : public iterator_base {
+      public:
+        const_iterator() : iterator_base(NULL, P_MAX_INDEX) { }
+        const_iterator(const PSortedArray<T> * a, PINDEX i) : iterator_base(a, i) { }
+
+        const_iterator operator++()    {                            this->Next(); return *this; }
+        const_iterator operator--()    {                            this->Prev(); return *this; }
+        const_iterator operator++(int) { const_iterator it = *this; this->Next(); return it;    }
+        const_iterator operator--(int) { const_iterator it = *this; this->Prev(); return it;    }
+
+        const value_type * operator->() const { return  this->Ptr(); }
+        const value_type & operator* () const { return *this->Ptr(); }
+    };
+
+    const_iterator begin()  const { return const_iterator(this, this->FirstIndex()); }
+    const_iterator end()    const { return const_iterator();                         }
+    const_iterator rbegin() const { return const_iterator(this, this->LastIndex());  }
+    const_iterator rend()   const { return const_iterator();                         }
+
+    value_type & front() { return *this->begin(); }
+    value_type & back()  { return *this->rbegin(); }
+    const value_type & front() const { return *this->begin(); }
+    const value_type & back()  const { return *this->rbegin(); }
+
+          iterator find(const value_type & obj)       { return       iterator(this, this->GetValuesIndex(obj)); }
+    const_iterator find(const value_type & obj) const { return const_iterator(this, this->GetValuesIndex(obj)); }
+
+    void erase(const iterator & it)       { PAssert(this == it.m_array, PLogicError); this->RemoveAt(it.m_index); }
+    void erase(const const_iterator & it) { PAssert(this == it.m_array, PLogicError); this->RemoveAt(it.m_index); }
+    __inline void insert(const value_type & value) { this->Append(new value_type(value)); }
+    __inline void pop_front() { this->erase(this->begin()); }
+    __inline void pop_back() { this->erase(this->rbegin()); }
+  //@}
+
+  protected:
+    PSortedArray(int dummy, const PSortedArray * c)
+      : PAbstractSortedArray(dummy, c) { }
+};
+
+
+/**Declare a sorted array class.
+   This macro produces a typedef of the <code>PSortedArray</code> template
+   class for the object type <b>T</b>.
+ */
+#define PSORTED_ARRAY(cls, T) typedef PSortedArray<T> cls
+
+
+/**Begin declaration of a sorted array class.
+   This macro is used to declare a descendent of PAbstractSortedArray class,
+   customised for a particular object type <b>T</b>, in the same manner as
+   <code>PDECLARE_SORTED_LIST</code>.
+ */
+#define PDECLARE_SORTED_ARRAY(cls, T) \
+  PSORTED_ARRAY(cls##_PTemplate, T); \
+  PDECLARE_CLASS(cls, PSortedArray<T>) \
+  protected: \
+    cls(int dummy, const cls * c) \
+      : PSortedArray<T>(dummy, c) { } \
+  public: \
+    cls() \
+      : PSortedArray<T>() { } \
+    virtual PObject * Clone() const \
+      { return PNEW cls(0, this); } \
+
+
 #endif // PTLIB_LISTS_H
 
 
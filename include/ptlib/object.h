@@ -64,6 +64,7 @@
 #include <limits>
 #include <typeinfo>
 #include <memory>
+#include <new>
 
 using namespace std; // Not a good practice (name space polution), but will take too long to fix.
 
@@ -118,6 +119,25 @@ using namespace std; // Not a good practice (name space polution), but will take
 #define P_DISABLE_MSVC_WARNINGS(warnings, statement) P_PUSH_MSVC_WARNINGS(warnings) statement P_POP_MSVC_WARNINGS()
 
 
+// Rvalue references, std::move and noexcept, used for move constructors and assignment
+#ifndef P_HAS_MOVE_SEMANTICS
+  #if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1900)
+    #define P_HAS_MOVE_SEMANTICS 1
+  #else
+    #define P_HAS_MOVE_SEMANTICS 0
+  #endif
+#endif
+
+// Thread local storage for plain types, not defined if the compiler has none
+#ifndef P_THREAD_LOCAL
+  #if defined(_MSC_VER)
+    #define P_THREAD_LOCAL __declspec(thread)
+  #elif defined(__GNUC__)
+    #define P_THREAD_LOCAL __thread
+  #endif
+#endif
+
+
 // We are gradually converting over to standard C++ names, these
 // are for backward compatibility only
 
@@ -453,6 +473,8 @@ public:
                                   ///< Mask for all the rotate bits
     ObjectInstance    = 0x1000,   ///< Include object instance in all trace output
     ContextIdentifier = 0x2000,   ///< Include context identifier in all trace output
+    AsynchronousOutput = 0x4000,  /**< Trace lines are queued and written by a background
+                                       thread, see SetAsynchronousQueue(). */
     SystemLogStream   = 0x8000,   /**< SystemLog flag for tracing within a PServiceProcess
                                        application. Setting this flag will automatically
                                        execute <code>#SetStream(new PSystemLog)</code>. */
@@ -478,6 +500,7 @@ public:
     "  hour     rotate output file hourly\r" \
     "  minute   rotate output file every minute\r" \
     "  append   append to output file, otherwise overwrites\r" \
+    "  async    output written by background thread\r" \
     "  <perm>   file permission similar to unix chmod, but starts\r" \
     "           with +/- and only has one combination at a time,\r" \
     "           e.g. +uw is user write, +or is other read, etc"
@@ -627,6 +650,21 @@ public:
   */
   static ostream * GetStream();
 
+  /** Set the parameters for the queue used with the AsynchronousOutput option.
+      The queue size is rounded up to a power of two, and only takes effect
+      if called before asynchronous output has first started. When the queue
+      is full, either the tracing thread waits for room, or the trace line
+      is discarded and counted, see GetAsynchronousDropped().
+  */
+  static void SetAsynchronousQueue(
+    unsigned size,        ///< Maximum number of trace lines queued
+    bool blockWhenFull    ///< Wait for room rather than discard line
+  );
+
+  /** Get the number of trace lines discarded due to a full asynchronous queue.
+  */
+  static unsigned GetAsynchronousDropped();
+
   /** Output trace parameters (level, output, options etc) to stream.
     */
   static ostream & PrintInfo(
@@ -1209,9 +1247,201 @@ namespace PProfiling
 #endif
 
 
+class PTimeInterval;
+
+namespace PProfiling
+{
+  /**Latency histogram.
+     This is always available, unlike the function profiling above, so that
+     percentiles can be obtained from a production build.
+
+     Values, normally microseconds, are counted in log-linear buckets in the
+     style of HDR histograms. Each power of two is split into SubBucketCount
+     linear sub-buckets, so a percentile is accurate to about 6%. Recording
+     is lock free and goes to one of several shards selected by the calling
+     thread, so busy threads do not contend on the same counters. The shards
+     are merged when the histogram is read.
+
+     Histograms are created and owned by a registry, see GetHistogram().
+    */
+  class Histogram
+  {
+    public:
+      enum {
+        SubBucketBits  = 4,
+        SubBucketCount = 1 << SubBucketBits,
+        MaxValueBits   = 40,  // Larger values are counted in the last bucket
+        BucketCount    = (MaxValueBits - SubBucketBits + 1) * SubBucketCount,
+        ShardCount     = 8
+      };
+
+      /// Record a value, normally in microseconds.
+      void Record(
+        uint64_t value
+      );
+
+      /// Record a time interval in microseconds, negative values are zero.
+      void Record(
+        const PTimeInterval & interval
+      );
+
+      /// Get a monotonic time in microseconds, for use with Record().
+      static uint64_t GetTime();
+
+      /// Merged counts of all shards.
+      struct Snapshot
+      {
+        Snapshot();
+
+        /// Get highest value at or below which the percentage of values fall.
+        uint64_t GetPercentile(double percentile) const;
+        uint64_t GetMean() const { return m_count > 0 ? m_sum / m_count : 0; }
+
+        uint64_t              m_count;
+        uint64_t              m_sum;
+        uint64_t              m_minimum;
+        uint64_t              m_maximum;
+        std::vector<uint64_t> m_buckets;
+      };
+
+      /// Merge all the shards into a snapshot.
+      void GetSnapshot(
+        Snapshot & snapshot
+      ) const;
+
+      /// Clear all counts.
+      void Reset();
+
+      /// Get name the histogram is registered as.
+      const std::string & GetName() const { return m_name; }
+
+      /// Get the bucket index for value.
+      static unsigned GetBucket(uint64_t value);
+
+      /// Get the highest value counted in bucket index.
+      static uint64_t GetBucketLimit(unsigned bucket);
+
+    protected:
+      Histogram(const std::string & name);
+      ~Histogram();
+
+      std::string m_name;
+      struct Shard;
+      Shard     * m_shards;
+
+    private:
+      Histogram(const Histogram &);
+      void operator=(const Histogram &);
+
+    friend struct HistogramRegistry;
+  };
+
+  /**Get the histogram of the name, creating it if necessary.
+     This locks the registry so the reference should be kept, usually in a
+     static or member variable, rather than looked up for every value. The
+     histogram exists until the process exits.
+    */
+  Histogram & GetHistogram(
+    const std::string & name
+  );
+
+  /// Output the percentiles of all registered histograms.
+  void DumpHistograms(
+    ostream & strm,
+    bool html
+  );
+
+  /// Output the percentiles of all registered histograms to the trace log.
+  void TraceHistograms(
+    unsigned level
+  );
+
+  /// Clear all registered histograms.
+  void ResetHistograms();
+
+  /// Record the time between construction and destruction in a histogram.
+  class HistogramTimer
+  {
+    public:
+      HistogramTimer(
+        Histogram & histogram
+      ) : m_histogram(histogram)
+        , m_start(Histogram::GetTime())
+      {
+      }
+
+      ~HistogramTimer()
+      {
+        m_histogram.Record(Histogram::GetTime() - m_start);
+      }
+
+    protected:
+      Histogram & m_histogram;
+      uint64_t    m_start;
+  };
+
+  #define PPROFILE_HISTOGRAM(name) \
+    static ::PProfiling::Histogram & p_profile_histogram_instance = ::PProfiling::GetHistogram(name); \
+    ::PProfiling::HistogramTimer p_profile_histogram_timer(p_profile_histogram_instance)
+};
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // Memory management
 
+/**Memory usage by class.
+   When enabled, every <code>PCLASSINFO</code> class counts the objects
+   and bytes allocated with <code>new</code>, so it can be seen which part
+   of a running system is growing. Each thread keeps its own counters, so no
+   lock is taken on allocation. Only the object itself is counted, not any
+   memory it owns, e.g. the buffer of a PString.
+
+   In memory check builds the same information is taken from PMemoryHeap,
+   which also counts allocations that are not PObject derived.
+
+   This is off by default, as it gives every class its own operator new and
+   delete. It is enabled with the <code>--enable-memaccounting</code>
+   configure option.
+ */
+class PMemoryUsage
+{
+  public:
+    struct ClassInfo {
+      ClassInfo(const char * name = NULL) : m_className(name), m_objects(0), m_bytes(0), m_allocations(0) { }
+
+      const char * m_className;
+      PInt64       m_objects;      ///< Objects currently allocated
+      PInt64       m_bytes;        ///< Bytes currently allocated
+      PUInt64      m_allocations;  ///< Total objects allocated since start up
+    };
+    typedef std::vector<ClassInfo> ClassList;
+
+    /**Get the memory usage for every class that has been allocated.
+       The list is sorted with the largest current usage first.
+       @return false if memory usage accounting is not available.
+      */
+    static bool GetClasses(
+      ClassList & classes
+    );
+
+    /**Print a table of memory usage by class, largest first.
+      */
+    static void PrintClasses(
+      ostream & strm,           ///< Stream to output to
+      size_t maxClasses = 0     ///< Maximum number of classes to output, zero is all
+    );
+
+    /// Get a readable version of the class name, as returned by PObject::Class()
+    static std::string GetClassName(const char * className);
+
+    // Used by PCLASSINFO
+    static unsigned Register(const char * className);
+    static void * Allocate(size_t nSize, unsigned index);
+    static void * Allocate(size_t nSize, unsigned index, const std::nothrow_t &);
+    static void Deallocate(void * ptr, size_t nSize, unsigned index);
+};
+
+
 #if PMEMORY_CHECK || (defined(_MSC_VER) && defined(_DEBUG) && !defined(_WIN32_WCE)) 
 
 #define PMEMORY_HEAP 1
@@ -1391,6 +1621,8 @@ class PMemoryHeap {
     );
     void InternalDumpStatistics(ostream & strm);
     void InternalDumpObjectsSince(DWORD objectNumber, ostream & strm);
+    void InternalGetClasses(PMemoryUsage::ClassInfo * & infos, size_t & count);
+    friend class PMemoryUsage;
 
     class Wrapper {
       public:
@@ -1632,8 +1864,50 @@ public:
 
 #define PNEW new
 
+#if P_MEMORY_ACCOUNTING && (!P_STD_ATOMIC || (defined(_MSC_VER) && _MSC_VER < 1900))
+  #undef P_MEMORY_ACCOUNTING // Need std::atomic and thread_local
+#endif
+
+#if P_MEMORY_ACCOUNTING
+  #define PNEW_AND_DELETE_FUNCTIONS_ACCOUNTED \
+      static unsigned PMemoryUsageIndex() \
+        { static unsigned const index = PMemoryUsage::Register(Class()); return index; } \
+      void * operator new(size_t nSize) \
+        { return PMemoryUsage::Allocate(nSize, PMemoryUsageIndex()); } \
+      void operator delete(void * ptr, size_t nSize) \
+        { PMemoryUsage::Deallocate(ptr, nSize, PMemoryUsageIndex()); } \
+      void * operator new(size_t, void * placement) \
+        { return placement; } \
+      void operator delete(void *, void *) \
+        { } \
+      void * operator new[](size_t nSize) \
+        { return PMemoryUsage::Allocate(nSize, PMemoryUsageIndex()); } \
+      void operator delete[](void * ptr, size_t nSize) \
+        { PMemoryUsage::Deallocate(ptr, nSize, PMemoryUsageIndex()); } \
+      void * operator new(size_t nSize, const std::nothrow_t & nt) \
+        { return PMemoryUsage::Allocate(nSize, PMemoryUsageIndex(), nt); } \
+      void operator delete(void * ptr, const std::nothrow_t &) \
+        { PMemoryUsage::Deallocate(ptr, sizeof(P_thisClass), PMemoryUsageIndex()); } \
+      void * operator new[](size_t nSize, const std::nothrow_t & nt) \
+        { return PMemoryUsage::Allocate(nSize, PMemoryUsageIndex(), nt); } \
+      void operator delete[](void * ptr, const std::nothrow_t &) \
+        { PMemoryUsage::Deallocate(ptr, sizeof(P_thisClass), PMemoryUsageIndex()); }
+#endif
+
 #if _MSC_VER < 1800
-  #define PNEW_AND_DELETE_FUNCTIONS(align)
+  #if P_MEMORY_ACCOUNTING
+    // The heap aligns to 16 on 64 bit platforms, larger alignment is left to the compiler
+    #define PNEW_AND_DELETE_FUNCTIONS(align) PNEW_AND_DELETE_FUNCTIONS_ACCOUNTED##align
+    #define PNEW_AND_DELETE_FUNCTIONS_ACCOUNTED64
+    #define PNEW_AND_DELETE_FUNCTIONS_ACCOUNTED32
+    #define PNEW_AND_DELETE_FUNCTIONS_ACCOUNTED16 PNEW_AND_DELETE_FUNCTIONS_ACCOUNTED
+    #define PNEW_AND_DELETE_FUNCTIONS_ACCOUNTED8  PNEW_AND_DELETE_FUNCTIONS_ACCOUNTED
+    #define PNEW_AND_DELETE_FUNCTIONS_ACCOUNTED4  PNEW_AND_DELETE_FUNCTIONS_ACCOUNTED
+    #define PNEW_AND_DELETE_FUNCTIONS_ACCOUNTED2  PNEW_AND_DELETE_FUNCTIONS_ACCOUNTED
+    #define PNEW_AND_DELETE_FUNCTIONS_ACCOUNTED0  PNEW_AND_DELETE_FUNCTIONS_ACCOUNTED
+  #else
+    #define PNEW_AND_DELETE_FUNCTIONS(align)
+  #endif
 #else
   #define PNEW_AND_DELETE_FUNCTIONS_ALIGNED(align) \
       void * operator new(size_t nSize) \
@@ -1655,7 +1929,11 @@ public:
   #define PNEW_AND_DELETE_FUNCTIONS8  PNEW_AND_DELETE_FUNCTIONS_ALIGNED(8)
   #define PNEW_AND_DELETE_FUNCTIONS4  PNEW_AND_DELETE_FUNCTIONS_ALIGNED(4)
   #define PNEW_AND_DELETE_FUNCTIONS2  PNEW_AND_DELETE_FUNCTIONS_ALIGNED(2)
-  #define PNEW_AND_DELETE_FUNCTIONS0
+  #if P_MEMORY_ACCOUNTING
+    #define PNEW_AND_DELETE_FUNCTIONS0 PNEW_AND_DELETE_FUNCTIONS_ACCOUNTED
+  #else
+    #define PNEW_AND_DELETE_FUNCTIONS0
+  #endif
   #define PNEW_AND_DELETE_FUNCTIONS(align) PNEW_AND_DELETE_FUNCTIONS##align
 #endif
 
@@ -1765,19 +2043,6 @@ class PSingleton
   {
   };
 
-  #if P_GNU_ALLOCATOR==1
-    template <class Type>
-    struct PFixedPoolAllocator : public PSingleton<__gnu_cxx::__mt_alloc<Type, PCommonPool<Type> > >
-    {
-    };
-  #else
-    #include <ext/bitmap_allocator.h>
-    template <class Type>
-    struct PFixedPoolAllocator : public PSingleton<__gnu_cxx::bitmap_allocator<Type> >
-    {
-    };
-  #endif
-
 #else
 
   template <class Type, class Pool = void>
@@ -1785,12 +2050,93 @@ class PSingleton
   {
   };
 
-  template <class Type>
-  struct PFixedPoolAllocator    : public PSingleton<std::allocator<Type> >
+#endif
+
+
+class PCriticalSection;
+struct PFixedSizePoolThreadCache;
+
+/**Pool of fixed size blocks, shared by all instances of a class declared
+   with PDECLARE_POOL_ALLOCATOR.
+
+   Each thread keeps a small cache of free blocks for each pool, so most
+   allocations and releases take no lock. A thread with an empty cache takes
+   a batch of blocks from the pool's depot, a thread with a full cache gives
+   half of them back, and an exiting thread gives back the lot. The depot
+   gets memory from the heap in chunks, and never returns it.
+
+   Pools are never destroyed, so objects may be released during static
+   destruction at program exit.
+ */
+class PFixedSizePool
+{
+  public:
+    /// Get the pool for a class, creating it on first use.
+    static PFixedSizePool & Get(
+      size_t blockSize,
+      const char * className
+    );
+
+    void * Allocate();
+    void Deallocate(void * ptr);
+
+    /**Statistics for a pool. Counts made in a thread's cache are added in
+       when that thread next uses the depot, so may lag a little.
+      */
+    struct Statistics {
+      const char * m_className;
+      size_t       m_blockSize;
+      PUInt64      m_allocations;  ///< Total blocks allocated
+      PUInt64      m_cacheHits;    ///< Allocations from a thread cache, without locking
+      size_t       m_bytesHeld;    ///< Memory obtained from the heap
+      size_t       m_depotBlocks;  ///< Free blocks in the depot, not in any thread cache
+    };
+    typedef std::vector<Statistics> StatisticsList;
+
+    void GetStatistics(Statistics & stats);
+    static void GetAllStatistics(StatisticsList & stats);
+    static void PrintStatistics(ostream & strm);
+
+  protected:
+    PFixedSizePool(unsigned index, size_t blockSize, const char * className, PCriticalSection & mutex);
+
+    struct Block {
+      Block * m_next;
+    };
+
+    void * Refill(PFixedSizePoolThreadCache & cache);
+    void Flush(PFixedSizePoolThreadCache & cache, unsigned keep);
+    void FlushStatistics(PFixedSizePoolThreadCache & cache);
+    Block * NewChunk();
+
+    unsigned           m_index;
+    size_t             m_blockSize;
+    const char       * m_className;
+    PCriticalSection & m_mutex;
+    Block            * m_depot;
+    size_t             m_depotBlocks;
+    size_t             m_bytesHeld;
+    PUInt64            m_allocations;
+    PUInt64            m_cacheHits;
+
+  private:
+    PFixedSizePool(const PFixedSizePool & other) : m_mutex(other.m_mutex) { }
+    void operator=(const PFixedSizePool &) { }
+
+  friend class PFixedSizePoolCacheFlusher;
+};
+
+
+template <class Type>
+struct PFixedPoolAllocator
+{
+  static PFixedSizePool & Get(const char * className)
   {
-  };
+    static PFixedSizePool & pool = PFixedSizePool::Get(sizeof(Type), className);
+    return pool;
+  }
+};
 
-#endif
 
 #define PDECLARE_POOL_ALLOCATOR() \
     void * operator new(size_t nSize); \
@@ -1798,11 +2144,274 @@ class PSingleton
     void operator delete(void * ptr); \
     void operator delete(void * ptr, const char *, int)
 
+#if PMEMORY_HEAP
+// Memory checking needs to see every object, so the pool is bypassed
 #define PDEFINE_POOL_ALLOCATOR(cls) \
-  void * cls::operator new(size_t)                           { return PFixedPoolAllocator<cls>()->allocate(1);               } \
-  void * cls::operator new(size_t, const char *, int)        { return PFixedPoolAllocator<cls>()->allocate(1);               } \
-  void   cls::operator delete(void * ptr)                    {        PFixedPoolAllocator<cls>()->deallocate((cls *)ptr, 1); } \
-  void   cls::operator delete(void * ptr, const char *, int) {        PFixedPoolAllocator<cls>()->deallocate((cls *)ptr, 1); }
+  void * cls::operator new(size_t nSize)                         { return PMemoryHeap::Allocate(nSize, (const char *)NULL, 0, #cls); } \
+  void * cls::operator new(size_t nSize, const char * file, int line) { return PMemoryHeap::Allocate(nSize, file, line, #cls); } \
+  void   cls::operator delete(void * ptr)                        { PMemoryHeap::Deallocate(ptr, #cls); } \
+  void   cls::operator delete(void * ptr, const char *, int)     { PMemoryHeap::Deallocate(ptr, #cls); }
+#else
+#define PDEFINE_POOL_ALLOCATOR(cls) \
+  void * cls::operator new(size_t)                           { return PFixedPoolAllocator<cls>::Get(#cls).Allocate(); } \
+  void * cls::operator new(size_t, const char *, int)        { return PFixedPoolAllocator<cls>::Get(#cls).Allocate(); } \
+  void   cls::operator delete(void * ptr)                    { PFixedPoolAllocator<cls>::Get(#cls).Deallocate(ptr); } \
+  void   cls::operator delete(void * ptr, const char *, int) { PFixedPoolAllocator<cls>::Get(#cls).Deallocate(ptr); }
+#endif
+
+
+/**Pool of fixed size nodes owned by a single container.
+   Nodes are carved out of blocks, which double in size from MinBlock up to
+   MaxBlock nodes, so nodes added together are adjacent in memory and there
+   is one heap allocation per block rather than per node. Released nodes go
+   on a free list for reuse. When the last node is released the blocks are
+   freed, except when there is only one, which is kept for next time. When
+   the nodes in use drop below a quarter of the pool, blocks that have no
+   nodes in use are returned to the heap, so a container that shrinks does
+   not keep its largest size.
+
+   There is no locking, the container owning the pool must already be
+   protected from concurrent access. The Type must be trivially
+   destructible and need no more than pointer alignment.
+ */
+template <class Type, unsigned MinBlock = 4, unsigned MaxBlock = 256>
+class PNodePool
+{
+  public:
+    PNodePool()
+      : m_freeList(NULL)
+      , m_blocks(NULL)
+      , m_blockSize(0)
+      , m_blockUsed(0)
+      , m_inUse(0)
+      , m_capacity(0)
+      , m_trimBelow(0)
+    { }
+
+    ~PNodePool() { FreeBlocks(); }
+
+    /// Get storage for a node, construct with placement new.
+    void * Allocate()
+    {
+      ++m_inUse;
+
+      Node * node = m_freeList;
+      if (node != NULL) {
+        m_freeList = node->m_next;
+        return node;
+      }
+
+      if (m_blockUsed >= m_blockSize) {
+        unsigned size = m_blockSize == 0 ? MinBlock : (m_blockSize < MaxBlock ? m_blockSize*2 : MaxBlock);
+        Block * block = (Block *)::operator new(sizeof(Block) + (size-1)*sizeof(Node));
+        block->m_next = m_blocks;
+        block->m_size = size;
+        m_blocks = block;
+        m_blockSize = size;
+        m_blockUsed = 0;
+        m_capacity += size;
+        m_trimBelow = m_capacity/4;
+      }
+
+      return &m_blocks->m_nodes[m_blockUsed++];
+    }
+
+    /// Return storage for a node to the pool.
+    void Deallocate(void * ptr)
+    {
+      if (--m_inUse > 0) {
+        Node * node = (Node *)ptr;
+        node->m_next = m_freeList;
+        m_freeList = node;
+        if (m_inUse < m_trimBelow)
+          Trim();
+      }
+      else if (m_blocks != NULL && m_blocks->m_next == NULL) {
+        m_freeList = NULL;
+        m_blockUsed = 0;
+      }
+      else
+        FreeBlocks();
+    }
+
+    /// Number of nodes allocated and not yet released.
+    unsigned GetInUse() const { return m_inUse; }
+
+  protected:
+    void FreeBlocks()
+    {
+      while (m_blocks != NULL) {
+        Block * next = m_blocks->m_next;
+        ::operator delete(m_blocks);
+        m_blocks = next;
+      }
+      m_freeList = NULL;
+      m_blockSize = m_blockUsed = 0;
+      m_capacity = m_trimBelow = 0;
+    }
+
+    union Node {
+      Node * m_next;
+      char   m_storage[sizeof(Type)];
+    };
+    struct Block {
+      Block  * m_next;
+      unsigned m_size;
+      unsigned m_free; // Used by Trim()
+      Node     m_nodes[1];
+    };
+
+    static bool BlockBefore(const Block * a, const Block * b) { return a < b; }
+
+    Block * FindBlock(const std::vector<Block *> & blocks, const Node * node) const
+    {
+      // Last block starting at or before the node
+      return *--std::upper_bound(blocks.begin(), blocks.end(), (Block *)node, BlockBefore);
+    }
+
+    /* Return blocks with no nodes in use to the heap. The current block,
+       which new nodes are carved from, is always kept. */
+    void Trim()
+    {
+      std::vector<Block *> blocks;
+      for (Block * block = m_blocks; block != NULL; block = block->m_next) {
+        block->m_free = 0;
+        blocks.push_back(block);
+      }
+      std::sort(blocks.begin(), blocks.end(), BlockBefore);
+
+      for (Node * node = m_freeList; node != NULL; node = node->m_next)
+        ++FindBlock(blocks, node)->m_free;
+
+      bool anyEmpty = false;
+      for (Block * block = m_blocks->m_next; block != NULL; block = block->m_next) {
+        if (block->m_free == block->m_size) {
+          block->m_free = 0; // Flag for removal
+          anyEmpty = true;
+        }
+        else
+          block->m_free = 1;
+      }
+      m_blocks->m_free = 1;
+
+      if (anyEmpty) {
+        Node ** link = &m_freeList;
+        while (*link != NULL) {
+          if (FindBlock(blocks, *link)->m_free == 0)
+            *link = (*link)->m_next;
+          else
+            link = &(*link)->m_next;
+        }
+
+        Block ** blockLink = &m_blocks->m_next;
+        while (*blockLink != NULL) {
+          Block * block = *blockLink;
+          if (block->m_free != 0)
+            blockLink = &block->m_next;
+          else {
+            *blockLink = block->m_next;
+            m_capacity -= block->m_size;
+            ::operator delete(block);
+          }
+        }
+      }
+
+      // Do not try again until usage has halved, or the pool has grown
+      m_trimBelow = std::min(m_capacity/4, m_inUse/2);
+    }
+
+    Node     * m_freeList;
+    Block    * m_blocks;
+    unsigned   m_blockSize;
+    unsigned   m_blockUsed;
+    unsigned   m_inUse;
+    unsigned   m_capacity;
+    unsigned   m_trimBelow;
+
+  private:
+    PNodePool(const PNodePool &) { }
+    void operator=(const PNodePool &) { }
+};
+
+
+/**Monotonic arena for a group of objects that are created, used and then
+   all thrown away together, such as the tree from parsing a document.
+   Allocation moves a pointer along the current block, blocks come from the
+   heap as needed and are not returned until Release() or destruction.
+
+   Memory for individual objects is never freed, but their destructors must
+   still be called, via Delete(), before the arena is released. Only the
+   heap operations for the objects themselves are saved, anything they
+   allocate internally is freed as usual by the destructor.
+
+   There is no locking, an arena should be used by one thread at a time.
+ */
+class PArena
+{
+  public:
+    enum { Alignment = 16 };  ///< Enough for any fundamental type
+
+    PArena(
+      size_t blockSize = 4096   ///< Size of each block obtained from the heap
+    );
+
+    ~PArena() { Release(); }
+
+    /// Get storage, size is rounded up to a multiple of Alignment.
+    void * Allocate(size_t size)
+    {
+      size = (size + Alignment-1) & ~(size_t)(Alignment-1);
+      m_bytesUsed += size;
+      if (size <= (size_t)(m_end - m_next)) {
+        void * ptr = m_next;
+        m_next += size;
+        return ptr;
+      }
+      return AllocateBlock(size);
+    }
+
+    /// Create an object in the arena.
+    template <class T> T * New()
+      { return new (Allocate(sizeof(T))) T; }
+
+    /// Create an object in the arena, with one constructor argument.
+    template <class T, class Arg> T * New(const Arg & arg)
+      { return new (Allocate(sizeof(T))) T(arg); }
+
+    /// Destroy an object created with New(), the memory is kept until Release().
+    template <class T> static void Delete(T * obj)
+    {
+      if (obj != NULL)
+        obj->~T();
+    }
+
+    /// Return all blocks to the heap. Every object must have been destroyed.
+    void Release();
+
+    /// Total bytes handed out by Allocate() since the last Release().
+    size_t GetBytesUsed() const { return m_bytesUsed; }
+
+    /// Number of blocks obtained from the heap since the last Release().
+    unsigned GetBlockCount() const { return m_blockCount; }
+
+  protected:
+    void * AllocateBlock(size_t size);
+
+    struct Block {
+      Block * m_next;
+    };
+
+    size_t   m_blockSize;
+    Block  * m_blocks;
+    char   * m_next;
+    char   * m_end;
+    size_t   m_bytesUsed;
+    unsigned m_blockCount;
+
+  private:
+    PArena(const PArena &) { }
+    void operator=(const PArena &) { }
+};
 
 
 #define PCLASSINFO_ALIGNED(cls, par, align) \
@@ -131,6 +131,19 @@ class PString : public PCharArray
       const PString & str  ///< String to create new reference to.
     );
 
+#if P_HAS_MOVE_SEMANTICS
+    /**Take over the specified string. The reference count is not changed
+       and the parameter is left as an empty string.
+     */
+    PString(
+      PString && str  ///< String to take over.
+    ) noexcept;
+#endif
+
+    /**Destroy the string.
+     */
+    ~PString() { Destruct(); }
+
     /**Create a new reference to the specified buffer. The string memory is not
        copied, only the pointer to the data.
      */
@@ -371,6 +384,18 @@ class PString : public PCharArray
       const PString & str  ///< New string to assign.
     );
 
+#if P_HAS_MOVE_SEMANTICS
+    /**Take over the string in the <code>str</code> parameter. The reference
+       count is not changed and the parameter is left as an empty string.
+
+       @return
+       reference to the current PString object.
+     */
+    PString & operator=(
+      PString && str  ///< String to take over.
+    ) noexcept;
+#endif
+
     /**Assign the string to the current object. The current instance then
        becomes another reference to the same string in the <code>str</code>
        parameter.
@@ -522,13 +547,10 @@ class PString : public PCharArray
 
     /**Calculate a hash value for use in sets and dictionaries.
     
-       The hash function for strings will produce a value based on the sum of
-       the first three characters of the string. This is a fairly basic
-       function and make no assumptions about the string contents. A user may
-       descend from PString and override the hash function if they can take
-       advantage of the types of strings being used, eg if all strings start
-       with the letter 'A' followed by 'B or 'C' then the current hash function
-       will not perform very well.
+       The hash function for strings is the FNV-1a hash of all the characters
+       of the string, ignoring case. A user may descend from PString and
+       override the hash function if they can take advantage of the types of
+       strings being used.
 
        @return
        hash value for string.
@@ -692,6 +714,31 @@ class PString : public PCharArray
       const PString & str   ///< String to concatenate.
     );
 
+#if P_HAS_MOVE_SEMANTICS
+    /**Concatenate to a temporary string. The buffer of the temporary
+       <code>str</code> is extended and taken over by the result, rather than
+       creating an entirely new string. This is used for chains such as:
+<pre><code>
+          myStr = aStr + ": " + bStr + '!';
+</code></pre>
+
+       @return
+       new string with concatenation of the object and parameter.
+     */
+    friend PString operator+(
+      PString && str,       ///< Temporary string to be concatenated to.
+      const PString & str2  ///< String to concatenate.
+    );
+    friend PString operator+(
+      PString && str,       ///< Temporary string to be concatenated to.
+      const char * cstr     ///< C string to concatenate.
+    );
+    friend PString operator+(
+      PString && str,       ///< Temporary string to be concatenated to.
+      char ch               ///< Character to concatenate.
+    );
+#endif
+
     /**Concatenate a string to another string, modifiying that string.
 
        @return
@@ -820,6 +867,28 @@ class PString : public PCharArray
       const PString & str   ///< String to concatenate.
     );
 
+#if P_HAS_MOVE_SEMANTICS
+    /**Concatenate to a temporary string, with a space. The buffer of the
+       temporary <code>str</code> is extended and taken over by the result,
+       rather than creating an entirely new string.
+
+       @return
+       new string with concatenation of the object and parameter.
+     */
+    friend PString operator&(
+      PString && str,       ///< Temporary string to be concatenated to.
+      const PString & str2  ///< String to concatenate.
+    );
+    friend PString operator&(
+      PString && str,       ///< Temporary string to be concatenated to.
+      const char * cstr     ///< C string to concatenate.
+    );
+    friend PString operator&(
+      PString && str,       ///< Temporary string to be concatenated to.
+      char ch               ///< Character to concatenate.
+    );
+#endif
+
     /**Concatenate a string to another string, modifiying that string.
 
        @return
@@ -1915,11 +1984,22 @@ class PString : public PCharArray
     PString(int dummy, const PString * str);
 
     virtual void AssignContents(const PContainer &);
+#if P_HAS_MOVE_SEMANTICS
+    virtual void MoveContents(PContainer &);
+#endif
     PString(PContainerReference & reference_, PINDEX len)
       : PCharArray(reference_)
       , m_length(len)
       { }
 
+    /* Short strings are held in the same pooled block as their reference,
+       marked by PContainerReference::shortData, so they need no separate heap
+       allocation. They are shared and copied on write like any other. */
+    virtual void DestroyReference();
+    void InternalShare(const PString & str);
+    void InternalSetShortSize(PINDEX newSize);
+    void InternalDetach();
+
   protected:
     mutable PINDEX m_length; // Length of the string, always at least one less than GetSize()
 };
@@ -2133,6 +2213,9 @@ class PConstantString : public ParentString
 
     virtual PBoolean SetSize(PINDEX s) { return s <= this->m_length+1; }
     virtual void AssignContents(const PContainer &) { PAssertAlways(PInvalidParameter); }
+#if P_HAS_MOVE_SEMANTICS
+    virtual void MoveContents(PContainer &) { PAssertAlways(PInvalidParameter); }
+#endif
     virtual void DestroyReference() { this->reference = NULL; }
 
   private:
@@ -2171,7 +2254,10 @@ class PStringStream : public PString, public std::iostream
     /**Create a new, empty, string stream. Data may be output to this stream,
        but attempts to input from it will return end of file.
 
-       The internal string is continually grown as required during output.
+       The internal string is continually grown as required during output,
+       doubling in size each time so building large strings is not quadratic.
+       If the final size is known, Reserve() may be used to avoid reallocations
+       entirely.
      */
     PStringStream();
 
@@ -2271,8 +2357,38 @@ class PStringStream : public PString, public std::iostream
 
     virtual PINDEX GetLength() const;
 
+    /**Make sure the string buffer can hold at least \p capacity characters
+       without any further memory reallocations. The buffer is never made
+       smaller by this function.
+
+       @return
+       true if new memory block successfully allocated.
+     */
+    bool Reserve(
+      PINDEX capacity   ///< Minimum number of characters to allow for
+    );
+
+    /**Get the number of characters the string buffer can currently hold
+       before it must be grown.
+     */
+    PINDEX GetCapacity() const { return GetSize()-1; }
+
+    /**Set the actual memory block array size to the minimum required to hold
+       the current string contents. This is typically called when all output
+       to the stream is complete, to release the spare space left by the
+       geometric growth of the buffer. The stream read/write positions are
+       preserved.
+
+       @return
+       true if new memory block successfully re-allocated.
+     */
+    PBoolean MakeMinimumSize();
+
   protected:
     virtual void AssignContents(const PContainer & cont);
+#if P_HAS_MOVE_SEMANTICS
+    virtual void MoveContents(PContainer & cont) { AssignContents(cont); }
+#endif
 
   private:
     PStringStream(int, const PStringStream &)
@@ -2290,6 +2406,8 @@ class PStringStream : public PString, public std::iostream
         virtual int sync();
         virtual pos_type seekoff(std::streamoff, ios_base::seekdir, ios_base::openmode = ios_base::in | ios_base::out);
         virtual pos_type seekpos(pos_type, ios_base::openmode = ios_base::in | ios_base::out);
+        bool SetBufferSize(PINDEX size);
+        PINDEX GetWritePosition() const { return (PINDEX)(pptr() - pbase()); }
         PCharArray & string;
         PBoolean     fixedBufferSize;
     };
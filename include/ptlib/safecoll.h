@@ -248,7 +248,7 @@ class PSafeObject : public PObject
        Note this returns the value outside of any mutexes, so it could change
        at any moment. Care must be exercised in its use.
       */
-    unsigned IsSafelyBeingRemoved() const { return m_safelyBeingRemoved; }
+    unsigned IsSafelyBeingRemoved() const { return (m_safeState.load() & SafeRemovedFlag) != 0; }
 
     /**Determine if the object can be safely deleted.
        This determines if the object has been flagged for deletion and all
@@ -276,13 +276,17 @@ class PSafeObject : public PObject
        Note this returns the value outside of any mutexes, so it could change
        at any moment. Care must be exercised in its use.
       */
-    unsigned GetSafeReferenceCount() const { return m_safeReferenceCount; }
+    unsigned GetSafeReferenceCount() const { return m_safeState.load() & ~SafeRemovedFlag; }
   //@}
 
   private:
+    void InternalSetSafelyBeingRemoved(bool removed);
+
+    /* Reference count and "being removed" flag share one word so both can be
+       changed with a single compare and exchange, without a mutex. */
+    enum { SafeRemovedFlag = 0x80000000U };
+    atomic<uint32_t>  m_safeState;
     mutable PMutex    m_safetyMutex;
-    unsigned          m_safeReferenceCount;
-    bool              m_safelyBeingRemoved;
     PReadWriteMutex   m_safeInUseMutex;
     PReadWriteMutex * m_safeInUse;
 
@@ -542,6 +542,114 @@ class PSocket : public PChannel
 };
 
 
+/**Persistent readiness monitor for a large number of sockets.
+   Unlike PSocket::Select(), where the lists are rebuilt on every call,
+   sockets are registered once with Add() and stay registered until
+   Remove() is called. On Linux this is backed by epoll, so the cost of a
+   wait is proportional to the number of ready sockets, not the number of
+   registered ones. Other platforms fall back to PSocket::Select().
+
+   When a registered socket has data available to read, its notifier is
+   called from the thread executing Process(), which is typically the
+   internal thread started by Start(). Notifiers should not block, and must
+   read the data, or Remove() the socket, as readiness is level triggered.
+
+   A socket must be removed from the reactor before it is closed.
+  */
+class PSocketReactor : public PObject
+{
+    PCLASSINFO(PSocketReactor, PObject);
+  public:
+    #define PDECLARE_SocketReactorNotifier(cls, fn) PDECLARE_NOTIFIER2(PSocketReactor, cls, fn, PSocket &)
+    typedef PNotifierTemplate<PSocket &> Notifier;
+
+    PSocketReactor();
+    ~PSocketReactor();
+
+    /**Register a socket for read readiness callbacks.
+       If the socket is already registered, its notifier is replaced. An
+       entry left by a different socket that was closed without Remove(),
+       and whose handle has been reused, is replaced.
+      */
+    bool Add(
+      PSocket & socket,           ///< Socket to monitor
+      const Notifier & notifier   ///< Called when socket is readable
+    );
+
+    /**Unregister a socket.
+       On return the notifier for the socket is guaranteed not to be
+       executing, unless called from within that notifier. This is a lookup
+       by handle, but if the socket is already closed all entries are
+       searched.
+      */
+    bool Remove(
+      PSocket & socket            ///< Socket to stop monitoring
+    );
+
+    /// Get the number of registered sockets.
+    PINDEX GetSize() const;
+
+    /**Wait for registered sockets to become readable, and return them.
+       Notifiers are not called. This is the equivalent of PSocket::Select()
+       for the full set of registered sockets.
+
+       @return NoError if sockets were ready or timed out, with \p ready
+               empty in the latter case, Interrupted if Interrupt() was
+               called.
+      */
+    PChannel::Errors Select(
+      PSocket::SelectList & ready,  ///< Sockets that are readable
+      const PTimeInterval & timeout = PMaxTimeInterval ///< Time to wait
+    );
+
+    /**Wait for registered sockets to become readable and call their notifiers.
+       @return as for Select().
+      */
+    PChannel::Errors Process(
+      const PTimeInterval & timeout = PMaxTimeInterval ///< Time to wait
+    );
+
+    /// Break a Select() or Process() that is waiting.
+    void Interrupt();
+
+    /**Start an internal thread that calls Process() until Stop().
+      */
+    bool Start(
+      const char * threadName = "SocketReactor",
+      PThread::Priority priority = PThread::NormalPriority
+    );
+
+    /// Stop internal thread started with Start().
+    void Stop();
+
+    /// Indicate internal thread is running.
+    bool IsRunning() const { return m_thread != NULL; }
+
+  protected:
+    void InternalWait(std::vector<int> & handles, const PTimeInterval & timeout, PChannel::Errors & error);
+    void ThreadMain();
+
+    struct Entry
+    {
+      Entry(PSocket * socket = NULL, const Notifier & notifier = NULL) : m_socket(socket), m_notifier(notifier) { }
+      PSocket * m_socket;
+      Notifier  m_notifier;
+    };
+    typedef std::map<int, Entry> EntryMap;
+    EntryMap          m_entries;
+    mutable PMutex    m_mutex;
+    PMutex            m_dispatchMutex;
+    PThread         * m_thread;
+    atomic<bool>      m_running;
+    atomic<bool>      m_interrupted;
+#if P_HAS_EPOLL
+    int               m_epoll;
+    int               m_interruptPipe[2];
+#endif
+};
+
+
+
 #endif // PTLIB_SOCKET_H
 
 
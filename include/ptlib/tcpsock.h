@@ -39,6 +39,9 @@
 #endif
 
 
+class PFile;
+
+
 /** A socket that uses the TCP transport on the Internet Protocol.
  */
 class PTCPSocket : public PIPSocket
@@ -154,6 +157,23 @@ class PTCPSocket : public PIPSocket
       PINDEX len          ///< Number of bytes pointed to by <code>buf</code>.
     );
 
+    /** Write part of a file to the TCP/IP stream. Where the platform allows,
+       the data goes directly from the file to the socket within the kernel,
+       e.g. sendfile(), without being copied through user space. Otherwise
+       it is read from the file and written in blocks.
+
+       This is subject to the write timeout. The file position may or may not
+       be changed.
+
+       @return
+       true if all the bytes were sucessfully written.
+     */
+    virtual bool SendFile(
+      PFile & file,       ///< Open file to send data from.
+      off_t offset,       ///< Position in file to start from.
+      off_t length        ///< Number of bytes to send.
+    );
+
     /** This is callback function called by the system whenever out of band data
        from the TCP/IP stream is received. A descendent class may interpret
        this data according to the semantics of the high level protocol.
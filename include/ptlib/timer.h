@@ -344,10 +344,10 @@ class PTimer : public PTimeInterval
         // Create a new timer list
         List();
 
-        /* Decrement all the created timers and dispatch to their callback
-           functions if they have expired. The <code>PTimer::Tick()</code> function
-           value is used to determine the time elapsed since the last call to
-           Process().
+        /* Dispatch all timers that have expired to their callback functions.
+           The <code>PTimer::Tick()</code> function value is used to determine
+           which timers have expired. Timers are kept ordered by their expiry
+           time, so only the expired timers are visited, not the whole list.
 
            The return value is the number of milliseconds until the next timer
            needs to be dispatched. The function need not be called again for this
@@ -370,8 +370,16 @@ class PTimer : public PTimeInterval
         };
         PQueuedThreadPool<Timeout> m_threadPool;
 
+        void InternalAdd(PTimer & timer);
+        bool InternalRemove(PTimer & timer);
+
         typedef std::map<PIdGenerator::Handle, PTimer *> TimerMap;
         TimerMap m_timers;
+
+        // Running timers ordered by absolute expiry time, handle disambiguates
+        typedef std::pair<PTimeInterval, PIdGenerator::Handle> ExpiryKey;
+        typedef std::set<ExpiryKey> ExpirySet;
+        ExpirySet m_expiries;
         PCriticalSection m_timersMutex;
 #if PTRACING
         size_t m_highWaterMark;
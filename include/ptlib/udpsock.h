@@ -87,6 +87,12 @@ class PUDPSocket : public PIPDatagramSocket
       PINDEX len        ///< Number of bytes to write.
     );
 
+    /** Override of PIPDatagramSocket function to set last receive address
+     */
+    virtual bool ReadFromMulti(
+      Datagrams & datagrams   ///< Datagrams to read
+    );
+
     /** Override of PSocket functions to allow connectionless writes
      */
     PBoolean Connect(
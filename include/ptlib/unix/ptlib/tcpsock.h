@@ -37,4 +37,9 @@
   public:
     virtual PBoolean Read(void * buf, PINDEX len);
 
+#if P_HAS_SENDFILE
+  protected:
+    bool os_sendfile(PFile & file, off_t & offset, off_t & length);
+#endif
+
 // End Of File ////////////////////////////////////////////////////////////////
@@ -42,8 +42,11 @@ class HTTPTest : public PProcess
     PCLASSINFO(HTTPTest, PProcess)
   public:
     void Main();
+    void RepeatGet(PString url);
 
     PQueuedThreadPool<HTTPConnection> m_pool;
+    unsigned m_repeat;
+    PAtomicInteger m_failed;
 };
 
 PCREATE_PROCESS(HTTPTest)
@@ -54,7 +57,10 @@ void HTTPTest::Main()
   PArgList & args = GetArguments();
   args.Parse("h-help.    print this help message.\n"
              "G.         do a GET\n"
-             "P.         do a PUT"
+             "r-repeat:  repeat GET this many times, each with a new client.\n"
+             "c-clients: number of threads doing repeated GET (default 1).\n"
+             "-no-pool.  do not reuse connections between clients.\n"
+             "P.         do a PUT\n"
              "p-port:    port number to listen on(default 80 or 443).\n"
 #if P_SSL
              "s-secure.     SSL/TLS mode.\n"
@@ -79,6 +85,29 @@ void HTTPTest::Main()
       cerr << args.Usage("url");
       return;
     }
+
+    if (args.HasOption('r')) {
+      m_repeat = args.GetOptionAs('r', 1U);
+      if (args.HasOption("no-pool"))
+        PHTTPClient::SetConnectionPoolLimits(0, 0);
+
+      std::vector<PThread *> clients(std::max(args.GetOptionAs('c', 1U), 1U));
+      PTime start;
+      for (size_t i = 0; i < clients.size(); ++i)
+        clients[i] = new PThreadObj1Arg<HTTPTest, PString>(*this, args[0], &HTTPTest::RepeatGet, false, "Client");
+      for (size_t i = 0; i < clients.size(); ++i) {
+        clients[i]->WaitForTermination();
+        delete clients[i];
+      }
+      PTimeInterval elapsed = PTime() - start;
+
+      unsigned total = m_repeat*clients.size();
+      cout << total << " requests in " << elapsed << "s, "
+           << (total*1000/std::max(elapsed.GetMilliSeconds(), (PInt64)1)) << " requests/s, "
+           << m_failed << " failed" << endl;
+      return;
+    }
+
     PString str;
     PHTTPClient client;
     if (client.GetTextDocument(args[0], str))
@@ -128,6 +157,7 @@ void HTTPTest::Main()
 
   PHTTPSpace httpNameSpace;
   httpNameSpace.AddResource(new PHTTPString("index.html", "Hello", "text/plain"));
+  httpNameSpace.AddResource(new PHTTPHistogramResource("histograms"));
 
   cout << "Listening for "
 #if P_SSL
@@ -156,6 +186,17 @@ void HTTPTest::Main()
 }
 
 
+void HTTPTest::RepeatGet(PString url)
+{
+  for (unsigned i = 0; i < m_repeat; ++i) {
+    PString str;
+    PHTTPClient client;
+    if (!client.GetTextDocument(url, str))
+      ++m_failed;
+  }
+}
+
+
 void HTTPConnection::Work()
 {
   PTRACE(3, "HTTPTest\tStarted work on " << m_socket.GetPeerAddress());
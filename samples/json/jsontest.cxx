@@ -19,9 +19,67 @@ JSONTest::JSONTest()
 {
 }
 
+
+// Something like a typical REST response, about 10k
+static PString MakeDocument()
+{
+  PJSON json(PJSON::e_Array);
+  PJSON::Array & arr = json.GetArray();
+  for (unsigned i = 0; i < 80; ++i) {
+    PJSON::Object & obj = arr.AppendObject();
+    obj.SetNumber("id", i);
+    obj.SetString("name", psprintf("user%u", i));
+    obj.SetString("email", psprintf("user%u@example.com", i));
+    obj.SetBoolean("active", (i&1) != 0);
+    obj.SetNumber("score", i*1.5);
+    PJSON::Array & tags = obj.SetArray("tags");
+    tags.AppendString("alpha");
+    tags.AppendString("beta");
+    tags.AppendNumber(i*3);
+    obj.Set("manager", PJSON::e_Null);
+  }
+  return json.AsString();
+}
+
+
+static void Benchmark()
+{
+  static const unsigned Count = 5000;
+  PString doc = MakeDocument();
+  cout << "Parsing and destroying " << doc.GetLength() << " byte document " << Count << " times" << endl;
+
+  PTime start;
+  for (unsigned i = 0; i < Count; ++i) {
+    PJSON json(doc);
+    if (!json.IsValid())
+      cout << "Parse failed!" << endl;
+  }
+  PTimeInterval heap = PTime() - start;
+  cout << "Heap:  " << heap << "s, " << (Count*1000/heap.GetMilliSeconds()) << " documents/s" << endl;
+
+  PArena arena(16384);
+  start.SetCurrentTime();
+  for (unsigned i = 0; i < Count; ++i) {
+    {
+      PJSON json(doc, &arena);
+      if (!json.IsValid())
+        cout << "Parse failed!" << endl;
+    }
+    arena.Release();
+  }
+  PTimeInterval arenaTime = PTime() - start;
+  cout << "Arena: " << arenaTime << "s, " << (Count*1000/arenaTime.GetMilliSeconds()) << " documents/s" << endl;
+}
+
+
 void JSONTest::Main()
 {
   PArgList & args = GetArguments();
+  if (args.GetCount() > 0 && args[0] == "--benchmark") {
+    Benchmark();
+    return;
+  }
+
   if (args.GetCount() > 0) {
     PJSON json;
     if (args[0] == "-")
@@ -59,5 +117,10 @@ void JSONTest::Main()
 
   PJSON json4(json1.AsString());
   cout << json4 << endl;
+
+  PArena arena;
+  PJSON json5(json1.AsString(), &arena);
+  json5.GetObject().GetArray("four").AppendString("arena");
+  cout << json5 << endl;
 }
 
@@ -21,6 +21,8 @@
 
 #include <vector>
 #include <map>
+#include <list>
+#include <set>
 
 using namespace std;
 
@@ -99,6 +101,30 @@ Structure       Insert  Lookup  Iterate  Remove
 String Keys      5,000  10,000  Never!   5,000
 Integer Keys     1,000  10.000  Never!   1,000
 
+The above was with a fixed size hash table. Now that the dictionary grows its
+hash table as elements are added, it is faster than the map for all sizes,
+the --large option tests up to a million elements:
+
+Running 1000000 lookups, 1 iterates, over map/dictionary with 1000000 elements.
+Structure               Insert    Lookup   Iterate    Remove
+String Map            0:03.087  0:03.067  0:00.000  0:02.819
+String Dictionary     0:00.891  0:00.465  0:00.235  0:00.436
+Integer Map           0:01.011  0:01.361  0:00.000  0:01.229
+Integer Dictionary    0:00.515  0:00.193  0:00.202  0:00.241
+
+The --lists option also compares PList and PSortedList against std::list and
+std::multiset. The list nodes come from a pool owned by each list, so removing
+everything, or destroying the list, is cheap. The Index column is a loop over
+every element using operator[], which the list makes linear by remembering
+the last element accessed:
+
+Running 10 lookups, 10 iterates, over map/dictionary with 200000 elements.
+List                    Insert     Index   Iterate    Remove
+std::list             0:00.004            0:00.000  0:00.003
+PList                 0:00.004  0:00.007  0:00.000  0:00.002
+std::multiset         0:00.416            0:00.000  0:00.332
+PSortedList           0:00.379  0:00.060  0:00.352  0:00.380
+
 */
 
 /**This class is the core of the thing. It is placed in the structure
@@ -144,7 +170,7 @@ class Tester
 
     virtual const char * GetName() const = 0;
     virtual void TestInsert() const = 0;
-    virtual void TestLookup() const = 0;
+    virtual bool TestLookup(PINDEX i) const = 0;
     virtual void TestIterate() const = 0;
     virtual void TestRemove() const = 0;
 };
@@ -164,9 +190,9 @@ class StringMap : public Tester
         data.insert(Type::value_type(StringKeys[i], &DataElements[i]));
     }
 
-    virtual void TestLookup() const
+    virtual bool TestLookup(PINDEX i) const
     {
-      data.find(StringKeys[StringKeys.size()/2]);
+      return data.find(StringKeys[i%StringKeys.size()]) != data.end();
     }
 
     virtual void TestIterate() const
@@ -199,9 +225,9 @@ class StringDict : public Tester
         data.Insert(StringKeys[i], &DataElements[i]);
     }
 
-    virtual void TestLookup() const
+    virtual bool TestLookup(PINDEX i) const
     {
-      data.GetAt(StringKeys[StringKeys.size()/2]);
+      return data.GetAt(StringKeys[i%StringKeys.size()]) != NULL;
     }
 
     virtual void TestIterate() const
@@ -236,9 +262,9 @@ class IntMap : public Tester
         data.insert(Type::value_type(IntKeys[i], &DataElements[i]));
     }
 
-    virtual void TestLookup() const
+    virtual bool TestLookup(PINDEX i) const
     {
-      data.find(IntKeys[IntKeys.size()/2]);
+      return data.find(IntKeys[i%IntKeys.size()]) != data.end();
     }
 
     virtual void TestIterate() const
@@ -270,9 +296,9 @@ class IntDict : public Tester
         data.Insert(POrdinalKey(IntKeys[i]), &DataElements[i]);
     }
 
-    virtual void TestLookup() const
+    virtual bool TestLookup(PINDEX i) const
     {
-      data.GetAt(IntKeys[IntKeys.size()/2]);
+      return data.GetAt(IntKeys[i%IntKeys.size()]) != NULL;
     }
 
     virtual void TestIterate() const
@@ -294,6 +320,157 @@ class IntDict : public Tester
 };
 
 
+/**Lists are tested separately, as lookups are not what they are for. The
+   elements are allocated outside the timing, so it is the list nodes that
+   are being measured. */
+class ListTester
+{
+  public:
+    virtual ~ListTester() { }
+
+    virtual const char * GetName() const = 0;
+    virtual void TestInsert() const = 0;
+    virtual bool TestIndex() const { return false; }
+    virtual void TestIterate() const = 0;
+    virtual void TestRemove() const = 0;
+};
+
+
+class StdList : public ListTester
+{
+    typedef std::list<Element *> Type;
+    mutable Type data;
+
+  public:
+    virtual const char * GetName() const { return "std::list"; }
+
+    virtual void TestInsert() const
+    {
+      for (size_t i = 0; i < DataElements.size(); i++)
+        data.push_back(&DataElements[i]);
+    }
+
+    virtual void TestIterate() const
+    {
+      for (Type::iterator it = data.begin(); it != data.end(); ++it)
+        DoNothing(0, **it);
+    }
+
+    virtual void TestRemove() const
+    {
+      while (!data.empty())
+        data.pop_front();
+    }
+};
+
+
+class PTLibList : public ListTester
+{
+    typedef PList<Element> Type;
+    mutable Type data;
+
+  public:
+    PTLibList() { data.DisallowDeleteObjects(); }
+
+    virtual const char * GetName() const { return "PList"; }
+
+    virtual void TestInsert() const
+    {
+      for (size_t i = 0; i < DataElements.size(); i++)
+        data.Append(&DataElements[i]);
+    }
+
+    virtual bool TestIndex() const
+    {
+      for (PINDEX i = 0; i < data.GetSize(); i++)
+        DoNothing(0, data[i]);
+      return true;
+    }
+
+    virtual void TestIterate() const
+    {
+      for (Type::iterator it = data.begin(); it != data.end(); ++it)
+        DoNothing(0, *it);
+    }
+
+    virtual void TestRemove() const
+    {
+      while (!data.IsEmpty())
+        data.RemoveHead();
+    }
+};
+
+
+struct PStringPtrLess
+{
+  bool operator()(const PString * s1, const PString * s2) const { return *s1 < *s2; }
+};
+
+class StdMultiSet : public ListTester
+{
+    typedef std::multiset<PString *, PStringPtrLess> Type;
+    mutable Type data;
+
+  public:
+    virtual const char * GetName() const { return "std::multiset"; }
+
+    virtual void TestInsert() const
+    {
+      for (size_t i = 0; i < StringKeys.size(); i++)
+        data.insert(&StringKeys[i]);
+    }
+
+    virtual void TestIterate() const
+    {
+      for (Type::iterator it = data.begin(); it != data.end(); ++it)
+        DoNothing(**it, DataElements[0]);
+    }
+
+    virtual void TestRemove() const
+    {
+      for (size_t i = 0; i < StringKeys.size(); i++)
+        data.erase(data.find(&StringKeys[i]));
+    }
+};
+
+
+class PTLibSortedList : public ListTester
+{
+    typedef PSortedList<PString> Type;
+    mutable Type data;
+
+  public:
+    PTLibSortedList() { data.DisallowDeleteObjects(); }
+
+    virtual const char * GetName() const { return "PSortedList"; }
+
+    virtual void TestInsert() const
+    {
+      for (size_t i = 0; i < StringKeys.size(); i++)
+        data.Append(&StringKeys[i]);
+    }
+
+    virtual bool TestIndex() const
+    {
+      for (PINDEX i = 0; i < data.GetSize(); i++)
+        DoNothing(data[i], DataElements[0]);
+      return true;
+    }
+
+    virtual void TestIterate() const
+    {
+      for (Type::iterator it = data.begin(); it != data.end(); ++it)
+        DoNothing(*it, DataElements[0]);
+    }
+
+    virtual void TestRemove() const
+    {
+      for (size_t i = 0; i < StringKeys.size(); i++)
+        data.Remove(&StringKeys[i]);
+    }
+};
+
+
 /**This is where all the activity happens. This class is launched on
    program startup, and does timing runs on the map and dictionaries
    to see which is faster */
@@ -310,8 +487,10 @@ class MapDictionary : public PProcess
     void Main();
     void TestAll();
     void Test(const Tester & tester);
+    void Test(const ListTester & tester);
 
   protected:
+    bool m_lists;
     int m_size;
     int m_lookups;
     int m_iterates;
@@ -328,6 +507,8 @@ void MapDictionary::Main()
              "i-iterates:"
 	     "s-size:"
              "-preset."
+             "-large."
+             "-lists."
 	     "h-help."
 #if PTRACING
              "o-output:"
@@ -341,6 +522,9 @@ void MapDictionary::Main()
          << "     -l --lookups #  : count of lookup to run over the map/dicts (10000)\n"
          << "     -i --iterates # : count of iterates to run over the map/dicts (1000)\n"
 	 << "     -s --size  #    : number of elements to pu in map/dict (200)\n"
+         << "     --preset        : run a preset series of sizes up to 50000\n"
+         << "     --large         : run a preset series of sizes up to 1000000\n"
+         << "     --lists         : also test PList and PSortedList against STL\n"
 	 << "     -h --help       : Get this help message\n"
 	 << "     -v --version    : Get version information\n"
 #if PTRACING
@@ -369,6 +553,8 @@ void MapDictionary::Main()
          PTrace::Blocks | PTrace::Timestamp | PTrace::Thread | PTrace::FileAndLine);
 #endif
 
+  m_lists = args.HasOption("lists");
+
   if (args.HasOption("preset")) {
     m_size = 20;    m_lookups = 100000; m_iterates = 10000; TestAll();
     m_size = 100;   m_lookups = 50000;  m_iterates = 5000;  TestAll();
@@ -379,6 +565,13 @@ void MapDictionary::Main()
     return;
   }
 
+  if (args.HasOption("large")) {
+    m_size = 1000;    m_lookups = 1000000; m_iterates = 100; TestAll();
+    m_size = 100000;  m_lookups = 1000000; m_iterates = 10;  TestAll();
+    m_size = 1000000; m_lookups = 1000000; m_iterates = 1;   TestAll();
+    return;
+  }
+
   if ((m_size = args.GetOptionString('s', "200").AsInteger()) <= 0) {
     cerr << "Illegal number of size\n";
     return;
@@ -424,6 +617,20 @@ void MapDictionary::TestAll()
   Test(IntMap());
   Test(IntDict());
   cout << endl;
+
+  if (m_lists) {
+    cout << setw(20) << left << "List" << right
+         << setw(10) << "Insert"
+         << setw(10) << "Index"
+         << setw(10) << "Iterate"
+         << setw(10) << "Remove"
+         << endl;
+    Test(StdList());
+    Test(PTLibList());
+    Test(StdMultiSet());
+    Test(PTLibSortedList());
+    cout << endl;
+  }
 }
 
 
@@ -433,8 +640,11 @@ void MapDictionary::Test(const Tester & tester)
   tester.TestInsert();
 
   PTime b;
-  for (PINDEX i = 0; i < m_lookups; i++)
-    tester.TestLookup();
+  PINDEX found = 0;
+  for (PINDEX i = 0; i < m_lookups; i++) {
+    if (tester.TestLookup(i))
+      ++found;
+  }
 
   PTime c;
   for (PINDEX i = 0; i < m_iterates; i++)
@@ -449,6 +659,37 @@ void MapDictionary::Test(const Tester & tester)
        << setw(10) << (b-a)
        << setw(10) << (c-b)
        << setw(10) << (d-c)
+       << setw(10) << (e-d);
+  if (found != m_lookups)
+    cout << "  (" << m_lookups-found << " lookups failed)";
+  cout << endl;
+}
+
+
+void MapDictionary::Test(const ListTester & tester)
+{
+  PTime a;
+  tester.TestInsert();
+
+  PTime b;
+  bool indexed = tester.TestIndex();
+
+  PTime c;
+  for (PINDEX i = 0; i < m_iterates; i++)
+    tester.TestIterate();
+
+  PTime d;
+  tester.TestRemove();
+
+  PTime e;
+
+  cout << setw(20) << left << tester.GetName() << right
+       << setw(10) << (b-a);
+  if (indexed)
+    cout << setw(10) << (c-b);
+  else
+    cout << setw(10) << "";
+  cout << setw(10) << (d-c)
        << setw(10) << (e-d)
        << endl;
 }
@@ -0,0 +1,166 @@
+/*
+ * main.cxx
+ *
+ * Benchmark of PDECLARE_POOL_ALLOCATOR against the plain heap.
+ *
+ * Portable Tools Library
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.0 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is Portable Tools Library.
+ *
+ * $Revision$
+ * $Author$
+ * $Date$
+ */
+
+/*
+ * Each thread keeps a set of live objects and repeatedly deletes one at
+ * random and creates a replacement, as a container or call object would.
+ * Some of the replacements are swapped through a shared table with another
+ * thread, so objects are often deleted by a different thread from the one
+ * that created them. The time per new/delete pair is shown for a class using
+ * the pool allocator and for the same size class using the normal heap.
+ */
+
+#include <ptlib.h>
+#include <ptlib/pprocess.h>
+#include <ptclib/random.h>
+
+
+struct PooledObject
+{
+  char m_data[48];
+  PDECLARE_POOL_ALLOCATOR();
+};
+
+PDEFINE_POOL_ALLOCATOR(PooledObject);
+
+
+struct HeapObject
+{
+  char m_data[48];
+};
+
+
+class PoolAllocTest : public PProcess
+{
+  PCLASSINFO(PoolAllocTest, PProcess)
+  public:
+    void Main();
+
+  protected:
+    template <class Obj> void Benchmark(const char * name, unsigned threads);
+    template <class Obj> void Churn(atomic<Obj *> * shared);
+
+    unsigned m_count;
+    unsigned m_live;
+    unsigned m_sharedPercent;
+};
+
+PCREATE_PROCESS(PoolAllocTest);
+
+
+static const unsigned SharedSlots = 256;
+
+
+void PoolAllocTest::Main()
+{
+  cout << "Pool Allocator Benchmark" << endl;
+
+  PArgList & args = GetArguments();
+  args.Parse("n-count: Number of new/delete pairs per thread, default 2000000\n"
+             "l-live: Number of live objects per thread, default 1000\n"
+             "s-shared: Percentage of objects exchanged with other threads, default 10\n"
+             "m-max-threads: Maximum number of threads, default 8\n"
+             PTRACE_ARGLIST);
+
+  if (!args.IsParsed()) {
+    cerr << args.Usage();
+    return;
+  }
+
+  PTRACE_INITIALISE(args);
+
+  m_count = args.GetOptionAs('n', 2000000U);
+  m_live = std::max(args.GetOptionAs('l', 1000U), 1U);
+  m_sharedPercent = args.GetOptionAs('s', 10U);
+  unsigned maxThreads = args.GetOptionAs('m', 8U);
+
+  cout << m_count << " operations per thread, "
+       << m_live << " live objects per thread, "
+       << m_sharedPercent << "% exchanged between threads" << endl;
+
+  for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+    Benchmark<HeapObject>("Heap", threads);
+    Benchmark<PooledObject>("Pool", threads);
+  }
+
+  cout << '\n';
+  PFixedSizePool::PrintStatistics(cout);
+}
+
+
+template <class Obj>
+void PoolAllocTest::Benchmark(const char * name, unsigned threads)
+{
+  std::vector< atomic<Obj *> > shared(SharedSlots);
+  for (size_t i = 0; i < shared.size(); ++i)
+    shared[i] = NULL;
+
+  std::vector<PThread *> workers;
+  PTime start;
+  for (unsigned i = 0; i < threads; ++i)
+    workers.push_back(new PThreadObj1Arg<PoolAllocTest, atomic<Obj *> *>(*this, shared.data(),
+                                                  &PoolAllocTest::Churn<Obj>, false, "Churn"));
+  for (size_t i = 0; i < workers.size(); ++i) {
+    workers[i]->WaitForTermination();
+    delete workers[i];
+  }
+  PTimeInterval elapsed = PTime() - start;
+
+  for (size_t i = 0; i < shared.size(); ++i)
+    delete shared[i].load();
+
+  cout << name << ' ' << threads << " thread" << (threads > 1 ? "s: " : ":  ")
+       << setw(6) << (elapsed.GetMilliSeconds()*1000000/m_count) << " ns/op" << endl;
+}
+
+
+template <class Obj>
+void PoolAllocTest::Churn(atomic<Obj *> * shared)
+{
+  PRandom random;
+  std::vector<Obj *> live(m_live);
+  for (size_t i = 0; i < live.size(); ++i)
+    live[i] = new Obj;
+
+  for (unsigned i = 0; i < m_count; ++i) {
+    // One random number per operation, so the generator does not swamp the allocator
+    uint32_t r = random.Generate();
+    unsigned slot = (r & 0xffff) % m_live;
+    if ((r >> 16) % 100 < m_sharedPercent)
+      live[slot] = shared[(r >> 24) % SharedSlots].exchange(live[slot]);
+    else {
+      delete live[slot];
+      live[slot] = new Obj;
+    }
+    if (live[slot] == NULL)
+      live[slot] = new Obj;
+    live[slot]->m_data[0] = (char)i;
+  }
+
+  for (size_t i = 0; i < live.size(); ++i)
+    delete live[i];
+}
+
+
+// End of File ///////////////////////////////////////////////////////////////
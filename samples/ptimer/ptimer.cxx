@@ -217,6 +217,7 @@ protected:
   void MultiTimerTest();
   void LongOnTimeoutTest();
   void MassStopTest();
+  void ScaleTest(unsigned count);
   void StartStopTest();
   void PullCheck();
   void CallbackCheck();
@@ -279,6 +280,7 @@ void PTimerTest::Main()
              "r-restart.   A test which repeatedly restarts two internal timers.\n"
              "x-stress.    A test create 10 timers and change it repeatedly from 1000 threads\n"
              "g-stoptest.  Measure Stop() time for many timers.\n"
+             "b-bench:     Measure start/process/stop cost for N concurrent timers (e.g. 100000).\n"
              PTRACE_ARGLIST
   );
   PTRACE_INITIALISE(args);
@@ -293,6 +295,11 @@ void PTimerTest::Main()
     return;
   }
 
+  if (args.HasOption('b')) {
+    ScaleTest(args.GetOptionAs('b', 100000U));
+    return;
+  }
+
   PullCheck();
   CallbackCheck();
   StartStopTest();
@@ -883,6 +890,83 @@ void PTimerTest::MassStopTest()
 
 ////////////////////////////////////////////////////////////////////////////////
 
+class ScaleTimer : public PTimer
+{
+  PAtomicInteger & m_firedCount;
+  PAtomicInteger & m_latenessSum;
+  public:
+    PTimeInterval m_expected;
+
+    ScaleTimer(PAtomicInteger & firedCount, PAtomicInteger & latenessSum)
+      : m_firedCount(firedCount)
+      , m_latenessSum(latenessSum)
+    {
+    }
+    ~ScaleTimer()
+    {
+      Stop();
+    }
+    void Start(const PTimeInterval & interval)
+    {
+      m_expected = PTimer::Tick() + interval;
+      SetInterval(interval.GetMilliSeconds());
+    }
+    void OnTimeout()
+    {
+      m_latenessSum += (PTimer::Tick() - m_expected).GetMilliSeconds();
+      ++m_firedCount;
+    }
+};
+
+void PTimerTest::ScaleTest(unsigned count)
+{
+  cout << "Scale test with " << count << " concurrent timers." << endl;
+
+  PAtomicInteger firedCount, latenessSum;
+  std::vector<ScaleTimer *> timers(count);
+  for (unsigned i = 0; i < count; ++i)
+    timers[i] = new ScaleTimer(firedCount, latenessSum);
+
+  // Far future timers, so Process() has nothing to dispatch
+  PTimeInterval start = PTimer::Tick();
+  for (unsigned i = 0; i < count; ++i)
+    timers[i]->Start(PTimeInterval(0, 0, 10+PRandom::Number(10)));
+  PTimeInterval elapsed = PTimer::Tick() - start;
+  cout << "Start:   " << elapsed << "s total, "
+       << elapsed.GetMicroSeconds()*1000/count << "ns per timer" << endl;
+
+  static const unsigned ProcessLoops = 1000;
+  start = PTimer::Tick();
+  for (unsigned i = 0; i < ProcessLoops; ++i)
+    PTimer::TimerList()->Process();
+  elapsed = PTimer::Tick() - start;
+  cout << "Process: " << elapsed << "s total, "
+       << elapsed.GetMicroSeconds()/ProcessLoops << "us per idle call" << endl;
+
+  start = PTimer::Tick();
+  for (unsigned i = 0; i < count; ++i)
+    timers[i]->Stop();
+  elapsed = PTimer::Tick() - start;
+  cout << "Stop:    " << elapsed << "s total, "
+       << elapsed.GetMicroSeconds()*1000/count << "ns per timer" << endl;
+
+  // Now let them all expire, spread over a few seconds
+  for (unsigned i = 0; i < count; ++i)
+    timers[i]->Start(PRandom::Number(1000, 5000));
+
+  PSimpleTimer timeout(0, 30);
+  while (firedCount < (int)count && timeout.IsRunning())
+    PThread::Sleep(100);
+
+  cout << "Expired: " << firedCount << " of " << count << " timers, average lateness "
+       << (firedCount > 0 ? latenessSum/firedCount : 0) << "ms" << endl;
+
+  for (unsigned i = 0; i < count; ++i)
+    delete timers[i];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 class EarlyStopTimerTester
   : public MyTimerTester
 {
@@ -61,6 +61,7 @@ void SafeTest::Main()
 	     "r-reporting."
 	     "b-banpthreadcreate."
 	     "a-alternate."
+	     "s-stress:"
 #if PTRACING
              "o-output:"             "-no-output."
              "t-trace."              "-no-trace."
@@ -92,6 +93,7 @@ void SafeTest::Main()
 	   << "-r                    print reporting (every minute) on current statistics" << endl
            << "-v  or --version      print version info" << endl
            << "-d  or --delay ##     where ## specifies how many milliseconds the created thread waits for" << endl
+	   << "-s  or --stress ##    stress test reference counting with up to ## threads, then exit" << endl
 	   << "-c  or --count ##     where ## specifies the number of active threads allowed " << endl
 #if PTRACING
            << "o-output              output file name for trace" << endl
@@ -102,6 +104,11 @@ void SafeTest::Main()
     return;
   }
 
+  if (args.HasOption('s')) {
+    StressTest(PMIN(1024U, PMAX(1U, args.GetOptionAs('s', 64U))));
+    return;
+  }
+
   delay = 2000;
   if (args.HasOption('d'))
     delay = args.GetOptionString('d').AsInteger();
@@ -145,6 +152,38 @@ void SafeTest::Main()
   PThread::Sleep(delay * 2);
 }
 
+void SafeTest::StressTest(unsigned maxThreads)
+{
+  static const unsigned ListSize = 10;
+  static const unsigned Iterations = 100000;
+
+  PSafeList<PSafeObject> list;
+  for (unsigned i = 0; i < ListSize; ++i)
+    list.Append(new PSafeObject);
+
+  cout << "Stress testing PSafeObject reference counting" << endl;
+  for (unsigned count = 1; count <= maxThreads; count *= 2) {
+    std::vector<StressThread *> threads(count);
+    for (unsigned i = 0; i < count; ++i)
+      threads[i] = new StressThread(list, Iterations/count);
+
+    PTime start;
+    for (unsigned i = 0; i < count; ++i)
+      threads[i]->Resume();
+
+    PUInt64 operations = 0;
+    for (unsigned i = 0; i < count; ++i) {
+      threads[i]->WaitForTermination();
+      operations += threads[i]->GetOperations();
+      delete threads[i];
+    }
+    PInt64 elapsed = (PTime() - start).GetMilliSeconds();
+
+    cout << setw(4) << count << " threads: "
+         << setw(10) << (elapsed > 0 ? operations*1000/elapsed : operations) << " ops/sec" << endl;
+  }
+}
+
 void SafeTest::OnReleased(DelayThread & delayThread)
 {
   PString id = delayThread.GetId();
@@ -311,6 +350,31 @@ void DelayThread::PrintOn(ostream & strm) const
 }
 ///////////////////////////////////////////////////////////////////////////
 
+StressThread::StressThread(PSafeList<PSafeObject> & _list, unsigned _iterations)
+  : PThread(10000, NoAutoDeleteThread, NormalPriority, "Stress")
+  , list(_list)
+  , iterations(_iterations)
+  , operations(0)
+{
+}
+
+void StressThread::Main()
+{
+  PSafePtr<PSafeObject> first = list.GetAt(0, PSafeReference);
+
+  for (unsigned i = 0; i < iterations; ++i) {
+    // Copying the pointer is a reference/dereference pair
+    PSafePtr<PSafeObject> copy = first;
+    ++operations;
+
+    // Each step of the enumeration is another pair
+    for (PSafePtr<PSafeObject> iter(list, PSafeReference); iter != NULL; ++iter)
+      ++operations;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
   
 ReporterThread::ReporterThread(LauncherThread & _launcher)
   : PThread(10000, NoAutoDeleteThread),
@@ -293,6 +293,35 @@ public:
   PBoolean            keepGoing;
 };
 
+////////////////////////////////////////////////////////////////////////////////
+/**This class is used by the stress mode. It repeatedly copies a PSafePtr to a
+   shared object and enumerates a PSafeList, so that the reference counting in
+   PSafeObject is exercised from many threads at once. */
+class StressThread : public PThread
+{
+  PCLASSINFO(StressThread, PThread);
+
+ public:
+  /**Constructor, with the list to enumerate and number of loops to do */
+  StressThread(PSafeList<PSafeObject> & list, unsigned iterations);
+
+  /**Do the work of stressing */
+  void Main();
+
+  /**Number of reference/dereference pairs done */
+  PUInt64 GetOperations() const { return operations; }
+
+ protected:
+  /**List shared by all stress threads */
+  PSafeList<PSafeObject> & list;
+
+  /**Number of times around the loop */
+  unsigned iterations;
+
+  /**Count of reference/dereference pairs */
+  PUInt64 operations;
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 
 /**
@@ -311,6 +340,10 @@ class SafeTest : public PProcess
      command line processing */
     virtual void Main();
 
+    /**Run the reference counting stress test with 1 to maxThreads threads,
+       doubling each time, and report operations per second. */
+    void StressTest(unsigned maxThreads);
+
     /**Report the user specified delay, which is used in DelayThread
        instances. Units are in milliseconds */
     PINDEX Delay()    { return delay; }
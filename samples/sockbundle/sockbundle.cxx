@@ -12,6 +12,15 @@ class SockBundleProcess : public PProcess
   public:
     SockBundleProcess();
     void Main();
+
+  protected:
+    void Benchmark(PMonitoredSocketBundle & bundle, unsigned count);
+    void Interleave(PMonitoredSocketBundle & bundle, unsigned count);
+    void Sender(PIPSocket::Address destination);
+
+    WORD           m_port;
+    unsigned       m_count;
+    PAtomicInteger m_received;
 };
 
 PCREATE_PROCESS(SockBundleProcess);
@@ -26,7 +35,9 @@ void SockBundleProcess::Main()
 {
   PArgList & args = GetArguments();
 
-  args.Parse(
+  args.Parse("b-benchmark.  Time reads of a stream of datagrams on all interfaces\n"
+             "i-interleave. Check batched reads alternating between two interfaces\n"
+             "n-count:      Number of datagrams, default 200000, or 100 per interface\n"
 #if PTRACING
              "o-output:"             "-no-output."
              "t-trace."              "-no-trace."
@@ -45,6 +56,16 @@ void SockBundleProcess::Main()
     return;
   }
 
+  if (args.HasOption('b')) {
+    Benchmark(bundle, args.GetOptionAs('n', 200000U));
+    return;
+  }
+
+  if (args.HasOption('i')) {
+    Interleave(bundle, args.GetOptionAs('n', 100U));
+    return;
+  }
+
   PSingleMonitoredSocket single(bundle.GetInterfaces()[0], false);
   if (!single.Open(1719)) {
     cout << "Cannot open single monitored socket" << endl;
@@ -72,3 +93,109 @@ void SockBundleProcess::Main()
     cout << "\nCurrent interfaces:" << endl;
   }
 }
+
+
+/* A thread sends datagrams to the first interface of the bundle, keeping a
+   limited number outstanding so none are dropped, while this thread reads
+   them with ReadFromBundle() on all interfaces, as a media stream would. */
+void SockBundleProcess::Benchmark(PMonitoredSocketBundle & bundle, unsigned count)
+{
+  PStringArray interfaces = bundle.GetInterfaces();
+  PIPSocket::Address destination;
+  WORD port;
+  if (interfaces.IsEmpty() || !bundle.GetAddress(interfaces[0], destination, port, false)) {
+    cout << "No interfaces for benchmark" << endl;
+    return;
+  }
+
+  m_port = port;
+  m_count = count;
+  m_received = 0;
+
+  PThread * sender = new PThreadObj1Arg<SockBundleProcess, PIPSocket::Address>(*this, destination,
+                                                        &SockBundleProcess::Sender, false, "Sender");
+
+  BYTE buffer[2000];
+  unsigned timeouts = 0;
+  PTime start;
+  while (m_received < (int)count) {
+    PMonitoredSockets::BundleParams param;
+    param.m_buffer = buffer;
+    param.m_length = sizeof(buffer);
+    param.m_timeout = 1000;
+    bundle.ReadFromBundle(param);
+    if (param.m_errorCode == PChannel::NoError)
+      ++m_received;
+    else if (param.m_errorCode == PChannel::Timeout && ++timeouts > 2)
+      break;
+  }
+  PTimeInterval elapsed = PTime() - start;
+
+  sender->WaitForTermination();
+  delete sender;
+
+  cout << m_received << " datagrams on bundle of " << interfaces.GetSize() << " interfaces in "
+       << elapsed << "s, " << (m_received*1000/std::max(elapsed.GetMilliSeconds(), (PInt64)1)) << " reads/s" << endl;
+}
+
+
+/* Datagrams are sent to each of two interfaces, then read in batches with
+   the reads alternating between the interfaces, so each has datagrams queued
+   when the other is read. Every datagram must arrive, in order. */
+void SockBundleProcess::Interleave(PMonitoredSocketBundle & bundle, unsigned count)
+{
+  PStringArray interfaces = bundle.GetInterfaces();
+  if (interfaces.GetSize() < 2) {
+    cout << "Need two interfaces for interleave test" << endl;
+    return;
+  }
+
+  bundle.SetReadBatchSize(8);
+
+  for (PINDEX i = 0; i < 2; ++i) {
+    PIPSocket::Address address;
+    WORD port;
+    if (!bundle.GetAddress(interfaces[i], address, port, false)) {
+      cout << "No address for interface " << interfaces[i] << endl;
+      return;
+    }
+    PUDPSocket socket(0, address.GetVersion() == 6 ? AF_INET6 : AF_INET);
+    for (unsigned sequence = 0; sequence < count; ++sequence)
+      socket.WriteTo(&sequence, sizeof(sequence), address, port);
+  }
+
+  unsigned expected[2] = { 0, 0 };
+  for (unsigned read = 0; read < count*2; ++read) {
+    PINDEX i = read%2;
+    unsigned sequence = UINT_MAX;
+    PMonitoredSockets::BundleParams param;
+    param.m_buffer = &sequence;
+    param.m_length = sizeof(sequence);
+    param.m_iface = interfaces[i];
+    param.m_timeout = 1000;
+    bundle.ReadFromBundle(param);
+    if (param.m_errorCode != PChannel::NoError || sequence != expected[i]) {
+      cout << "Interleaved read failed on " << interfaces[i] << ", expected datagram "
+           << expected[i] << " got " << sequence << ", error " << param.m_errorCode << endl;
+      return;
+    }
+    ++expected[i];
+  }
+
+  cout << "Interleaved reads of " << count << " datagrams on each of two interfaces passed" << endl;
+}
+
+
+void SockBundleProcess::Sender(PIPSocket::Address destination)
+{
+  PUDPSocket socket;
+  BYTE datagram[172]; // Typical RTP packet of 20ms G.711
+  memset(datagram, 0, sizeof(datagram));
+
+  for (unsigned sent = 0; sent < m_count; ++sent) {
+    while ((int)sent - m_received > 32)
+      PThread::Yield();
+    if (!socket.WriteTo(datagram, sizeof(datagram), destination, m_port))
+      break;
+  }
+}
@@ -84,6 +84,43 @@ void SortedListTest::Main()
     ss.erase(found);
   }
 
+  {
+    PSortedArray<PString> sa;
+    PAssert(sa.begin() == sa.end(), "Bad PSortedArray implemetation");
+    sa.Append(new PString("fred"));
+    sa.Append(new PString("nurk"));
+    sa.Append(new PString("rocky"));
+    sa.AppendUnsorted(new PString("bullwinkle"));
+    sa.AppendUnsorted(new PString("boris"));
+    sa.AppendUnsorted(new PString("natasha"));
+    PAssert(!sa.IsSorted(), "Bad PSortedArray implemetation");
+    sa.Sort();
+
+    cout << "PSortedArray front()=\"" << sa.front() << "\", back()=\"" << sa.back() << "\"\n"
+            "Forwards, iteration:\n";
+    for (PSortedArray<PString>::iterator it = sa.begin(); it != sa.end(); ++it)
+      cout << "  \"" << *it << "\"\n";
+
+    cout << "Reverse iteration:\n";
+    for (PSortedArray<PString>::iterator it = sa.rbegin(); it != sa.rend(); --it)
+      cout << "  \"" << *it << "\"\n";
+    cout << endl;
+
+    PSortedArray<PString>::iterator found = sa.find("fred");
+    PAssert(found != sa.end() && *found == "fred", "Bad PSortedArray implemetation");
+    sa.erase(found);
+    PAssert(sa.GetSize() == 5 && sa.GetValuesIndex(PString("fred")) == P_MAX_INDEX, "Bad PSortedArray implemetation");
+    PAssert(sa.GetValuesIndex(PString("natasha")) == 2 && sa.GetObjectsIndex(&sa[3]) == 3, "Bad PSortedArray implemetation");
+  }
+
+  PArgList & args = GetArguments();
+  args.Parse("b-benchmark. Compare PSortedList and PSortedArray and exit\n"
+             "n-count: Number of entries for benchmark, default 10000\n");
+  if (args.HasOption('b')) {
+    Benchmark(args.GetOptionAs('n', 10000));
+    return;
+  }
+
   for (PINDEX i = 0; i < 15; i++) {
     if (i < 10)
       new DoSomeThing1(i);
@@ -95,6 +132,101 @@ void SortedListTest::Main()
 }
 
 
+static void ReportBenchmark(const char * name, const PTime & start, PINDEX count, PINDEX dummy)
+{
+  PTimeInterval elapsed = PTime() - start;
+  cout << setw(28) << left << name << right
+       << setw(8) << (elapsed.GetMilliSeconds()*1000000/count) << " ns/op"
+       << (dummy == 42 ? " " : "") // Prevent optimiser removing everything
+       << endl;
+}
+
+
+template <class Coll>
+static void BenchmarkLookups(const char * name, const Coll & coll, const std::vector<PString *> & keys, unsigned repeats)
+{
+  PINDEX dummy = 0;
+  PStringStream str;
+
+  str << name << " find";
+  PTime start;
+  for (unsigned r = 0; r < repeats; ++r) {
+    for (size_t i = 0; i < keys.size(); ++i)
+      dummy += coll.GetValuesIndex(*keys[i]);
+  }
+  ReportBenchmark(str, start, keys.size()*repeats, dummy);
+
+  str.MakeEmpty();
+  str << name << " iterate";
+  start.SetCurrentTime();
+  for (unsigned r = 0; r < repeats; ++r) {
+    for (typename Coll::const_iterator it = coll.begin(); it != coll.end(); ++it)
+      dummy += it->GetLength();
+  }
+  ReportBenchmark(str, start, keys.size()*repeats, dummy);
+
+  str.MakeEmpty();
+  str << name << " index";
+  start.SetCurrentTime();
+  for (unsigned r = 0; r < repeats; ++r) {
+    for (size_t i = 0; i < keys.size(); ++i)
+      dummy += coll[(i*7919) % keys.size()].GetLength();
+  }
+  ReportBenchmark(str, start, keys.size()*repeats, dummy);
+}
+
+
+void SortedListTest::Benchmark(PINDEX count)
+{
+  static const unsigned Repeats = 20;
+
+  cout << "Benchmark of " << count << " random strings" << endl;
+
+  PRandom rand(PRandom::Number());
+  std::vector<PString *> keys(count);
+  for (PINDEX i = 0; i < count; ++i)
+    keys[i] = new PString(PString::Printf, "%08x%08x", rand.Generate(), rand.Generate());
+
+  PSortedList<PString> list;
+  list.DisallowDeleteObjects();
+  PTime start;
+  for (PINDEX i = 0; i < count; ++i)
+    list.Append(keys[i]);
+  ReportBenchmark("PSortedList Append", start, count, list.GetSize());
+
+  PSortedArray<PString> array;
+  array.DisallowDeleteObjects();
+  start.SetCurrentTime();
+  for (PINDEX i = 0; i < count; ++i)
+    array.Append(keys[i]);
+  ReportBenchmark("PSortedArray Append", start, count, array.GetSize());
+
+  PSortedArray<PString> bulk;
+  bulk.DisallowDeleteObjects();
+  start.SetCurrentTime();
+  bulk.Reserve(count);
+  for (PINDEX i = 0; i < count; ++i)
+    bulk.AppendUnsorted(keys[i]);
+  bulk.Sort();
+  ReportBenchmark("PSortedArray AppendUnsorted", start, count, bulk.GetSize());
+
+  for (PINDEX i = 0; i < count; ++i)
+    PAssert(&list[i] == &array[i] && &array[i] == &bulk[i], "Bad PSortedArray implemetation");
+
+  BenchmarkLookups("PSortedList", list, keys, Repeats);
+  BenchmarkLookups("PSortedArray", array, keys, Repeats);
+
+  cout << "Memory per entry: PSortedList " << sizeof(PSortedListElement)
+       << " bytes, PSortedArray " << sizeof(PObject *) << " bytes" << endl;
+
+  list.RemoveAll();
+  array.RemoveAll();
+  bulk.RemoveAll();
+  for (PINDEX i = 0; i < count; ++i)
+    delete keys[i];
+}
+
+
 DoSomeThing1::DoSomeThing1(PINDEX _index)
   : PThread(1000, AutoDeleteThread, NormalPriority, psprintf("DoSomeThing1 %u", _index)), index(_index)
 {
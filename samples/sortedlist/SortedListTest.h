@@ -8,6 +8,7 @@ class SortedListTest:public PProcess {
 public:
   SortedListTest();
   void Main();
+  void Benchmark(PINDEX count);
 };
 
 
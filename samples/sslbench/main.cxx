@@ -0,0 +1,179 @@
+/*
+ * main.cxx
+ *
+ * Benchmark of TLS handshakes with and without client session resumption.
+ *
+ * Portable Tools Library
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.0 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is Portable Tools Library.
+ *
+ * $Revision$
+ * $Author$
+ * $Date$
+ */
+
+/*
+ * A PSSLChannel server runs in a thread of this process on the loopback
+ * interface, with a freshly generated self signed certificate. The client
+ * makes a series of connections, each exchanging one byte, first with the
+ * client session cache disabled so every connection does a full handshake,
+ * and then with it enabled so connections after the first resume the
+ * previous session.
+ */
+
+#include <ptlib.h>
+#include <ptlib/pprocess.h>
+#include <ptlib/sockets.h>
+#include <ptclib/pssl.h>
+
+
+#if P_SSL
+
+class SSLBench : public PProcess
+{
+  PCLASSINFO(SSLBench, PProcess)
+  public:
+    SSLBench();
+    void Main();
+
+  protected:
+    void Server();
+    void Benchmark(const char * name, PSSLContext & context);
+
+    PSSLContext m_serverContext;
+    PTCPSocket  m_listener;
+    unsigned    m_count;
+};
+
+PCREATE_PROCESS(SSLBench);
+
+
+SSLBench::SSLBench()
+  : PProcess("PTLib", "sslbench")
+  , m_serverContext("sslbench")
+  , m_count(0)
+{
+}
+
+
+void SSLBench::Main()
+{
+  cout << "TLS Handshake Benchmark" << endl;
+
+  PArgList & args = GetArguments();
+  args.Parse("n-count: Number of connections for each test, default 500\n"
+             PTRACE_ARGLIST);
+
+  if (!args.IsParsed()) {
+    cerr << args.Usage();
+    return;
+  }
+
+  PTRACE_INITIALISE(args);
+
+  m_count = std::max(args.GetOptionAs('n', 500U), 1U);
+
+  PSSLPrivateKey key;
+  PSSLCertificate cert;
+  if (!key.Create(2048) || !cert.CreateRoot("/O=PTLib/CN=localhost", key) ||
+      !m_serverContext.UseCertificate(cert) || !m_serverContext.UsePrivateKey(key)) {
+    cerr << "Could not create server certificate" << endl;
+    return;
+  }
+
+  if (!m_listener.Listen(PIPSocket::Address::GetLoopback())) {
+    cerr << "Could not listen: " << m_listener.GetErrorText() << endl;
+    return;
+  }
+
+  PThread * server = new PThreadObj<SSLBench>(*this, &SSLBench::Server, false, "Server");
+
+  PSSLContext fullContext;
+  fullContext.SetClientSessionCacheSize(0);
+  Benchmark("Full handshake", fullContext);
+
+  PSSLContext resumeContext;
+  Benchmark("Resumed", resumeContext);
+
+  m_listener.Close();
+  server->WaitForTermination();
+  delete server;
+}
+
+
+void SSLBench::Benchmark(const char * name, PSSLContext & context)
+{
+  unsigned failed = 0;
+
+  PTime start;
+  for (unsigned i = 0; i < m_count; ++i) {
+    PTCPSocket * tcp = new PTCPSocket(m_listener.GetPort());
+    if (!tcp->Connect(PIPSocket::Address::GetLoopback())) {
+      ++failed;
+      delete tcp;
+      continue;
+    }
+    tcp->SetOption(TCP_NODELAY, 1, IPPROTO_TCP);
+
+    PSSLChannel ssl(context);
+    ssl.SetSessionKey(PSTRSTRM("localhost:" << m_listener.GetPort()));
+    char data = 'x';
+    if (!ssl.Connect(tcp) || !ssl.Write(&data, 1) || !ssl.Read(&data, 1))
+      ++failed;
+
+    // Without a clean TLS shutdown OpenSSL will not resume the session
+    ssl.Close();
+  }
+  PTimeInterval elapsed = PTime() - start;
+
+  cout << setw(16) << left << name << right
+       << setw(8) << (m_count*1000/std::max(elapsed.GetMilliSeconds(), (PInt64)1)) << " handshakes/s, "
+       << context.GetClientSessionHits() << " resumed, "
+       << context.GetClientSessionMisses() << " full, "
+       << failed << " failed" << endl;
+}
+
+
+void SSLBench::Server()
+{
+  for (;;) {
+    PTCPSocket * tcp = new PTCPSocket;
+    if (!tcp->Accept(m_listener)) {
+      delete tcp;
+      break;
+    }
+    tcp->SetOption(TCP_NODELAY, 1, IPPROTO_TCP);
+
+    PSSLChannel ssl(m_serverContext);
+    char data;
+    if (ssl.Accept(tcp) && ssl.Read(&data, 1))
+      ssl.Write(&data, 1);
+    ssl.Close();
+  }
+}
+
+#else
+
+class SSLBench : public PProcess
+{
+  PCLASSINFO(SSLBench, PProcess)
+  public:
+    void Main() { cerr << "No SSL support" << endl; }
+};
+
+PCREATE_PROCESS(SSLBench);
+
+#endif // P_SSL
+
+
+// End of File ///////////////////////////////////////////////////////////////
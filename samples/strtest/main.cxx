@@ -177,6 +177,241 @@ void Test4()
   delete thread;
 }
 
+////////////////////////////////////////////////
+//
+// test #5 - String stream growth benchmark
+//
+
+static void BuildLargeStream(PStringStream & strm, PINDEX total)
+{
+  // Each line is about 50 bytes
+  for (PINDEX i = 0; i < total/50; ++i)
+    strm << "<element attribute=\"" << i << "\">Some text content</element>\n";
+}
+
+void Test5()
+{
+  static const PINDEX TotalSize = 10*1024*1024;
+
+  {
+    PTime start;
+    PStringStream strm;
+    BuildLargeStream(strm, TotalSize);
+    PTimeInterval elapsed = PTime() - start;
+    cout << "Built " << strm.GetLength() << " bytes in " << elapsed
+         << "s, capacity " << strm.GetCapacity() << endl;
+
+    strm.MakeMinimumSize();
+    cout << "After MakeMinimumSize(), length " << strm.GetLength()
+         << ", capacity " << strm.GetCapacity() << endl;
+  }
+
+  {
+    PTime start;
+    PStringStream strm;
+    strm.Reserve(TotalSize+100);
+    BuildLargeStream(strm, TotalSize);
+    PTimeInterval elapsed = PTime() - start;
+    cout << "Built " << strm.GetLength() << " bytes with Reserve() in " << elapsed
+         << "s, capacity " << strm.GetCapacity() << endl;
+  }
+}
+
+
+////////////////////////////////////////////////
+//
+// test #6 - PString micro benchmarks
+//
+
+static const char ShortText[] = "Content-Length";
+static const char LongText[] = "a4c36a5c-8b8e-4e32-9f4a-1b7d7b7c2a11@example.com";
+
+static void ReportBenchmark(const char * name, const PTime & start, unsigned count, PINDEX dummy)
+{
+  PTimeInterval elapsed = PTime() - start;
+  cout << setw(20) << left << name << right
+       << setw(8) << (elapsed.GetMilliSeconds()*1000000/count) << " ns/op"
+       << (dummy == 42 ? " " : "") // Prevent optimiser removing everything
+       << endl;
+}
+
+void Test6()
+{
+  static const unsigned Count = 2000000;
+  PINDEX dummy = 0;
+
+  PTime start;
+  for (unsigned i = 0; i < Count; ++i) {
+    PString str(ShortText);
+    dummy += str.GetLength();
+  }
+  ReportBenchmark("Construct short", start, Count, dummy);
+
+  start.SetCurrentTime();
+  for (unsigned i = 0; i < Count; ++i) {
+    PString str(LongText);
+    dummy += str.GetLength();
+  }
+  ReportBenchmark("Construct long", start, Count, dummy);
+
+  start.SetCurrentTime();
+  for (unsigned i = 0; i < Count; ++i) {
+    PString str((int)i);
+    dummy += str.GetLength();
+  }
+  ReportBenchmark("Construct integer", start, Count, dummy);
+
+  PString shortStr(ShortText), longStr(LongText);
+
+  start.SetCurrentTime();
+  for (unsigned i = 0; i < Count; ++i) {
+    PString str(shortStr);
+    dummy += str.GetLength();
+  }
+  ReportBenchmark("Copy short", start, Count, dummy);
+
+  start.SetCurrentTime();
+  for (unsigned i = 0; i < Count; ++i) {
+    PString str(longStr);
+    dummy += str.GetLength();
+  }
+  ReportBenchmark("Copy long", start, Count, dummy);
+
+  start.SetCurrentTime();
+  for (unsigned i = 0; i < Count; ++i) {
+    PString str;
+    str = shortStr;
+    dummy += str.GetLength();
+  }
+  ReportBenchmark("Assign short", start, Count, dummy);
+
+  start.SetCurrentTime();
+  for (unsigned i = 0; i < Count; ++i) {
+    PString str("SIP");
+    str += '/';
+    str += "2.0";
+    dummy += str.GetLength();
+  }
+  ReportBenchmark("Append short", start, Count, dummy);
+
+  start.SetCurrentTime();
+  for (unsigned i = 0; i < Count; ++i) {
+    PString str = shortStr + ": " + PString((int)i);
+    dummy += str.GetLength();
+  }
+  ReportBenchmark("Concatenate", start, Count, dummy);
+
+  start.SetCurrentTime();
+  for (unsigned i = 0; i < Count; ++i) {
+    PString str = longStr.Left(8);
+    dummy += str.GetLength();
+  }
+  ReportBenchmark("Substring", start, Count, dummy);
+
+  PCaselessString caseless("content-length");
+  start.SetCurrentTime();
+  for (unsigned i = 0; i < Count; ++i) {
+    if (caseless == shortStr)
+      ++dummy;
+  }
+  ReportBenchmark("Compare caseless", start, Count, dummy);
+
+  start.SetCurrentTime();
+  for (unsigned i = 0; i < Count; ++i)
+    dummy += shortStr.HashFunction();
+  ReportBenchmark("Hash short", start, Count, dummy);
+
+  start.SetCurrentTime();
+  for (unsigned i = 0; i < Count; ++i)
+    dummy += longStr.HashFunction();
+  ReportBenchmark("Hash long", start, Count, dummy);
+}
+
+
+////////////////////////////////////////////////
+//
+// test #7 - Move semantics, temporaries and containers
+//
+
+static PStringArray MakeArray(unsigned i)
+{
+  PStringArray array(3);
+  array[0] = LongText;
+  array[1] = PString(i);
+  array[2] = ShortText;
+  return array;
+}
+
+void Test7()
+{
+#if P_HAS_MOVE_SEMANTICS
+  {
+    PString str1(LongText);
+    PString str2(std::move(str1));
+    cout << "Moved \"" << str2 << "\", left \"" << str1 << "\", unique=" << str2.IsUnique() << endl;
+
+    PStringList list;
+    list.AppendString(LongText);
+    PStringList list2;
+    list2 = std::move(list);
+    cout << "Moved list of " << list2.GetSize() << " \"" << list2.front() << "\", unique=" << list2.IsUnique() << endl;
+    list.AppendString(ShortText);
+    cout << "Reused moved from list of " << list.GetSize() << " \"" << list[0] << '"' << endl;
+
+    PStringToString dict;
+    dict.SetAt(ShortText, LongText);
+    PStringToString dict2(std::move(dict));
+    cout << "Moved dictionary " << ShortText << '=' << dict2[ShortText] << ", unique=" << dict2.IsUnique() << endl;
+    cout << "Moved from dictionary empty=" << dict.IsEmpty() << ", contains=" << dict.Contains(ShortText) << endl;
+  }
+#else
+  cout << "Move semantics not available" << endl;
+#endif
+
+  static const unsigned Count = 1000000;
+  PINDEX dummy = 0;
+  PString longStr(LongText);
+
+  PTime start;
+  for (unsigned i = 0; i < Count; ++i) {
+    PString str = longStr + ": " + longStr + ';' + PString((int)i);
+    dummy += str.GetLength();
+  }
+  ReportBenchmark("Concatenate long", start, Count, dummy);
+
+  start.SetCurrentTime();
+  {
+    std::vector<PString> vec;
+    for (unsigned i = 0; i < Count; ++i) {
+      if (vec.size() >= 1000)
+        vec.clear();
+      vec.push_back(PString(LongText));
+    }
+    dummy += vec.size();
+  }
+  ReportBenchmark("Vector push long", start, Count, dummy);
+
+  start.SetCurrentTime();
+  {
+    PStringArray array;
+    for (unsigned i = 0; i < Count; ++i) {
+      array = MakeArray(i);
+      dummy += array.GetSize();
+    }
+  }
+  ReportBenchmark("Return array", start, Count, dummy);
+
+  start.SetCurrentTime();
+  {
+    PString str1(LongText), str2(ShortText);
+    for (unsigned i = 0; i < Count; ++i)
+      std::swap(str1, str2);
+    dummy += str1.GetLength();
+  }
+  ReportBenchmark("Swap", start, Count, dummy);
+}
+
+
 ////////////////////////////////////////////////
 //
 // main
@@ -198,4 +433,7 @@ void StringTest::Main()
   Test2(); cout << "End of test #2\n" << endl;
   Test3(); cout << "End of test #3\n" << endl;
   Test4(); cout << "End of test #4\n" << endl;
+  Test5(); cout << "End of test #5\n" << endl;
+  Test6(); cout << "End of test #6\n" << endl;
+  Test7(); cout << "End of test #7\n" << endl;
 }
@@ -135,6 +135,80 @@ void LockBthenA(PMutex & a, PMutex & b)
 }
 
 
+/*
+ * Benchmark of PThread::Current() and PTRACE from many threads at once.
+ * Trace output goes to a null stream, so it is the overhead of the calls
+ * themselves that is measured, not the I/O.
+ */
+class NullStream : public ostream
+{
+  public:
+    NullStream() : ostream(&m_buffer) { }
+  protected:
+    struct Buffer : public std::streambuf
+    {
+      virtual int overflow(int c) { return c; }
+    } m_buffer;
+};
+
+
+class BenchThread : public PThread
+{
+  PCLASSINFO(BenchThread, PThread);
+  public:
+    BenchThread(unsigned iterations, bool trace)
+      : PThread(10000, NoAutoDeleteThread)
+      , m_iterations(iterations)
+      , m_trace(trace)
+    {
+    }
+
+    void Main()
+    {
+      if (m_trace) {
+        for (unsigned i = 0; i < m_iterations; ++i)
+          PTRACE(4, "Bench", "Iteration " << i);
+      }
+      else {
+        for (unsigned i = 0; i < m_iterations; ++i)
+          PThread::Current();
+      }
+    }
+
+  protected:
+    unsigned m_iterations;
+    bool     m_trace;
+};
+
+
+static void Benchmark(unsigned threadCount, bool trace)
+{
+  static const unsigned Iterations = 100000;
+
+  std::vector<BenchThread *> threads(threadCount);
+  for (unsigned i = 0; i < threadCount; ++i)
+    threads[i] = new BenchThread(Iterations, trace);
+
+  PTime start;
+  for (unsigned i = 0; i < threadCount; ++i)
+    threads[i]->Resume();
+  for (unsigned i = 0; i < threadCount; ++i) {
+    threads[i]->WaitForTermination();
+    delete threads[i];
+  }
+  PTimeInterval elapsed = PTime() - start;
+
+  const char * name = "Current()";
+  if (trace)
+    name = (PTrace::GetOptions()&PTrace::AsynchronousOutput) != 0 ? "PTRACE async" : "PTRACE";
+
+  cout << setw(3) << threadCount << " threads, "
+       << setw(12) << name << ": "
+       << setw(10) << (elapsed > 0 ? (uint64_t)Iterations*threadCount*1000/elapsed.GetMilliSeconds() : 0)
+       << " calls/second" << endl;
+}
+
+
 /*
  * The main program class
  */
@@ -153,7 +227,34 @@ void ThreadTest::Main()
   cout << "Thread Test Program" << endl;
 
   PArgList & args = GetArguments();
-  args.Parse("d-deadlock. Test deadlock detection");
+  args.Parse("d-deadlock. Test deadlock detection\n"
+             "b-benchmark: Benchmark PThread::Current() and PTRACE with up to N threads\n"
+             "o-output: Trace to file in benchmark, default is to discard\n"
+             "a-async. Also benchmark asynchronous trace output");
+
+  if (args.HasOption('b')) {
+    if (args.HasOption('o'))
+      PTrace::Initialise(0, args.GetOptionString('o'), PTrace::GetOptions());
+    else
+      PTrace::SetStream(new NullStream); // Trace system deletes it
+    PTrace::SetLevel(4);
+    PTrace::SetAsynchronousQueue(65536, true);
+
+    unsigned maxThreads = args.GetOptionAs('b', 16U);
+    for (unsigned count = 1; count <= maxThreads; count *= 2) {
+      Benchmark(count, false);
+      Benchmark(count, true);
+      if (args.HasOption('a')) {
+        PTrace::SetOptions(PTrace::AsynchronousOutput);
+        Benchmark(count, true);
+        PTrace::ClearOptions(PTrace::AsynchronousOutput);
+      }
+    }
+
+    PTrace::SetLevel(0);
+    PTrace::SetStream(&cerr);
+    return;
+  }
 
   if (args.HasOption('d')) {
     cout << "Testing deadlock detection." << endl;
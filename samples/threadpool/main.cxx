@@ -0,0 +1,187 @@
+/*
+ * main.cxx
+ *
+ * Benchmark of PQueuedThreadPool schedulers under skewed load.
+ *
+ * Portable Tools Library
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.0 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is Portable Tools Library.
+ *
+ * $Revision$
+ * $Author$
+ * $Date$
+ */
+
+/*
+ * Work is added to the pool as fast as possible. A proportion of it is in a
+ * single "hot" group, as a busy call would be, the rest has no group. A few
+ * of the items take much longer than the others. The elapsed time for all of
+ * the work, and the percentiles of the time from adding each item to its
+ * completion, are shown for the default scheduler and for work stealing.
+ */
+
+#include <ptlib.h>
+#include <ptlib/pprocess.h>
+#include <ptclib/threadpool.h>
+#include <ptclib/random.h>
+
+
+class ThreadPoolTest : public PProcess
+{
+  PCLASSINFO(ThreadPoolTest, PProcess)
+  public:
+    void Main();
+
+  protected:
+    void Benchmark(bool stealing);
+    void PrintLatency(const char * name, PProfiling::Histogram & histogram);
+
+    unsigned m_workers;
+    unsigned m_count;
+    unsigned m_hotPercent;
+    unsigned m_slowPercent;
+    unsigned m_fastTime;
+    unsigned m_slowTime;
+    bool     m_spin;
+};
+
+PCREATE_PROCESS(ThreadPoolTest);
+
+
+struct BenchWork
+{
+  BenchWork(unsigned duration, bool spin, PProfiling::Histogram & histogram, atomic<unsigned> & remaining, PSyncPoint & done)
+    : m_duration(duration)
+    , m_spin(spin)
+    , m_added(PProfiling::Histogram::GetTime())
+    , m_histogram(histogram)
+    , m_remaining(remaining)
+    , m_done(done)
+  {
+  }
+
+  void Work()
+  {
+    if (m_spin) {
+      uint64_t end = PProfiling::Histogram::GetTime() + m_duration;
+      while (PProfiling::Histogram::GetTime() < end)
+        ;
+    }
+    else
+      PThread::Sleep(PTimeInterval::MicroSeconds(m_duration));
+
+    m_histogram.Record(PProfiling::Histogram::GetTime() - m_added);
+
+    if (--m_remaining == 0)
+      m_done.Signal();
+  }
+
+  unsigned               m_duration; // microseconds
+  bool                   m_spin;
+  uint64_t               m_added;
+  PProfiling::Histogram & m_histogram;
+  atomic<unsigned>     & m_remaining;
+  PSyncPoint           & m_done;
+};
+
+
+void ThreadPoolTest::Main()
+{
+  cout << "Thread Pool Benchmark" << endl;
+
+  PArgList & args = GetArguments();
+  args.Parse("w-workers: Number of worker threads, default 8\n"
+             "n-count: Number of work items, default 10000\n"
+             "H-hot: Percentage of work in one group, default 30\n"
+             "s-slow: Percentage of work that is slow, default 2\n"
+             "f-fast-time: Microseconds for normal work, default 100\n"
+             "S-slow-time: Microseconds for slow work, default 20000\n"
+             "b-busy. Spin for work time rather than sleep\n"
+             PTRACE_ARGLIST);
+
+  if (!args.IsParsed()) {
+    cerr << args.Usage();
+    return;
+  }
+
+  PTRACE_INITIALISE(args);
+
+  m_workers = args.GetOptionAs('w', 8U);
+  m_count = args.GetOptionAs('n', 10000U);
+  m_hotPercent = args.GetOptionAs('H', 30U);
+  m_slowPercent = args.GetOptionAs('s', 2U);
+  m_fastTime = args.GetOptionAs('f', 100U);
+  m_slowTime = args.GetOptionAs('S', 20000U);
+  m_spin = args.HasOption('b');
+
+  cout << m_workers << " workers, "
+       << m_count << " items, "
+       << m_hotPercent << "% in one group, "
+       << m_slowPercent << "% take " << m_slowTime << "us, "
+       << "others " << m_fastTime << "us"
+       << (m_spin ? " busy" : " sleeping") << endl;
+
+  Benchmark(false);
+  Benchmark(true);
+}
+
+
+void ThreadPoolTest::Benchmark(bool stealing)
+{
+  const char * name = stealing ? "Work stealing" : "Default";
+
+  PQueuedThreadPool<BenchWork> pool(m_workers, 0, name);
+  pool.SetWorkStealing(stealing);
+
+  PProfiling::Histogram & hotHistogram = PProfiling::GetHistogram(std::string(name) + " hot");
+  PProfiling::Histogram & otherHistogram = PProfiling::GetHistogram(std::string(name) + " other");
+  atomic<unsigned> remaining(m_count);
+  PSyncPoint done;
+
+  // Same load for both schedulers
+  PRandom random(1);
+
+  PTime start;
+  for (unsigned i = 0; i < m_count; ++i) {
+    unsigned duration = random.Generate(0, 99) < m_slowPercent ? m_slowTime : m_fastTime;
+    if (random.Generate(0, 99) < m_hotPercent)
+      pool.AddWork(new BenchWork(duration, m_spin, hotHistogram, remaining, done), "hot");
+    else
+      pool.AddWork(new BenchWork(duration, m_spin, otherHistogram, remaining, done));
+  }
+
+  done.Wait();
+  PTimeInterval elapsed = PTime() - start;
+
+  cout << name << ": "
+       << (elapsed > 0 ? (uint64_t)m_count*1000/elapsed.GetMilliSeconds() : 0) << " items/second\n";
+  PrintLatency("hot group", hotHistogram);
+  PrintLatency("no group", otherHistogram);
+}
+
+
+void ThreadPoolTest::PrintLatency(const char * name, PProfiling::Histogram & histogram)
+{
+  PProfiling::Histogram::Snapshot snapshot;
+  histogram.GetSnapshot(snapshot);
+
+  cout << "  " << left << setw(10) << name << right
+       << " latency us:"
+          " p50="   << setw(8) << snapshot.GetPercentile(50)
+       << " p99="   << setw(8) << snapshot.GetPercentile(99)
+       << " p99.9=" << setw(8) << snapshot.GetPercentile(99.9)
+       << " max="   << setw(8) << snapshot.m_maximum << endl;
+}
+
+
+// End of File ///////////////////////////////////////////////////////////////
@@ -0,0 +1,178 @@
+/*
+ * main.cxx
+ *
+ * Benchmark of PWebSocket frame throughput.
+ *
+ * Portable Tools Library
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.0 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is Portable Tools Library.
+ *
+ * $Revision$
+ * $Author$
+ * $Date$
+ */
+
+/*
+ * A pair of PWebSocket channels are connected over the loopback interface,
+ * with the handshake skipped. A thread writes masked frames as a client
+ * would, and the main thread reads and unmasks them as a server would. For
+ * message sizes from 64 bytes to 64 kilobytes the rate is shown for reading
+ * into a caller supplied buffer and for reading into a PBYTEArray.
+ */
+
+#include <ptlib.h>
+#include <ptlib/pprocess.h>
+#include <ptlib/sockets.h>
+#include <ptclib/http.h>
+
+
+#if P_SSL
+
+class ClientWebSocket : public PWebSocket
+{
+  public:
+    ClientWebSocket()
+    {
+      m_client = true;
+      SetBinaryMode();
+    }
+};
+
+
+class WebSocketBench : public PProcess
+{
+  PCLASSINFO(WebSocketBench, PProcess)
+  public:
+    void Main();
+
+  protected:
+    void Benchmark(PINDEX size, bool intoArray);
+    void Writer();
+
+    ClientWebSocket m_client;
+    PWebSocket      m_server;
+    PBYTEArray      m_message;
+    unsigned        m_count;
+};
+
+PCREATE_PROCESS(WebSocketBench);
+
+
+void WebSocketBench::Main()
+{
+  cout << "WebSocket Frame Benchmark" << endl;
+
+  PArgList & args = GetArguments();
+  args.Parse("n-count: Number of messages for each size, default 20000\n"
+             PTRACE_ARGLIST);
+
+  if (!args.IsParsed()) {
+    cerr << args.Usage();
+    return;
+  }
+
+  PTRACE_INITIALISE(args);
+
+  m_count = std::max(args.GetOptionAs('n', 20000U), 1U);
+
+  PTCPSocket listener;
+  if (!listener.Listen(PIPSocket::Address::GetLoopback())) {
+    cerr << "Could not listen: " << listener.GetErrorText() << endl;
+    return;
+  }
+
+  PTCPSocket * client = new PTCPSocket(listener.GetPort());
+  PTCPSocket * server = new PTCPSocket;
+  if (!client->Connect(PIPSocket::Address::GetLoopback()) || !server->Accept(listener) ||
+      !m_client.Open(client) || !m_server.Open(server)) {
+    cerr << "Could not connect sockets" << endl;
+    return;
+  }
+
+  cout << m_count << " messages for each size\n"
+       << "    Size     Buffer frames/s     MB/s   PBYTEArray frames/s     MB/s" << endl;
+
+  for (PINDEX size = 64; size <= 65536; size *= 4) {
+    cout << setw(8) << size;
+    Benchmark(size, false);
+    cout << "  ";
+    Benchmark(size, true);
+    cout << endl;
+  }
+}
+
+
+void WebSocketBench::Benchmark(PINDEX size, bool intoArray)
+{
+  m_message.SetSize(size);
+  for (PINDEX i = 0; i < size; ++i)
+    m_message[i] = (BYTE)(i*7);
+
+  PBYTEArray buffer(size), array;
+  unsigned failed = 0;
+
+  PThread * writer = new PThreadObj<WebSocketBench>(*this, &WebSocketBench::Writer, false, "Writer");
+
+  PTime start;
+  for (unsigned i = 0; i < m_count; ++i) {
+    if (intoArray) {
+      if (!m_server.ReadMessage(array) || array != m_message)
+        ++failed;
+    }
+    else {
+      PINDEX length;
+      if (!m_server.ReadMessage(buffer.GetPointer(), size, length) || length != size ||
+          (i == 0 && buffer != m_message))
+        ++failed;
+    }
+  }
+  PTimeInterval elapsed = PTime() - start;
+
+  // Every frame written has been read, so nothing should be left buffered
+  if (m_server.HasBufferedData())
+    ++failed;
+
+  writer->WaitForTermination();
+  delete writer;
+
+  PInt64 ms = std::max(elapsed.GetMilliSeconds(), (PInt64)1);
+  cout << setw(20) << (m_count*1000/ms)
+       << setw(9) << ((PInt64)m_count*size/1000/ms);
+  if (failed > 0)
+    cout << " (" << failed << " failed)";
+}
+
+
+void WebSocketBench::Writer()
+{
+  for (unsigned i = 0; i < m_count; ++i) {
+    if (!m_client.Write(m_message, m_message.GetSize()))
+      break;
+  }
+}
+
+#else
+
+class WebSocketBench : public PProcess
+{
+  PCLASSINFO(WebSocketBench, PProcess)
+  public:
+    void Main() { cerr << "No WebSocket support" << endl; }
+};
+
+PCREATE_PROCESS(WebSocketBench);
+
+#endif // P_SSL
+
+
+// End of File ///////////////////////////////////////////////////////////////
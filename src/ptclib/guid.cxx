@@ -158,14 +158,13 @@ PINDEX PGloballyUniqueID::HashFunction() const
 {
   PAssert(GetSize() == Size, "PGloballyUniqueID is invalid size");
 
-  static PINDEX NumBuckets = 53; // Should be prime number
-
 #if P_64BIT
   uint64_t * qwords = (uint64_t *)theArray;
-  return (qwords[0] ^ qwords[1]) % NumBuckets;
+  uint64_t hash = qwords[0] ^ qwords[1];
+  return (PINDEX)(hash ^ (hash >> 32));
 #else
   uint32_t * dwords = (uint32_t *)theArray;
-  return (dwords[0] ^ dwords[1] ^ dwords[2] ^ dwords[3]) % NumBuckets;
+  return dwords[0] ^ dwords[1] ^ dwords[2] ^ dwords[3];
 #endif
 }
 
@@ -41,6 +41,7 @@
 #endif
 
 #include <ctype.h>
+#include <deque>
 
 
 #define PTraceModule() "HTTP"
@@ -224,12 +225,14 @@ PHTTPClient::PHTTPClient(const PString & userAgent)
   : m_userAgentName(userAgent)
   , m_persist(true)
   , m_authentication(NULL)
+  , m_connectionIdle(false)
 {
 }
 
 
 PHTTPClient::~PHTTPClient()
 {
+  ReleaseConnection();
   delete m_authentication;
 }
 
@@ -285,6 +288,8 @@ int PHTTPClient::ExecuteCommand(Commands cmd,
         outMIME.SetAt(HostTag, url.GetHostPort());
     }
 
+    m_connectionIdle = false;
+
     if (!WriteCommand(cmd, url.AsString(PURL::RelativeOnly), outMIME, processor)) {
       lastResponseCode = TransportWriteError;
       lastResponseInfo = GetErrorText(LastWriteError);
@@ -298,6 +303,10 @@ int PHTTPClient::ExecuteCommand(Commands cmd,
 
     // Await a response, if all OK exit loop
     if (ReadResponse(replyMIME) && (lastResponseCode != Continue || ReadResponse(replyMIME))) {
+      // No body follows these, so the connection is immediately reusable
+      if (cmd == HEAD || lastResponseCode == NoContent || lastResponseCode == NotModified)
+        SetConnectionIdle(replyMIME);
+
       if (IsOK(lastResponseCode))
         return lastResponseCode;
 
@@ -491,6 +500,25 @@ bool PHTTPClient::ReadContentBody(PMIMEInfo & replyMIME, PBYTEArray & body)
 
 
 bool PHTTPClient::ReadContentBody(PMIMEInfo & replyMIME, ContentProcessor & processor)
+{
+  if (!InternalReadContentBody(replyMIME, processor))
+    return false;
+
+  // A body read to end of file has, by definition, closed the connection
+  if (GetErrorCode(LastReadError) == NoError &&
+        (replyMIME.Contains(ContentLengthTag()) || (replyMIME(TransferEncodingTag()) *= ChunkedTag())))
+    SetConnectionIdle(replyMIME);
+  return true;
+}
+
+
+void PHTTPClient::SetConnectionIdle(const PMIMEInfo & replyMIME)
+{
+  m_connectionIdle = m_persist && !(replyMIME(ConnectionTag()) *= "close");
+}
+
+
+bool PHTTPClient::InternalReadContentBody(PMIMEInfo & replyMIME, ContentProcessor & processor)
 {
   PCaselessString encoding = replyMIME(TransferEncodingTag());
 
@@ -764,13 +792,276 @@ bool PHTTPClient::DeleteDocument(const PURL & url)
 }
 
 
-bool PHTTPClient::ConnectURL(const PURL & url)
+#if P_SSL
+/* Contexts are shared by all clients using the same credentials, so that the
+   TLS session cache in the context lets later connections resume sessions. */
+static PSSLContext * GetClientContext(PSSLContext::Method method,
+                                      const PString & authority,
+                                      const PString & certificate,
+                                      const PString & privateKey)
 {
-  if (IsOpen())
-    return true;
+  typedef std::map<PString, PSSLContext *> ContextMap;
+  // Never deleted, channels may outlive static destruction
+  static PCriticalSection & mutex = *new PCriticalSection;
+  static ContextMap & contexts = *new ContextMap;
+
+  PStringStream key;
+  key << method << '\n' << authority << '\n' << certificate << '\n' << privateKey;
+
+  PWaitAndSignal lock(mutex);
+
+  ContextMap::iterator it = contexts.find(key);
+  if (it != contexts.end())
+    return it->second;
+
+  PSSLContext * context = new PSSLContext(method);
+  if (!context->SetCredentials(authority, certificate, privateKey)) {
+    delete context;
+    return NULL;
+  }
+
+  contexts[key] = context;
+  return context;
+}
+#endif
+
+
+/* Idle connections are kept per scheme/host/port, most recently used last.
+   Taking the most recent one gives the best chance that the server has not
+   timed it out, and means the oldest ones are the first to be aged out.
+   A timer, started when the first connection is released to the pool,
+   closes connections that have been idle too long even if the pool is not
+   used again. */
+class PHTTPClientConnectionPool : public PObject
+{
+    PCLASSINFO(PHTTPClientConnectionPool, PObject);
+  protected:
+    struct IdleConnection
+    {
+      IdleConnection(PChannel * channel) : m_channel(channel) { }
+      PChannel * m_channel;
+      PTime      m_idleSince;
+    };
+    typedef std::deque<IdleConnection> IdleList;
+    typedef std::map<PString, IdleList> IdleMap;
+
+    PCriticalSection m_mutex;
+    IdleMap          m_idle;
+    unsigned         m_maxPerHost;
+    PTimeInterval    m_idleTimeout;
+    PTimer           m_reapTimer;
+
+  public:
+    PHTTPClientConnectionPool()
+      : m_maxPerHost(8)
+      , m_idleTimeout(0, 15)
+    {
+      m_reapTimer.SetNotifier(PCREATE_NOTIFIER(OnReapTimer), "HTTPPool");
+    }
+
+
+    void SetLimits(unsigned maxPerHost, const PTimeInterval & idleTimeout)
+    {
+      std::vector<PChannel *> expired;
+      bool restartTimer;
+      {
+        PWaitAndSignal lock(m_mutex);
+        m_maxPerHost = maxPerHost;
+        m_idleTimeout = idleTimeout;
+        RemoveExpired(expired);
+        restartTimer = m_reapTimer.IsRunning();
+      }
+      DeleteChannels(expired);
+
+      // Not under m_mutex, as this waits for OnReapTimer() to finish
+      if (restartTimer)
+        m_reapTimer.RunContinuous(GetReapInterval());
+    }
+
+
+    void Clear()
+    {
+      std::vector<PChannel *> all;
+      {
+        PWaitAndSignal lock(m_mutex);
+        for (IdleMap::iterator it = m_idle.begin(); it != m_idle.end(); ++it) {
+          for (IdleList::iterator conn = it->second.begin(); conn != it->second.end(); ++conn)
+            all.push_back(conn->m_channel);
+        }
+        m_idle.clear();
+      }
+      DeleteChannels(all);
+    }
+
+
+    PChannel * Acquire(const PString & key)
+    {
+      for (;;) {
+        PChannel * channel;
+        std::vector<PChannel *> expired;
+        {
+          PWaitAndSignal lock(m_mutex);
+          RemoveExpired(expired);
+
+          IdleMap::iterator it = m_idle.find(key);
+          if (it == m_idle.end())
+            channel = NULL;
+          else {
+            channel = it->second.back().m_channel;
+            it->second.pop_back();
+            if (it->second.empty())
+              m_idle.erase(it);
+          }
+        }
+        DeleteChannels(expired);
+
+        if (channel == NULL || IsHealthy(channel))
+          return channel;
+
+        PTRACE(4, "Pooled connection to " << key.Left(key.Find('\n')) << " closed by server");
+        delete channel;
+      }
+    }
+
+
+    void Release(const PString & key, PChannel * channel)
+    {
+      std::vector<PChannel *> expired;
+      {
+        PWaitAndSignal lock(m_mutex);
+        RemoveExpired(expired);
+
+        if (m_maxPerHost == 0)
+          expired.push_back(channel);
+        else {
+          IdleList & idle = m_idle[key];
+          idle.push_back(IdleConnection(channel));
+          if (idle.size() > m_maxPerHost) {
+            expired.push_back(idle.front().m_channel);
+            idle.pop_front();
+          }
+
+          // Only the first time, after which the timer is never stopped
+          if (!m_reapTimer.IsRunning())
+            m_reapTimer.RunContinuous(GetReapInterval());
+        }
+      }
+      DeleteChannels(expired);
+    }
 
+
+  protected:
+    PTimeInterval GetReapInterval() const
+    {
+      return std::max(m_idleTimeout/2, PTimeInterval(0, 1));
+    }
+
+
+    PDECLARE_NOTIFIER(PTimer, PHTTPClientConnectionPool, OnReapTimer)
+    {
+      std::vector<PChannel *> expired;
+      {
+        PWaitAndSignal lock(m_mutex);
+        RemoveExpired(expired);
+      }
+      PTRACE_IF(4, !expired.empty(), "Closing " << expired.size() << " idle pooled connections");
+      DeleteChannels(expired);
+    }
+
+
+    void RemoveExpired(std::vector<PChannel *> & expired)
+    {
+      PTime now;
+      IdleMap::iterator it = m_idle.begin();
+      while (it != m_idle.end()) {
+        while (!it->second.empty() && (now - it->second.front().m_idleSince) > m_idleTimeout) {
+          expired.push_back(it->second.front().m_channel);
+          it->second.pop_front();
+        }
+        if (it->second.empty())
+          m_idle.erase(it++);
+        else
+          ++it;
+      }
+    }
+
+
+    static void DeleteChannels(const std::vector<PChannel *> & channels)
+    {
+      for (size_t i = 0; i < channels.size(); ++i)
+        delete channels[i];
+    }
+
+
+    /* An idle connection should have nothing to read, if the socket is
+       readable then the server has closed it, or sent something we did not
+       ask for, and either way it is unusable. */
+    static bool IsHealthy(PChannel * channel)
+    {
+      PSocket * socket = dynamic_cast<PSocket *>(channel->GetBaseReadChannel());
+      if (socket == NULL || !socket->IsOpen())
+        return false;
+
+      PSocket::SelectList readable;
+      readable += *socket;
+      return PSocket::Select(readable, 0) == PChannel::NoError && readable.IsEmpty();
+    }
+};
+
+
+static PHTTPClientConnectionPool & GetConnectionPool()
+{
+  static PHTTPClientConnectionPool & pool = *new PHTTPClientConnectionPool; // Never deleted, clients may outlive static destruction
+  return pool;
+}
+
+
+void PHTTPClient::SetConnectionPoolLimits(unsigned maxPerHost, const PTimeInterval & idleTimeout)
+{
+  GetConnectionPool().SetLimits(maxPerHost, idleTimeout);
+}
+
+
+void PHTTPClient::ClearConnectionPool()
+{
+  GetConnectionPool().Clear();
+}
+
+
+void PHTTPClient::ReleaseConnection()
+{
+  if (m_connectionIdle && unReadCount == 0 && !m_connectionKey.IsEmpty()) {
+    PChannel * channel = Detach();
+    if (channel != NULL) {
+      PTRACE(4, "Returning connection to " << m_connectionKey.Left(m_connectionKey.Find('\n')) << " to pool");
+      GetConnectionPool().Release(m_connectionKey, channel);
+    }
+  }
+
+  Close();
+  m_connectionKey.MakeEmpty();
+  m_connectionIdle = false;
+}
+
+
+bool PHTTPClient::ConnectURL(const PURL & url)
+{
   PString host = url.GetHostName();
 
+  PStringStream key;
+  key << url.GetScheme() << "://" << host << ':' << url.GetPort();
+#if P_SSL
+  if (url.GetScheme() == "https")
+    key << '\n' << m_authority << '\n' << m_certificate << '\n' << m_privateKey;
+#endif
+
+  if (IsOpen()) {
+    // Opened directly by the application, or already connected to this server
+    if (m_connectionKey.IsEmpty() || m_connectionKey == key)
+      return true;
+    ReleaseConnection();
+  }
+
   // Is not open or other end shut down, restablish connection
   if (host.IsEmpty()) {
     lastResponseCode = BadRequest;
@@ -778,6 +1069,21 @@ bool PHTTPClient::ConnectURL(const PURL & url)
     return SetErrorValues(ProtocolFailure, 0, LastReadError);
   }
 
+  m_connectionIdle = false;
+  unReadCount = 0;
+
+  if (m_persist) {
+    PChannel * channel = GetConnectionPool().Acquire(key);
+    if (channel != NULL) {
+      if (Open(channel)) {
+        m_connectionKey = key;
+        PTRACE(4, "Reusing pooled connection to " << host);
+        return true;
+      }
+      Close();
+    }
+  }
+
 #if P_SSL
   if (url.GetScheme() == "https") {
     PSSLChannel * ssl = NULL;
@@ -793,16 +1099,16 @@ bool PHTTPClient::ConnectURL(const PURL & url)
         return false;
       }
 
-      PSSLContext * context = new PSSLContext(method);
-      if (!context->SetCredentials(m_authority, m_certificate, m_privateKey)) {
+      PSSLContext * context = GetClientContext(method, m_authority, m_certificate, m_privateKey);
+      if (context == NULL) {
         lastResponseCode = TransportConnectError;
         lastResponseInfo = "Could not set certificates";
-        delete context;
         delete tcp;
         return false;
       }
 
-      ssl = new PSSLChannel(context, true);
+      ssl = new PSSLChannel(context, false);
+      ssl->SetSessionKey(PSTRSTRM(host << ':' << url.GetPort()));
       if (ssl->Connect(tcp))
         break;
 
@@ -833,6 +1139,7 @@ bool PHTTPClient::ConnectURL(const PURL & url)
     return false;
   }
 
+  m_connectionKey = key;
   PTRACE(5, "Connected to " << host);
   return true;
 }
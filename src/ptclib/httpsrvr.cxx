@@ -37,6 +37,15 @@
 #include <ptclib/random.h>
 #include <ctype.h>
 
+#if defined(__AVX2__)
+  #include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define P_WEBSOCKET_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  #include <arm_neon.h>
+#endif
+
 #define new PNEW
 
 
@@ -76,7 +85,12 @@ void PHTTPSpace::DestroyContents()
 void PHTTPSpace::CloneContents(const PHTTPSpace * c)
 {
   mutex = new PReadWriteMutex;
-  root = new Node(*c->root);
+
+  // A copied node shares its child list, so start again for an empty tree, e.g. of a moved from space
+  if (c->root->children.IsEmpty() && c->root->resource == NULL)
+    root = new Node(PString(), NULL);
+  else
+    root = new Node(*c->root);
 }
 
 
@@ -87,6 +101,29 @@ void PHTTPSpace::CopyContents(const PHTTPSpace & c)
 }
 
 
+#if P_HAS_MOVE_SEMANTICS
+void PHTTPSpace::ResetContents()
+{
+  // Shared by all moved from name spaces, StartWrite() etc copy them first
+  struct Empty {
+    static Empty * Create()
+    {
+      PMEMORY_IGNORE_ALLOCATIONS_FOR_SCOPE;
+      Empty * empty = new Empty;
+      empty->m_mutex = new PReadWriteMutex;
+      empty->m_root = new Node(PString(), NULL);
+      return empty;
+    }
+    PReadWriteMutex * m_mutex;
+    Node * m_root;
+  };
+  static Empty const * const EmptySpace = Empty::Create();
+  mutex = EmptySpace->m_mutex;
+  root = EmptySpace->m_root;
+}
+#endif
+
+
 PHTTPSpace::Node::Node(const PString & nam, Node * parentNode)
   : PString(nam)
 {
@@ -104,6 +141,7 @@ PHTTPSpace::Node::~Node()
 PBoolean PHTTPSpace::AddResource(PHTTPResource * res, AddOptions overwrite)
 {
   PAssert(res != NULL, PInvalidParameter);
+  MakeWritable();
   const PStringArray & path = res->GetURL().GetPath();
   Node * node = root;
   for (PINDEX i = 0; i < path.GetSize(); i++) {
@@ -141,6 +179,7 @@ PBoolean PHTTPSpace::AddResource(PHTTPResource * res, AddOptions overwrite)
 
 PBoolean PHTTPSpace::DelResource(const PURL & url)
 {
+  MakeWritable();
   const PStringArray & path = url.GetPath();
   Node * node = root;
   for (PINDEX i = 0; i < path.GetSize(); i++) {
@@ -246,6 +285,8 @@ PBoolean PHTTPServer::ProcessCommand()
   if (!ReadCommand(cmd, args))
     return false;
 
+  PPROFILE_HISTOGRAM("HTTP request");
+
   connectInfo.commandCode = (Commands)cmd;
   if (cmd < NumCommands)
     connectInfo.commandName = commandNames[cmd];
@@ -554,6 +595,7 @@ static const httpStatusCodeStruct * GetStatusCodeStruct(int code)
     { "Gone",                          PHTTP::Gone, 1, 1, 1 },
     { "Length Required",               PHTTP::LengthRequired, 1, 1, 1 },
     { "Unless True",                   PHTTP::UnlessTrue, 1, 1, 1 },
+    { "Requested Range Not Satisfiable", PHTTP::RequestedRangeNotSatisfiable, 1, 1, 1 },
     { "Not Implemented",               PHTTP::NotImplemented, 1 },
     { "Service Unavailable",           PHTTP::ServiceUnavailable, 1, 1, 1 },
     { "Gateway Timeout",               PHTTP::GatewayTimeout, 1, 1, 1 }
@@ -856,6 +898,50 @@ PHTTPRequest::PHTTPRequest(const PURL & _url,
 
 #if P_SSL
 
+/* Apply the RFC6455 masking key, an XOR with the four key bytes repeated, from
+   src to dst, which may be the same buffer. The mask is in wire byte order, so
+   a 32, 64, 128 or 256 bit load of the data lines up with the mask repeated to
+   that width regardless of machine endianness. The return value is the mask
+   rotated so the first byte of the key applies to the byte after the last one
+   processed, for when a frame payload is processed in pieces. */
+static uint32_t MaskPayload(BYTE * dst, const BYTE * src, PINDEX len, uint32_t mask)
+{
+  PINDEX i = 0;
+
+#if defined(__AVX2__)
+  __m256i mask256 = _mm256_set1_epi32((int)mask);
+  for (; i+32 <= len; i += 32)
+    _mm256_storeu_si256((__m256i *)(dst+i), _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(src+i)), mask256));
+#elif defined(P_WEBSOCKET_SSE2)
+  __m128i mask128 = _mm_set1_epi32((int)mask);
+  for (; i+16 <= len; i += 16)
+    _mm_storeu_si128((__m128i *)(dst+i), _mm_xor_si128(_mm_loadu_si128((const __m128i *)(src+i)), mask128));
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  uint8x16_t mask128 = vreinterpretq_u8_u32(vdupq_n_u32(mask));
+  for (; i+16 <= len; i += 16)
+    vst1q_u8(dst+i, veorq_u8(vld1q_u8(src+i), mask128));
+#endif
+
+  uint64_t mask64 = ((uint64_t)mask << 32) | mask;
+  for (; i+8 <= len; i += 8) {
+    uint64_t data;
+    memcpy(&data, src+i, 8);
+    data ^= mask64;
+    memcpy(dst+i, &data, 8);
+  }
+
+  const BYTE * key = (const BYTE *)&mask;
+  for (; i < len; ++i)
+    dst[i] = src[i] ^ key[i&3];
+
+  BYTE rotated[4];
+  for (i = 0; i < 4; ++i)
+    rotated[i] = key[(len+i)&3];
+  memcpy(&mask, rotated, 4);
+  return mask;
+}
+
+
 PWebSocket::PWebSocket()
   : m_client(false)
   , m_fragmentingWrite(false)
@@ -863,7 +949,10 @@ PWebSocket::PWebSocket()
   , m_remainingPayload(0)
   , m_currentMask(-1)
   , m_fragmentedRead(false)
+  , m_maxMessageSize(16*1024*1024)
   , m_recursiveRead(false)
+  , m_readAheadPos(0)
+  , m_readAheadLen(0)
 {
 }
 
@@ -874,7 +963,7 @@ PBoolean PWebSocket::Read(void * buf, PINDEX len)
     return false;
 
   if (m_recursiveRead)
-    return PIndirectChannel::Read(buf, len);
+    return ReadBuffered(buf, len);
 
   bool ok = false;
   m_recursiveRead = true;
@@ -891,40 +980,21 @@ PBoolean PWebSocket::Read(void * buf, PINDEX len)
 
       case ConnectionClose :
         lastReadCount = 0;
-        return false;
+        goto badRead;
 
       default:
         break;
     }
   }
 
-  if (len > (PINDEX)m_remainingPayload)
+  if ((uint64_t)len > m_remainingPayload)
     len = (PINDEX)m_remainingPayload;
 
   if (!PIndirectChannel::ReadBlock(buf, len))
     goto badRead;
 
-  if (m_currentMask >= 0) {
-    BYTE * ptr = (BYTE *)buf;
-    PINDEX count = GetLastReadCount();
-    while (count >= 4) {
-      *(uint32_t *)ptr ^= m_currentMask;
-      count -= 4;
-      ptr += 4;
-    }
-    switch (count) {
-      case 1 :
-        *(BYTE *)ptr ^= m_currentMask;
-        break;
-      case 2:
-        *(uint16_t *)ptr ^= m_currentMask;
-        break;
-      case 3:
-        *(uint16_t *)ptr ^= m_currentMask;
-        *(BYTE *)(ptr+2) ^= m_currentMask>>16;
-        break;
-    }
-  }
+  if (m_currentMask >= 0)
+    m_currentMask = MaskPayload((BYTE *)buf, (const BYTE *)buf, GetLastReadCount(), (uint32_t)m_currentMask);
 
   m_remainingPayload -= GetLastReadCount();
   ok = true;
@@ -942,10 +1012,21 @@ bool PWebSocket::ReadMessage(PBYTEArray & msg)
 
   PINDEX totalSize = 0;
   do {
+    /* Read what is left of the frame no more than a chunk at a time, growing
+       the buffer geometrically, so the length the peer claims cannot make us
+       allocate the memory */
     static const PINDEX chunkSize = 10000;
-    if (!Read(msg.GetPointer(totalSize + chunkSize) + totalSize, chunkSize))
+    PINDEX readSize = (PINDEX)std::min<uint64_t>(m_remainingPayload > 0 ? m_remainingPayload : chunkSize, chunkSize);
+    if (msg.GetSize() < totalSize + readSize && !msg.SetSize(std::max(totalSize + readSize, msg.GetSize()*2)))
+      return SetErrorValues(NoMemory, ENOMEM, LastReadError);
+    if (!Read(msg.GetPointer(totalSize + readSize) + totalSize, readSize))
       return false;
     totalSize += GetLastReadCount();
+
+    if ((uint64_t)totalSize + m_remainingPayload > (uint64_t)m_maxMessageSize) {
+      PTRACE(2, "WebSock\tMessage too large, over " << m_maxMessageSize << " bytes");
+      return SetErrorValues(BufferTooSmall, 0, LastReadError);
+    }
   } while (!IsMessageComplete());
 
   msg.SetSize(totalSize);
@@ -954,6 +1035,50 @@ bool PWebSocket::ReadMessage(PBYTEArray & msg)
 }
 
 
+bool PWebSocket::ReadMessage(void * buffer, PINDEX size, PINDEX & length)
+{
+  if (!PAssert(m_remainingPayload == 0, "Cannot call ReadMessage whan have partial frames unread."))
+    return false;
+
+  length = 0;
+  do {
+    if (length >= size)
+      return SetErrorValues(BufferTooSmall, 0, LastReadError);
+
+    if (!Read((BYTE *)buffer + length, size - length))
+      return false;
+    length += GetLastReadCount();
+  } while (!IsMessageComplete());
+
+  lastReadCount = length;
+  return true;
+}
+
+
+/* Frame headers and small payloads are taken from a read ahead buffer so a
+   burst of small messages costs one read of the underlying channel rather
+   than several per frame. Large payloads are read directly into the callers
+   buffer once the read ahead is exhausted. */
+bool PWebSocket::ReadBuffered(void * buf, PINDEX len)
+{
+  if (m_readAheadPos >= m_readAheadLen) {
+    if (len >= (PINDEX)sizeof(m_readAhead))
+      return PIndirectChannel::Read(buf, len);
+
+    if (!PIndirectChannel::Read(m_readAhead, sizeof(m_readAhead)))
+      return false;
+
+    m_readAheadPos = 0;
+    m_readAheadLen = GetLastReadCount();
+  }
+
+  lastReadCount = std::min(len, m_readAheadLen - m_readAheadPos);
+  memcpy(buf, m_readAhead + m_readAheadPos, lastReadCount);
+  m_readAheadPos += lastReadCount;
+  return true;
+}
+
+
 PBoolean PWebSocket::Write(const void * buf, PINDEX len)
 {
   if (CheckNotOpen())
@@ -966,11 +1091,11 @@ PBoolean PWebSocket::Write(const void * buf, PINDEX len)
   if (!WriteHeader(m_binaryWrite ? BinaryFrame : TextFrame, m_fragmentingWrite, len, mask))
     return false;
 
-  const uint32_t * ptr = (const uint32_t *)buf;
+  const BYTE * ptr = (const BYTE *)buf;
   while (len > 65536) {
     if (!WriteMasked(ptr, 65536, mask))
       return false;
-    ptr += 16384;
+    ptr += 65536;
     len -= 65536;
   }
 
@@ -978,13 +1103,11 @@ PBoolean PWebSocket::Write(const void * buf, PINDEX len)
 }
 
 
-bool PWebSocket::WriteMasked(const uint32_t * data, PINDEX len, uint32_t mask)
+bool PWebSocket::WriteMasked(const BYTE * data, PINDEX len, uint32_t & mask)
 {
-  uint32_t buffer[16384];
-  PINDEX i = (len+3) / 4;
-  while (i-- > 0)
-    buffer[i] = data[i] ^ mask;
-
+  BYTE buffer[65536];
+  PAssert(len <= (PINDEX)sizeof(buffer), PInvalidParameter);
+  mask = MaskPayload(buffer, data, len, mask);
   return PIndirectChannel::Write(buffer, len);
 }
 
@@ -1113,8 +1236,10 @@ bool PWebSocket::WriteHeader(OpCodes  opCode,
   }
 
   if (masking >= 0) {
+    // Mask is kept in wire byte order, as read by ReadHeader() and used by MaskPayload()
     header[1] |= 0x80;
-    *(PUInt32b *)&header[len] = (uint32_t)masking;
+    uint32_t mask32 = (uint32_t)masking;
+    memcpy(&header[len], &mask32, 4);
     len += 4;
   }
 
@@ -1674,6 +1799,35 @@ PString PHTTPString::LoadText(PHTTPRequest &)
 }
 
 
+//////////////////////////////////////////////////////////////////////////////
+// PHTTPHistogramResource
+
+PHTTPHistogramResource::PHTTPHistogramResource(const PURL & url)
+  : PHTTPString(url)
+{
+}
+
+
+PHTTPHistogramResource::PHTTPHistogramResource(const PURL & url, const PHTTPAuthority & auth)
+  : PHTTPString(url, auth)
+{
+}
+
+
+PString PHTTPHistogramResource::LoadText(PHTTPRequest & request)
+{
+  PStringStream html;
+  html << "<html><head><title>Latency Histograms</title></head><body>";
+  PProfiling::DumpHistograms(html, true);
+  html << "</body></html>";
+
+  if (request.url.GetQueryVars().Contains("reset"))
+    PProfiling::ResetHistograms();
+
+  return html;
+}
+
+
 //////////////////////////////////////////////////////////////////////////////
 // PHTTPFile
 
@@ -1735,6 +1889,9 @@ PHTTPFileRequest::PHTTPFileRequest(const PURL & url,
                                 PHTTPResource * resource,
                                   PHTTPServer & server)
   : PHTTPRequest(url, inMIME, multipartFormInfo, resource, server)
+  , m_streamFile(false)
+  , m_offset(0)
+  , m_length(0)
 {
 }
 
@@ -1757,11 +1914,126 @@ PBoolean PHTTPFile::LoadHeaders(PHTTPRequest & request)
     return false;
   }
 
-  request.contentSize = file.GetLength();
+  return LoadFileHeaders(request);
+}
+
+
+bool PHTTPFile::LoadFileHeaders(PHTTPRequest & request)
+{
+  PHTTPFileRequest & fileRequest = (PHTTPFileRequest&)request;
+  off_t fileLength = fileRequest.file.GetLength();
+  request.contentSize = fileLength;
+
+  PString type = request.outMIME.Get(PHTTP::ContentTypeTag(), GetContentType());
+  if (type.IsEmpty())
+    type = PMIMEInfo::GetContentType(fileRequest.file.GetFilePath().GetType());
+
+  // Text may be altered by OnLoadedText(), so must go through LoadData()
+  fileRequest.m_streamFile = !(type(0, 4) *= "text/");
+  if (!fileRequest.m_streamFile)
+    return true;
+
+  fileRequest.m_offset = 0;
+  fileRequest.m_length = fileLength;
+  request.outMIME.SetAt(PHTTP::AcceptRangesTag(), "bytes");
+
+  // Only a single range is supported, anything else gets the whole file, which is allowed
+  PCaselessString range = request.inMIME.Get(PHTTP::RangeTag()).Trim();
+  if (range.NumCompare("bytes=", 6) != EqualTo || range.Find(',') != P_MAX_INDEX || request.inMIME.Contains(PHTTP::IfRangeTag()))
+    return true;
+
+  PINDEX dash = range.Find('-');
+  if (dash == P_MAX_INDEX)
+    return true;
+
+  PString firstStr = range(6, dash-1).Trim();
+  PString lastStr = range.Mid(dash+1).Trim();
+
+  off_t first, last = fileLength-1;
+  if (firstStr.IsEmpty()) {
+    // Suffix range, the last N bytes of the file
+    off_t suffix = lastStr.AsInt64();
+    first = suffix > 0 ? PMAX(fileLength - suffix, (off_t)0) : fileLength;
+  }
+  else {
+    first = firstStr.AsInt64();
+    if (!lastStr.IsEmpty()) {
+      off_t end = lastStr.AsInt64();
+      if (end < first)
+        return true; // Invalid, so ignored
+      if (end < last)
+        last = end;
+    }
+  }
+
+  if (first >= fileLength) {
+    PTRACE(3, "HTTPServer\tRange \"" << range << "\" not satisfiable, file size " << fileLength);
+    // Sent by SendData() as an empty body, as OnError() cannot add the Content-Range
+    fileRequest.m_length = 0;
+    request.contentSize = 0;
+    request.code = PHTTP::RequestedRangeNotSatisfiable;
+    request.outMIME.SetAt(PHTTP::ContentRangeTag(), PSTRSTRM("bytes */" << fileLength));
+    return true;
+  }
+
+  fileRequest.m_offset = first;
+  fileRequest.m_length = last - first + 1;
+  request.contentSize = fileRequest.m_length;
+  request.code = PHTTP::PartialContent;
+  request.outMIME.SetAt(PHTTP::ContentRangeTag(), PSTRSTRM("bytes " << first << '-' << last << '/' << fileLength));
   return true;
 }
 
 
+void PHTTPFile::SendData(PHTTPRequest & request)
+{
+  PHTTPFileRequest & fileRequest = (PHTTPFileRequest&)request;
+  if (!fileRequest.m_streamFile || !fileRequest.file.IsOpen()) {
+    PHTTPResource::SendData(request);
+    return;
+  }
+
+  if (!request.outMIME.Contains(PHTTP::ContentTypeTag) && !contentType)
+    request.outMIME.SetAt(PHTTP::ContentTypeTag, contentType);
+
+  // Always an explicit length, as cannot use chunked encoding
+  request.outMIME.SetAt(PHTTP::ContentLengthTag(), PString(PString::Unsigned, fileRequest.m_length));
+  request.server.StartResponse(request.code, request.outMIME, request.contentSize);
+  request.server.flush();
+
+  bool ok;
+  PTCPSocket * socket = dynamic_cast<PTCPSocket *>(request.server.GetWriteChannel());
+  if (fileRequest.m_length == 0)
+    ok = true;
+  else if (socket != NULL) {
+    socket->SetWriteTimeout(request.server.GetWriteTimeout());
+    ok = socket->SendFile(fileRequest.file, fileRequest.m_offset, fileRequest.m_length);
+  }
+  else {
+    // Probably SSL, which has to go through user space anyway
+    PFile & file = fileRequest.file;
+    off_t length = fileRequest.m_length;
+    PBYTEArray buffer((PINDEX)PMIN(length, (off_t)65536));
+    ok = file.SetPosition(fileRequest.m_offset);
+    while (ok && length > 0) {
+      ok = file.Read(buffer.GetPointer(), (PINDEX)PMIN(length, (off_t)buffer.GetSize())) &&
+           file.GetLastReadCount() > 0 &&
+           request.server.Write(buffer, file.GetLastReadCount());
+      length -= file.GetLastReadCount();
+    }
+  }
+
+  if (!ok) {
+    PTRACE(2, "HTTPServer\tCould not send " << fileRequest.file.GetFilePath() << ": " << request.server.GetErrorText(PChannel::LastWriteError));
+    /* Cannot honour the Content-Length that was sent, so the connection must
+       not be reused. Removing the length makes OnGETData() return false, and
+       the shutdown stops anything else being written on the connection. */
+    request.outMIME.RemoveAt(PHTTP::ContentLengthTag());
+    request.server.Shutdown(PChannel::ShutdownReadAndWrite);
+  }
+}
+
+
 PBoolean PHTTPFile::LoadData(PHTTPRequest & request, PCharArray & data)
 {
   PFile & file = ((PHTTPFileRequest&)request).file;
@@ -1852,8 +2124,13 @@ PHTTPTailFile::PHTTPTailFile(const PURL & url,
 
 PBoolean PHTTPTailFile::LoadHeaders(PHTTPRequest & request)
 {
-  if (!PHTTPFile::LoadHeaders(request))
+  // Do not use PHTTPFile::LoadHeaders() as cannot stream or do ranges
+  PFile & file = ((PHTTPFileRequest&)request).file;
+
+  if (!file.Open(filePath, PFile::ReadOnly)) {
+    request.code = PHTTP::NotFound;
     return false;
+  }
 
   request.contentSize = P_MAX_INDEX;
   return true;
@@ -2018,9 +2295,8 @@ PBoolean PHTTPDirectory::LoadHeaders(PHTTPRequest & request)
   if (file.IsOpen()) {
     request.outMIME.SetAt(PHTTP::ContentTypeTag(),
                           PMIMEInfo::GetContentType(file.GetFilePath().GetType()));
-    request.contentSize = file.GetLength();
     fakeIndex = PString();
-    return true;
+    return LoadFileHeaders(request);
   }
 
   // construct a directory listing
@@ -79,8 +79,14 @@ PHTTPServiceProcess::PHTTPServiceProcess(const Info & inf)
   , m_copyrightHomePage(inf.copyrightHomePage != NULL ? inf.copyrightHomePage : (const char *)m_manufacturersHomePage)
   , m_copyrightEmail(inf.copyrightEmail != NULL ? inf.copyrightEmail : (const char *)m_manufacturersEmail)
   , m_restartThread(NULL)
+  , m_httpMaxWorkers(0)
+  , m_httpMaxInFlight(0)
+  , m_httpIdleTimeout(0, 30)
+  , m_httpReactor(NULL)
+  , m_httpThreadPool(NULL)
 {
   m_httpThreads.DisallowDeleteObjects();
+  m_httpIdleTimer.SetNotifier(PCREATE_NOTIFIER(OnHTTPIdleCheck), "HTTPIdle");
 }
 
 
@@ -192,6 +198,8 @@ PHTTPServiceProcess::Params::Params(const char * configPageName, const char * se
   , m_fullLogPage(NULL)
   , m_clearLogPage(NULL)
   , m_tailLogPage(NULL)
+  , m_memoryUsagePageName(NULL)
+  , m_memoryUsagePage(NULL)
   , m_httpPortKey("HTTP Port")
   , m_httpInterfacesKey("HTTP Interfaces")
   , m_httpPort(0)
@@ -297,6 +305,11 @@ bool PHTTPServiceProcess::InitialiseBase(Params & params)
     }
   }
 
+  if (params.m_memoryUsagePageName != NULL) {
+    params.m_memoryUsagePage = new MemoryUsagePage(*this, params.m_memoryUsagePageName, params.m_authority);
+    m_httpNameSpace.AddResource(params.m_memoryUsagePage, PHTTPSpace::Overwrite);
+  }
+
   return true;
 }
 
@@ -372,6 +385,54 @@ PBoolean PHTTPServiceProcess::ClearLogPage::Post(PHTTPRequest & request, const P
 }
 
 
+PHTTPServiceProcess::MemoryUsagePage::MemoryUsagePage(PHTTPServiceProcess & process, const PURL & url, const PHTTPAuthority & auth)
+  : PServiceHTTPString(url, auth)
+  , m_process(process)
+{
+}
+
+
+PString PHTTPServiceProcess::MemoryUsagePage::LoadText(PHTTPRequest & request)
+{
+  PHTML html;
+  html << PHTML::Title(m_process.GetName() & "Memory Usage")
+       << PHTML::Body()
+       << m_process.GetPageGraphic()
+       << PHTML::Heading(1) << "Memory Usage by Class" << PHTML::Heading(1);
+
+  PMemoryUsage::ClassList classes;
+  if (!PMemoryUsage::GetClasses(classes))
+    html << PHTML::Paragraph() << "Memory usage accounting is not available in this build.";
+  else {
+    size_t maxClasses = request.url.GetQueryVars()("max", "100").AsUnsigned();
+    if (maxClasses > 0 && classes.size() > maxClasses)
+      classes.resize(maxClasses);
+
+    html << PHTML::TableStart("border=1 cellspacing=0 cellpadding=4")
+         << PHTML::TableRow()
+         << PHTML::TableHeader() << "Class"
+         << PHTML::TableHeader() << "Objects"
+         << PHTML::TableHeader() << "Bytes"
+         << PHTML::TableHeader() << "Allocations";
+    for (PMemoryUsage::ClassList::iterator it = classes.begin(); it != classes.end(); ++it)
+      html << PHTML::TableRow()
+           << PHTML::TableData() << PHTML::Escaped(PMemoryUsage::GetClassName(it->m_className).c_str())
+           << PHTML::TableData("ALIGN=RIGHT") << it->m_objects
+           << PHTML::TableData("ALIGN=RIGHT") << it->m_bytes
+           << PHTML::TableData("ALIGN=RIGHT") << it->m_allocations;
+    html << PHTML::TableEnd();
+  }
+
+  html << PHTML::HRule()
+       << m_process.GetCopyrightText()
+       << PHTML::Body();
+
+  string = html;
+
+  return PServiceHTTPString::LoadText(request);
+}
+
+
 bool PHTTPServiceProcess::ListenForHTTP(WORD port,
                                         PSocket::Reusability reuse,
                                         PINDEX stackSize)
@@ -425,8 +486,12 @@ bool PHTTPServiceProcess::ListenForHTTP(const PString & interfaces,
     }
   }
 
-  if (atLeastOne && stackSize > 1000)
-    new PHTTPServiceThread(stackSize, *this);
+  if (atLeastOne) {
+    if (m_httpMaxWorkers > 0)
+      StartHTTPThreadPool();
+    else if (stackSize > 1000)
+      new PHTTPServiceThread(stackSize, *this);
+  }
 
   return atLeastOne;
 }
@@ -451,7 +516,9 @@ bool PHTTPServiceProcess::ListenForHTTP(PSocket * listener,
   PSYSTEMLOG(Debug, "HTTPSVC\tListening for HTTP on " << *listener);
   m_httpListeningSockets.Append(listener);
 
-  if (stackSize > 1000)
+  if (m_httpMaxWorkers > 0)
+    StartHTTPThreadPool();
+  else if (stackSize > 1000)
     new PHTTPServiceThread(stackSize, *this);
 
   return true;
@@ -466,6 +533,8 @@ void PHTTPServiceProcess::ShutdownListener()
   PSYSTEMLOG(Debug, "HTTPSVC\tClosing listener socket on port "
                  << m_httpListeningSockets.front().GetPort());
 
+  StopHTTPThreadPool();
+
   for (PSocketList::iterator it = m_httpListeningSockets.begin(); it != m_httpListeningSockets.end(); ++it)
     it->Close();
 
@@ -601,6 +670,273 @@ PBoolean PHTTPServiceProcess::ProcessHTTP(PTCPSocket & socket)
 }
 
 
+void PHTTPServiceProcess::SetHTTPThreadPool(unsigned maxWorkers, unsigned maxInFlight, const PTimeInterval & idleTimeout)
+{
+  PAssert(m_httpListeningSockets.IsEmpty(), "Must set HTTP thread pool before listening");
+  m_httpMaxWorkers = maxWorkers;
+  m_httpMaxInFlight = maxInFlight;
+  m_httpIdleTimeout = idleTimeout;
+}
+
+
+PHTTPServiceProcess::HTTPPoolStatistics::HTTPPoolStatistics()
+  : m_connections(0)
+  , m_inFlight(0)
+  , m_deferred(0)
+  , m_requests(0)
+{
+}
+
+
+PTimeInterval PHTTPServiceProcess::HTTPPoolStatistics::GetAverageQueueLatency() const
+{
+  return m_requests > 0 ? PTimeInterval(m_totalQueueLatency.GetMilliSeconds()/m_requests) : PTimeInterval();
+}
+
+
+PHTTPServiceProcess::HTTPPoolStatistics PHTTPServiceProcess::GetHTTPPoolStatistics() const
+{
+  PWaitAndSignal mutex(m_httpPoolMutex);
+  HTTPPoolStatistics statistics = m_httpStatistics;
+  statistics.m_connections = m_httpConnections.size();
+  statistics.m_deferred = m_httpDeferred.size();
+  return statistics;
+}
+
+
+PHTTPServiceProcess::HTTPConnection::HTTPConnection(PTCPSocket * socket, PHTTPServer * server)
+  : m_socket(socket)
+  , m_server(server)
+  , m_lastActivity(PTimer::Tick())
+  , m_waiting(false)
+  , m_idleClosed(false)
+{
+}
+
+
+PHTTPServiceProcess::HTTPConnection::~HTTPConnection()
+{
+  delete m_server;
+  delete m_socket;
+}
+
+
+void PHTTPServiceProcess::StartHTTPThreadPool()
+{
+  PWaitAndSignal mutex(m_httpPoolMutex);
+
+  if (m_httpReactor != NULL)
+    return;
+
+  m_httpThreadPool = new PQueuedThreadPool<HTTPWork>(m_httpMaxWorkers, 0, "HTTP Worker");
+
+  m_httpReactor = new PSocketReactor;
+  for (PSocketList::iterator it = m_httpListeningSockets.begin(); it != m_httpListeningSockets.end(); ++it)
+    m_httpReactor->Add(*it, PCREATE_NOTIFIER(OnHTTPReadable));
+  m_httpReactor->Start("HTTP Reactor");
+
+  if (m_httpIdleTimeout > 0)
+    m_httpIdleTimer.RunContinuous(std::max(m_httpIdleTimeout/4, PTimeInterval(0, 1)));
+
+  PSYSTEMLOG(Debug, "HTTPSVC\tStarted HTTP thread pool: workers=" << m_httpMaxWorkers << " in-flight=" << m_httpMaxInFlight);
+}
+
+
+void PHTTPServiceProcess::StopHTTPThreadPool()
+{
+  m_httpIdleTimer.Stop();
+
+  PSocketReactor * reactor;
+  PQueuedThreadPool<HTTPWork> * threadPool;
+  {
+    PWaitAndSignal mutex(m_httpPoolMutex);
+    reactor = m_httpReactor;
+    m_httpReactor = NULL;
+    threadPool = m_httpThreadPool;
+    m_httpThreadPool = NULL;
+  }
+
+  if (reactor == NULL)
+    return;
+
+  // Outside of mutex as reactor thread may be waiting on it in OnHTTPReadable
+  reactor->Stop();
+  delete reactor;
+
+  // Break any workers out of reads
+  m_httpPoolMutex.Wait();
+  for (HTTPConnectionMap::iterator it = m_httpConnections.begin(); it != m_httpConnections.end(); ++it)
+    it->second->m_socket->Close();
+  m_httpPoolMutex.Signal();
+
+  threadPool->Shutdown();
+  delete threadPool;
+
+  m_httpPoolMutex.Wait();
+  for (HTTPConnectionMap::iterator it = m_httpConnections.begin(); it != m_httpConnections.end(); ++it)
+    delete it->second;
+  m_httpConnections.clear();
+  m_httpDeferred.clear();
+  m_httpStatistics.m_inFlight = 0;
+  m_httpPoolMutex.Signal();
+}
+
+
+void PHTTPServiceProcess::OnHTTPReadable(PSocketReactor & reactor, PSocket & socket)
+{
+  {
+    PWaitAndSignal mutex(m_httpPoolMutex);
+
+    if (m_httpThreadPool == NULL)
+      return; // Shutting down
+
+    HTTPConnectionMap::iterator it = m_httpConnections.find(&socket);
+    if (it != m_httpConnections.end()) {
+      // Request is ready, take out of reactor while worker processes it
+      reactor.Remove(socket);
+      it->second->m_waiting = false;
+      if (it->second->m_idleClosed) {
+        PTRACE(4, "HTTPSVC", "Closing idle HTTP connection " << socket);
+        delete it->second;
+        m_httpConnections.erase(it);
+      }
+      else
+        QueueHTTPWork(it->second);
+      return;
+    }
+  }
+
+  /* Must be a listener, and a client is connecting. Only the accept is done
+     here, outside of the mutex. Creating the server may block, e.g. for a
+     TLS handshake, so is left to a worker, see ProcessHTTPWork(). */
+  PTCPSocket * tcp = new PTCPSocket;
+  if (!tcp->Accept(socket)) {
+    if (tcp->GetErrorCode() != PChannel::Interrupted) {
+      PSYSTEMLOG(Error, "Accept failed for HTTP: " << tcp->GetErrorText());
+    }
+    delete tcp;
+    return;
+  }
+
+  PWaitAndSignal mutex(m_httpPoolMutex);
+
+  if (m_httpThreadPool == NULL) {
+    delete tcp;
+    return;
+  }
+
+  HTTPConnection * connection = new HTTPConnection(tcp, NULL);
+  m_httpConnections[tcp] = connection;
+  QueueHTTPWork(connection);
+}
+
+
+void PHTTPServiceProcess::QueueHTTPWork(HTTPConnection * connection)
+{
+  // Assumes m_httpPoolMutex already locked
+
+  if (m_httpMaxInFlight > 0 && m_httpStatistics.m_inFlight >= m_httpMaxInFlight) {
+    PTRACE(4, "HTTPSVC", "Deferring HTTP request on " << *connection->m_socket << ", " << m_httpStatistics.m_inFlight << " in flight");
+    m_httpDeferred.push_back(connection);
+    return;
+  }
+
+  ++m_httpStatistics.m_inFlight;
+  m_httpThreadPool->AddWork(new HTTPWork(*this, connection));
+}
+
+
+void PHTTPServiceProcess::ProcessHTTPWork(HTTPConnection & connection, const PTimeInterval & readyTime)
+{
+  bool persist;
+
+  if (connection.m_server == NULL) {
+    /* Newly accepted, create server here as it may block, e.g. for a TLS
+       handshake, which a silent client should not hold a worker in for long */
+    if (m_httpIdleTimeout > 0)
+      connection.m_socket->SetReadTimeout(m_httpIdleTimeout);
+    connection.m_server = CreateHTTPServer(*connection.m_socket);
+    persist = connection.m_server != NULL;
+    if (!persist) {
+      PSYSTEMLOG(Error, "HTTP server creation/open failed.");
+    }
+  }
+  else {
+    PTimeInterval latency = PTimer::Tick() - readyTime;
+
+    m_httpPoolMutex.Wait();
+    ++m_httpStatistics.m_requests;
+    m_httpStatistics.m_totalQueueLatency += latency;
+    if (m_httpStatistics.m_maxQueueLatency < latency)
+      m_httpStatistics.m_maxQueueLatency = latency;
+    m_httpPoolMutex.Signal();
+
+    persist = connection.m_server->ProcessCommand();
+
+    // if a restart was requested, then do it, but only if we are not shutting down
+    if (!m_httpListeningSockets.IsEmpty() && m_httpListeningSockets.front().IsOpen())
+      CompleteRestartSystem();
+  }
+
+  PWaitAndSignal mutex(m_httpPoolMutex);
+
+  --m_httpStatistics.m_inFlight;
+
+  if (m_httpReactor == NULL)
+    return; // Shutting down, StopHTTPThreadPool() cleans up
+
+  if (!m_httpDeferred.empty()) {
+    HTTPConnection * deferred = m_httpDeferred.front();
+    m_httpDeferred.pop_front();
+    QueueHTTPWork(deferred);
+  }
+
+  connection.m_lastActivity = PTimer::Tick();
+
+  if (persist && connection.m_socket->IsOpen()) {
+    /* A pipelined request may already have been read from the socket, into
+       the read ahead of the server or the TLS layer, and will not make the
+       socket readable, so the reactor would not see it. */
+    if (connection.m_server->HasBufferedData()) {
+      PTRACE(5, "HTTPSVC", "Buffered HTTP request on " << *connection.m_socket);
+      QueueHTTPWork(&connection);
+      return;
+    }
+
+    connection.m_waiting = m_httpReactor->Add(*connection.m_socket, PCREATE_NOTIFIER(OnHTTPReadable));
+    if (connection.m_waiting)
+      return;
+  }
+
+  m_httpConnections.erase(connection.m_socket);
+  delete &connection;
+}
+
+
+void PHTTPServiceProcess::OnHTTPIdleCheck(PTimer &, P_INT_PTR)
+{
+  /* Removing the socket from the reactor here would have to be done outside
+     of m_httpPoolMutex, as Remove() waits for reactor callbacks, and by then
+     a worker may have deleted the connection. So the socket is shut down
+     under the mutex instead, the reactor reports it readable, and
+     OnHTTPReadable() deletes it. Connections being processed or deferred
+     are not waiting, and are left alone. */
+  PWaitAndSignal mutex(m_httpPoolMutex);
+
+  if (m_httpReactor == NULL)
+    return;
+
+  PTimeInterval now = PTimer::Tick();
+  for (HTTPConnectionMap::iterator it = m_httpConnections.begin(); it != m_httpConnections.end(); ++it) {
+    HTTPConnection & connection = *it->second;
+    if (connection.m_waiting && !connection.m_idleClosed && now - connection.m_lastActivity > m_httpIdleTimeout) {
+      connection.m_idleClosed = true;
+      connection.m_socket->Shutdown(PSocket::ShutdownReadAndWrite);
+    }
+  }
+}
+
+
 void PHTTPServiceProcess::BeginRestartSystem()
 {
   if (m_restartThread == NULL) {
@@ -114,6 +114,12 @@ int PInternetProtocol::ReadChar()
 }
 
 
+bool PInternetProtocol::HasBufferedData() const
+{
+  return unReadCount > 0 || PIndirectChannel::HasBufferedData();
+}
+
+
 PBoolean PInternetProtocol::Write(const void * buf, PINDEX len)
 {
   if (len == 0 || stuffingState == DontStuff)
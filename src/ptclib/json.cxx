@@ -40,51 +40,81 @@
 #define new PNEW
 
 
-static PJSON::Base * CreateByType(PJSON::Types type)
+template <class T> static PJSON::Base * CreateValue(PArena * arena)
+{
+  return arena != NULL ? arena->New<T>() : new T;
+}
+
+
+template <class T> static PJSON::Base * CreateContainer(PArena * arena)
+{
+  return arena != NULL ? arena->New<T>(arena) : new T(arena);
+}
+
+
+static void DeleteValue(PJSON::Base * value, PArena * arena)
+{
+  if (arena != NULL)
+    PArena::Delete(value);
+  else
+    delete value;
+}
+
+
+static PJSON::Base * CreateByType(PJSON::Types type, PArena * arena)
 {
   switch (type) {
     case PJSON::e_Object :
-      return new PJSON::Object;
+      return CreateContainer<PJSON::Object>(arena);
     case PJSON::e_Array :
-      return new PJSON::Array;
+      return CreateContainer<PJSON::Array>(arena);
     case PJSON::e_String :
-      return new PJSON::String;
+      return CreateValue<PJSON::String>(arena);
     case PJSON::e_Number :
-      return new PJSON::Number;
+      return CreateValue<PJSON::Number>(arena);
     case PJSON::e_Boolean :
-      return new PJSON::Boolean;
+      return CreateValue<PJSON::Boolean>(arena);
     case PJSON::e_Null :
-      return new PJSON::Null;
+      return CreateValue<PJSON::Null>(arena);
   }
 
   return NULL;
 }
 
 
-PJSON::PJSON()
-  : m_root(new Null)
+PJSON::PJSON(PArena * arena)
+  : m_arena(arena)
+  , m_root(CreateValue<Null>(arena))
   , m_valid(true)
 {
 }
 
 
-PJSON::PJSON(Types type)
-  : m_root(CreateByType(type))
+PJSON::PJSON(Types type, PArena * arena)
+  : m_arena(arena)
+  , m_root(CreateByType(type, arena))
   , m_valid(m_root != NULL)
 {
     if (m_root == NULL)
-        m_root = new Null;
+        m_root = CreateValue<Null>(arena);
 }
 
 
-PJSON::PJSON(const PString & str)
-  : m_root(NULL)
+PJSON::PJSON(const PString & str, PArena * arena)
+  : m_arena(arena)
+  , m_root(NULL)
   , m_valid(false)
 {
   FromString(str);
 }
 
 
+PJSON::~PJSON()
+{
+  DeleteValue(m_root, m_arena);
+}
+
+
 bool PJSON::FromString(const PString & str)
 {
   PStringStream strm(str);
@@ -102,16 +132,16 @@ PString PJSON::AsString(std::streamsize indent) const
 }
 
 
-static PJSON::Base * CreateFromStream(istream & strm)
+static PJSON::Base * CreateFromStream(istream & strm, PArena * arena)
 {
   strm >> ws;
   switch (strm.peek()) {
     case '{' :
-      return new PJSON::Object;
+      return CreateContainer<PJSON::Object>(arena);
     case '[' :
-      return new PJSON::Array;
+      return CreateContainer<PJSON::Array>(arena);
     case '"' :
-      return new PJSON::String;
+      return CreateValue<PJSON::String>(arena);
     case '0' :
     case '1' :
     case '2' :
@@ -122,15 +152,15 @@ static PJSON::Base * CreateFromStream(istream & strm)
     case '7' :
     case '8' :
     case '9' :
-      return new PJSON::Number;
+      return CreateValue<PJSON::Number>(arena);
     case 'T' :
     case 't' :
     case 'F' :
     case 'f' :
-      return new PJSON::Boolean;
+      return CreateValue<PJSON::Boolean>(arena);
     case 'N' :
     case 'n' :
-      return new PJSON::Null;
+      return CreateValue<PJSON::Null>(arena);
   }
 
   strm.setstate(ios::failbit);
@@ -139,14 +169,14 @@ static PJSON::Base * CreateFromStream(istream & strm)
 
 void PJSON::ReadFrom(istream & strm)
 {
-  delete m_root;
-  m_root = CreateFromStream(strm);
+  DeleteValue(m_root, m_arena);
+  m_root = CreateFromStream(strm, m_arena);
   if (m_root != NULL) {
     m_root->ReadFrom(strm);
     m_valid = !(strm.bad() || strm.fail());
   }
   else {
-    m_root = new Null;
+    m_root = CreateValue<Null>(m_arena);
     m_valid = false;
   }
 }
@@ -265,7 +295,7 @@ static void PrintString(ostream & strm, const PString & str)
 PJSON::Object::~Object()
 {
   for (iterator it = begin(); it != end(); ++it)
-    delete it->second;
+    DeleteValue(it->second, m_arena);
 }
 
 
@@ -294,7 +324,7 @@ void PJSON::Object::ReadFrom(istream & strm)
     if (!Expect(strm, ':'))
       return;
 
-    Base * value = CreateFromStream(strm);
+    Base * value = CreateFromStream(strm, m_arena);
     if (value == NULL)
       return;
 
@@ -391,7 +421,7 @@ bool PJSON::Object::Set(const PString & name, Types type)
   if (find(name) != end())
     return false;
 
-  Base * ptr = CreateByType(type);
+  Base * ptr = CreateByType(type, m_arena);
   if (ptr == NULL)
     return false;
 
@@ -444,7 +474,7 @@ bool PJSON::Object::SetBoolean(const PString & name, bool value)
 PJSON::Array::~Array()
 {
   for (iterator it = begin(); it != end(); ++it)
-    delete *it;
+    DeleteValue(*it, m_arena);
 }
 
 
@@ -466,7 +496,7 @@ void PJSON::Array::ReadFrom(istream & strm)
   strm.putback(close);
 
   do {
-    Base * value = CreateFromStream(strm);
+    Base * value = CreateFromStream(strm, m_arena);
     if (value == NULL)
       return;
 
@@ -557,7 +587,7 @@ bool PJSON::Array::GetBoolean(size_t index) const
 
 void PJSON::Array::Append(Types type)
 {
-  Base * ptr = CreateByType(type);
+  Base * ptr = CreateByType(type, m_arena);
   if (ptr != NULL)
     push_back(ptr);
 }
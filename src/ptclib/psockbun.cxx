@@ -426,6 +426,7 @@ PMonitoredSockets::PMonitoredSockets(bool reuseAddr P_NAT_PARAM(PNatMethods * na
 #endif
   , m_opened(false)
   , m_interfaceAddedSignal(m_localPort, PIPSocket::GetDefaultIpAddressFamily())
+  , m_readBatchSize(1)
 {
 }
 
@@ -519,6 +520,10 @@ bool PMonitoredSockets::DestroySocket(SocketInfo & info)
     }
   }
 
+  PTRACE_IF(3, info.readBatch.m_index < info.readBatch.m_count,
+            "Discarding " << (info.readBatch.m_count - info.readBatch.m_index) << " queued datagrams for UDP socket " << info.socket);
+  info.readBatch.m_count = info.readBatch.m_index = 0;
+
   PTRACE(4, "Deleting UDP socket " << info.socket);
   delete info.socket;
   info.socket = NULL;
@@ -558,14 +563,16 @@ void PMonitoredSockets::SocketInfo::Write(BundleParams & param)
 
 
 void PMonitoredSockets::ReadFromSocketList(PSocket::SelectList & readers,
-                                           PUDPSocket * & socket,
+                                           SocketInfo & info,
                                            BundleParams & param)
 {
   // Assume is already locked
 
-  socket = NULL;
   param.m_lastCount = 0;
 
+  if (ReadFromBatch(info.readBatch, param))
+    return;
+
   UnlockReadWrite();
 
   param.m_errorCode = PSocket::Select(readers, param.m_timeout);
@@ -601,15 +608,42 @@ void PMonitoredSockets::ReadFromSocketList(PSocket::SelectList & readers,
     return;
   }
 
-  socket = (PUDPSocket *)&readers.front();
+  PUDPSocket * socket = (PUDPSocket *)&readers.front();
+  ReadFromSocket(socket, socket == info.socket ? &info.readBatch : NULL, param);
+}
 
-  bool ok = socket->ReadFrom(param.m_buffer, param.m_length, param.m_addr, param.m_port);
-  param.m_lastCount = socket->GetLastReadCount();
-  param.m_errorCode = socket->GetErrorCode(PChannel::LastReadError);
-  param.m_errorNumber = socket->GetErrorNumber(PChannel::LastReadError);
 
-  if (ok)
-    return;
+void PMonitoredSockets::ReadFromSocket(PUDPSocket * socket, ReadBatch * batch, BundleParams & param)
+{
+  // Assume is already locked, and socket is readable
+
+  bool ok;
+  if (m_readBatchSize > 1 && batch != NULL) {
+    // Each socket has its own queue, so reading one never loses those of another
+    batch->m_datagrams.resize(m_readBatchSize);
+    for (PIPDatagramSocket::Datagrams::iterator it = batch->m_datagrams.begin(); it != batch->m_datagrams.end(); ++it) {
+      if (it->m_data.GetSize() < param.m_length)
+        it->m_data.SetSize(param.m_length);
+    }
+
+    ok = socket->ReadFromMulti(batch->m_datagrams);
+    param.m_errorCode = socket->GetErrorCode(PChannel::LastReadError);
+    param.m_errorNumber = socket->GetErrorNumber(PChannel::LastReadError);
+    if (ok) {
+      batch->m_count = socket->GetLastReadCount();
+      batch->m_index = 0;
+      ReadFromBatch(*batch, param);
+      return;
+    }
+  }
+  else {
+    ok = socket->ReadFrom(param.m_buffer, param.m_length, param.m_addr, param.m_port);
+    param.m_lastCount = socket->GetLastReadCount();
+    param.m_errorCode = socket->GetErrorCode(PChannel::LastReadError);
+    param.m_errorNumber = socket->GetErrorNumber(PChannel::LastReadError);
+    if (ok)
+      return;
+  }
 
   switch (param.m_errorCode) {
     case PChannel::Unavailable :
@@ -633,6 +667,33 @@ void PMonitoredSockets::ReadFromSocketList(PSocket::SelectList & readers,
 }
 
 
+bool PMonitoredSockets::ReadFromBatch(ReadBatch & batch, BundleParams & param)
+{
+  // Assume is already locked
+
+  if (batch.m_index >= batch.m_count)
+    return false;
+
+  const PIPDatagramSocket::Datagram & datagram = batch.m_datagrams[batch.m_index++];
+  param.m_addr = datagram.m_ipAndPort.GetAddress();
+  param.m_port = datagram.m_ipAndPort.GetPort();
+
+  if (datagram.m_truncated || datagram.m_length > param.m_length) {
+    PTRACE(2, "Queued UDP packet too large for buffer of " << param.m_length << " bytes.");
+    param.m_lastCount = 0;
+    param.m_errorCode = PChannel::BufferTooSmall;
+    param.m_errorNumber = EMSGSIZE;
+    return true;
+  }
+
+  memcpy(param.m_buffer, datagram.m_data, datagram.m_length);
+  param.m_lastCount = datagram.m_length;
+  param.m_errorCode = PChannel::NoError;
+  param.m_errorNumber = 0;
+  return true;
+}
+
+
 void PMonitoredSockets::SocketInfo::Read(PMonitoredSockets & bundle, BundleParams & param)
 {
   // Assume is already locked
@@ -655,8 +716,7 @@ void PMonitoredSockets::SocketInfo::Read(PMonitoredSockets & bundle, BundleParam
     }
     sockets += bundle.m_interfaceAddedSignal;
 
-    PUDPSocket * socket;
-    bundle.ReadFromSocketList(sockets, socket, param);
+    bundle.ReadFromSocketList(sockets, *this, param);
   } while (param.m_errorCode == PChannel::NoError && param.m_lastCount == 0);
 
   inUse = false;
@@ -829,6 +889,9 @@ PMonitoredSocketBundle::PMonitoredSocketBundle(const PString & fixedInterface,
   , m_onInterfaceChange(PCREATE_InterfaceNotifier(OnInterfaceChange))
   , m_fixedInterface(fixedInterface)
   , m_ipVersion(ipVersion)
+  , m_socketGeneration(0)
+  , m_readingAll(false)
+  , m_readingInterface(0)
 {
   PInterfaceMonitor::GetInstance().AddNotifier(m_onInterfaceChange);
 
@@ -891,6 +954,7 @@ PBoolean PMonitoredSocketBundle::Close()
   while (!m_socketInfoMap.empty())
     CloseSocket(m_socketInfoMap.begin());
   m_interfaceAddedSignal.Close(); // Fail safe break out of Select()
+  m_readReactor.Interrupt();
 
   UnlockReadWrite();
 
@@ -939,6 +1003,9 @@ void PMonitoredSocketBundle::OpenSocket(const PString & iface)
     return;
   }
 
+  // Do not orphan an existing socket, and its reactor registration
+  CloseSocket(m_socketInfoMap.find(iface));
+
   SocketInfo info;
   if (CreateSocket(info, binding)) {
     if (m_localPort == 0) {
@@ -946,7 +1013,10 @@ void PMonitoredSocketBundle::OpenSocket(const PString & iface)
       info.socket->PUDPSocket::InternalGetLocalAddress(addrAndPort);
       m_localPort = addrAndPort.GetPort();
     }
-    m_socketInfoMap[iface] = info;
+    SocketInfoMap_T::iterator iter = m_socketInfoMap.insert(SocketInfoMap_T::value_type(iface, info)).first;
+    m_socketLookup[info.socket] = iter;
+    m_readReactor.Add(*info.socket, PSocketReactor::Notifier());
+    ++m_socketGeneration;
   }
 }
 
@@ -958,8 +1028,15 @@ void PMonitoredSocketBundle::CloseSocket(SocketInfoMap_T::iterator iterSocket)
   if (iterSocket == m_socketInfoMap.end())
     return;
 
+  PUDPSocket * socket = iterSocket->second.socket;
+  if (socket != NULL) {
+    m_socketLookup.erase(socket);
+    m_readReactor.Remove(*socket);
+  }
+
   DestroySocket(iterSocket->second);
   m_socketInfoMap.erase(iterSocket);
+  ++m_socketGeneration;
 }
 
 
@@ -996,40 +1073,36 @@ void PMonitoredSocketBundle::ReadFromBundle(BundleParams & param)
     return;
   }
 
+  if (m_readingAll || (param.m_iface.IsEmpty() && m_readingInterface > 0)) {
+    PTRACE(2, "Cannot read from multiple threads.");
+    UnlockReadWrite();
+    param.m_errorCode = PChannel::DeviceInUse;
+    return;
+  }
+
   if (param.m_iface.IsEmpty()) {
+    // If interface is empty, then grab the next datagram on any of the interfaces
+    m_readingAll = true;
+
+    PUDPSocket * socket;
     do {
-      // If interface is empty, then grab the next datagram on any of the interfaces
-      PSocket::SelectList readers;
-
-      for (SocketInfoMap_T::iterator iter = m_socketInfoMap.begin(); iter != m_socketInfoMap.end(); ++iter) {
-        if (iter->second.inUse) {
-          PTRACE(2, "Cannot read from multiple threads.");
-          UnlockReadWrite();
-          param.m_errorCode = PChannel::DeviceInUse;
-          return;
-        }
-        if (iter->second.socket->IsOpen()) {
-          readers += *iter->second.socket;
-          iter->second.inUse = true;
-        }
-      }
-      readers += m_interfaceAddedSignal;
+      ReadFromReactor(socket, param);
+    } while (param.m_errorCode == PChannel::NoError && param.m_lastCount == 0);
 
-      PUDPSocket * socket;
-      ReadFromSocketList(readers, socket, param);
+    SocketLookup_T::iterator iter = m_socketLookup.find(socket);
+    if (iter != m_socketLookup.end())
+      param.m_iface = iter->second->first;
 
-      for (SocketInfoMap_T::iterator iter = m_socketInfoMap.begin(); iter != m_socketInfoMap.end(); ++iter) {
-        if (iter->second.socket == socket)
-          param.m_iface = iter->first;
-        iter->second.inUse = false;
-      }
-    } while (param.m_errorCode == PChannel::NoError && param.m_lastCount == 0);
+    m_readingAll = false;
   }
   else {
     // if interface is not empty, use that specific interface
     SocketInfoMap_T::iterator iter = m_socketInfoMap.find(param.m_iface);
-    if (iter != m_socketInfoMap.end())
+    if (iter != m_socketInfoMap.end()) {
+      ++m_readingInterface;
       iter->second.Read(*this, param);
+      --m_readingInterface;
+    }
     else
       param.m_errorCode = PChannel::NotFound;
   }
@@ -1038,6 +1111,73 @@ void PMonitoredSocketBundle::ReadFromBundle(BundleParams & param)
 }
 
 
+void PMonitoredSocketBundle::ReadFromReactor(PUDPSocket * & socket, BundleParams & param)
+{
+  // Assume is already locked
+
+  socket = NULL;
+  param.m_lastCount = 0;
+
+  // Datagrams queued by an earlier read, of any interface, come first
+  for (SocketInfoMap_T::iterator iter = m_socketInfoMap.begin(); iter != m_socketInfoMap.end(); ++iter) {
+    if (ReadFromBatch(iter->second.readBatch, param)) {
+      socket = iter->second.socket;
+      return;
+    }
+  }
+
+  unsigned generation = m_socketGeneration;
+  UnlockReadWrite();
+
+  /* Wait on the persistent set, until a registered socket is readable. The
+     set may report nothing early, e.g. a socket removed during the wait, so
+     keep going until the full timeout has elapsed. */
+  PSocket::SelectList readers;
+  PSimpleTimer timer(param.m_timeout);
+  do {
+    PTimeInterval timeout = param.m_timeout == PMaxTimeInterval ? PMaxTimeInterval : timer.GetRemaining();
+    param.m_errorCode = m_readReactor.Select(readers, timeout);
+  } while (param.m_errorCode == PChannel::NoError && readers.IsEmpty() && timer.IsRunning());
+
+  if (!LockReadWrite() || !m_opened) {
+    param.m_errorCode = PChannel::NotOpen;  // Closed, break out
+    return;
+  }
+
+  switch (param.m_errorCode) {
+    case PChannel::NoError :
+      break;
+
+    case PChannel::Interrupted :
+      if (!m_interfaceAddedSignal.IsOpen())
+        m_interfaceAddedSignal.Listen(); // Reset as also used to break SocketInfo::Read()
+      PTRACE(4, "Interfaces changed");
+      return;
+
+    default :
+      return;
+  }
+
+  if (readers.IsEmpty()) {
+    param.m_errorCode = PChannel::Timeout;
+    return;
+  }
+
+  /* Sockets may have been closed by an interface change while we were
+     unlocked, and a new one may even be at the same address as the one
+     that was ready, so any change at all means the result is stale. */
+  if (generation != m_socketGeneration) {
+    PTRACE(4, "Interfaces changed during read");
+    param.m_errorCode = PChannel::Interrupted;
+    return;
+  }
+
+  socket = (PUDPSocket *)&readers.front();
+  SocketLookup_T::iterator iter = m_socketLookup.find(socket);
+  ReadFromSocket(socket, iter != m_socketLookup.end() ? &iter->second->second.readBatch : NULL, param);
+}
+
+
 void PMonitoredSocketBundle::OnInterfaceChange(PInterfaceMonitor &, PInterfaceMonitor::InterfaceChange entry)
 {
   if (!m_opened || !LockReadWrite())
@@ -1047,10 +1187,12 @@ void PMonitoredSocketBundle::OnInterfaceChange(PInterfaceMonitor &, PInterfaceMo
     OpenSocket(MakeInterfaceDescription(entry));
     PTRACE(3, "UDP socket bundle has added interface " << entry);
     m_interfaceAddedSignal.Close();
+    m_readReactor.Interrupt();
   }
   else {
     CloseSocket(m_socketInfoMap.find(MakeInterfaceDescription(entry)));
     PTRACE(3, "UDP socket bundle has removed interface " << entry);
+    m_readReactor.Interrupt();
   }
 
   UnlockReadWrite();
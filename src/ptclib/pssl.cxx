@@ -1867,6 +1867,8 @@ PSSLContext::PSSLContext(const void * sessionId, PINDEX idSize)
 
 void PSSLContext::Construct(const void * sessionId, PINDEX idSize)
 {
+  m_clientSessionCacheSize = 128;
+
   // create the new SSL context
 #if OPENSSL_VERSION_NUMBER > 0x0090819fL
   const
@@ -1931,6 +1933,10 @@ void PSSLContext::Construct(const void * sessionId, PINDEX idSize)
     SSL_CTX_sess_set_cache_size(m_context, 128);
   }
 
+  // Client sessions are kept by us, keyed by server, see NewSessionCallback()
+  SSL_CTX_set_session_cache_mode(m_context, SSL_SESS_CACHE_BOTH);
+  SSL_CTX_sess_set_new_cb(m_context, NewSessionCallback);
+
   SSL_CTX_set_info_callback(m_context, InfoCallback);
   SetVerifyMode(VerifyNone);
 
@@ -1955,11 +1961,116 @@ void PSSLContext::Construct(const void * sessionId, PINDEX idSize)
 PSSLContext::~PSSLContext()
 {
   PTRACE(4, "Destroyed context: method=" << m_method << " ctx=" << m_context);
+  ClearClientSessionCache();
   if (m_context != NULL)
     SSL_CTX_free(m_context);
 }
 
 
+void PSSLContext::SetClientSessionCacheSize(PINDEX size)
+{
+  PWaitAndSignal lock(m_clientSessionMutex);
+
+  m_clientSessionCacheSize = size;
+  while (m_clientSessions.size() > (size_t)size) {
+    SSL_SESSION_free(m_clientSessions.begin()->second);
+    m_clientSessions.erase(m_clientSessions.begin());
+  }
+}
+
+
+void PSSLContext::ClearClientSessionCache()
+{
+  PWaitAndSignal lock(m_clientSessionMutex);
+
+  for (ClientSessionMap::iterator it = m_clientSessions.begin(); it != m_clientSessions.end(); ++it)
+    SSL_SESSION_free(it->second);
+  m_clientSessions.clear();
+}
+
+
+bool PSSLContext::SetClientSession(SSL * ssl, const PString & key)
+{
+  if (key.IsEmpty())
+    return false;
+
+  PWaitAndSignal lock(m_clientSessionMutex);
+
+  ClientSessionMap::iterator it = m_clientSessions.find(key);
+  if (it == m_clientSessions.end())
+    return false;
+
+  // No point offering a session the server has forgotten
+  if (SSL_SESSION_get_time(it->second) + SSL_SESSION_get_timeout(it->second) < time(NULL)) {
+    PTRACE(4, "Client session for " << key << " expired");
+    SSL_SESSION_free(it->second);
+    m_clientSessions.erase(it);
+    return false;
+  }
+
+  // SSL_set_session() takes its own reference to the session
+  return SSL_set_session(ssl, it->second) == 1;
+}
+
+
+void PSSLContext::OnClientSessionResult(SSL * ssl, const PString & key, bool connected)
+{
+  if (connected && SSL_session_reused(ssl)) {
+    ++m_clientSessionHits;
+    PTRACE(4, "Resumed client session for " << key);
+    return;
+  }
+
+  ++m_clientSessionMisses;
+
+  // Do not offer a session again if the handshake using it failed
+  if (!connected && !key.IsEmpty()) {
+    PWaitAndSignal lock(m_clientSessionMutex);
+    ClientSessionMap::iterator it = m_clientSessions.find(key);
+    if (it != m_clientSessions.end()) {
+      SSL_SESSION_free(it->second);
+      m_clientSessions.erase(it);
+    }
+  }
+}
+
+
+int PSSLContext::NewSessionCallback(SSL * ssl, SSL_SESSION * session)
+{
+  PSSLChannel * channel = reinterpret_cast<PSSLChannel *>(SSL_get_app_data(ssl));
+  if (channel == NULL || channel->GetSessionKey().IsEmpty())
+    return 0; // Server side, or nowhere to keep it, let OpenSSL deal with it
+
+  PSSLContext & context = *channel->GetContext();
+  const PString & key = channel->GetSessionKey();
+  PWaitAndSignal lock(context.m_clientSessionMutex);
+
+  if (context.m_clientSessionCacheSize == 0)
+    return 0;
+
+  ClientSessionMap::iterator it = context.m_clientSessions.find(key);
+  if (it != context.m_clientSessions.end())
+    SSL_SESSION_free(it->second);
+  else {
+    if (context.m_clientSessions.size() >= (size_t)context.m_clientSessionCacheSize) {
+      // Full, discard the oldest session
+      ClientSessionMap::iterator oldest = context.m_clientSessions.begin();
+      for (it = oldest; it != context.m_clientSessions.end(); ++it) {
+        if (SSL_SESSION_get_time(it->second) < SSL_SESSION_get_time(oldest->second))
+          oldest = it;
+      }
+      SSL_SESSION_free(oldest->second);
+      context.m_clientSessions.erase(oldest);
+    }
+    it = context.m_clientSessions.insert(ClientSessionMap::value_type(key, NULL)).first;
+  }
+
+  it->second = session;
+  PTRACE(4, &context, "Saved client session for " << key);
+  return 1; // We keep the reference to the session
+}
+
+
 bool PSSLContext::SetVerifyLocations(const PFilePath & caFile, const PDirectory & caDir)
 {
   if (PAssertNULL(m_context) == NULL)
@@ -2306,6 +2417,12 @@ PBoolean PSSLChannel::Read(void * buf, PINDEX len)
 }
 
 
+bool PSSLChannel::HasBufferedData() const
+{
+  return (m_ssl != NULL && SSL_pending(m_ssl) > 0) || PIndirectChannel::HasBufferedData();
+}
+
+
 int PSSLChannel::BioRead(bio_st * bio, char * buf, int len)
 {
   return bio != NULL && bio->ptr != NULL ? reinterpret_cast<PSSLChannel *>(bio->ptr)->BioRead(buf, len) : -1;
@@ -2450,6 +2567,7 @@ PBoolean PSSLChannel::Accept(PChannel * channel, PBoolean autoDelete)
 
 bool PSSLChannel::InternalAccept()
 {
+  PPROFILE_HISTOGRAM("SSL accept handshake");
   return PAssertNULL(m_ssl) != NULL && ConvertOSError(SSL_accept(m_ssl));
 }
 
@@ -2474,7 +2592,20 @@ PBoolean PSSLChannel::Connect(PChannel * channel, PBoolean autoDelete)
 
 bool PSSLChannel::InternalConnect()
 {
-  return PAssertNULL(m_ssl) != NULL && ConvertOSError(SSL_connect(m_ssl));
+  PPROFILE_HISTOGRAM("SSL connect handshake");
+  if (PAssertNULL(m_ssl) == NULL)
+    return false;
+
+  m_context->SetClientSession(m_ssl, m_sessionKey);
+  bool connected = ConvertOSError(SSL_connect(m_ssl));
+  m_context->OnClientSessionResult(m_ssl, m_sessionKey, connected);
+  return connected;
+}
+
+
+bool PSSLChannel::IsSessionReused() const
+{
+  return m_ssl != NULL && SSL_session_reused(m_ssl);
 }
 
 
@@ -2646,7 +2777,11 @@ bool PSSLChannelDTLS::ExecuteHandshake()
   SSL_set_read_ahead(m_ssl, 1);
   SSL_CTX_set_read_ahead(*m_context, 1);
 
-  int errorCode = SSL_do_handshake(m_ssl);
+  int errorCode;
+  {
+    PPROFILE_HISTOGRAM("DTLS handshake");
+    errorCode = SSL_do_handshake(m_ssl);
+  }
   if (errorCode == 1) {
     PTRACE(3, "DTLS handshake successful.");
     return true;
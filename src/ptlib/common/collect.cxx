@@ -34,11 +34,8 @@
 #include <ptlib.h>
 
 
-PDEFINE_POOL_ALLOCATOR(PListElement)
 PDEFINE_POOL_ALLOCATOR(PListInfo)
-PDEFINE_POOL_ALLOCATOR(PSortedListElement)
 PDEFINE_POOL_ALLOCATOR(PSortedListInfo)
-PDEFINE_POOL_ALLOCATOR(PHashTableElement)
 
 
 #define new PNEW
@@ -46,6 +43,18 @@ PDEFINE_POOL_ALLOCATOR(PHashTableElement)
 #define __CLASS__ GetClass()
 
 
+#if P_HAS_MOVE_SEMANTICS
+/* The contents given to moved from collections, shared by all of them and
+   never deleted. Their reference is constant, so MakeWritable() copies them
+   before anything is changed. */
+template <class T> static T * NewEmptyContents()
+{
+  PMEMORY_IGNORE_ALLOCATIONS_FOR_SCOPE;
+  return new T;
+}
+#endif
+
+
 ///////////////////////////////////////////////////////////////////////////////
 
 void PCollection::PrintOn(ostream &strm) const
@@ -82,6 +91,15 @@ void PArrayObjects::CopyContents(const PArrayObjects & array)
 }
 
 
+#if P_HAS_MOVE_SEMANTICS
+void PArrayObjects::ResetContents()
+{
+  static PBaseArray<PObject *> * const EmptyArray = NewEmptyContents< PBaseArray<PObject *> >();
+  theArray = EmptyArray;
+}
+#endif
+
+
 void PArrayObjects::DestroyContents()
 {
   if (reference->deleteObjects && theArray != NULL) {
@@ -136,6 +154,9 @@ PINDEX PArrayObjects::GetSize() const
 
 PBoolean PArrayObjects::SetSize(PINDEX newSize)
 {
+  if (newSize != GetSize())
+    MakeWritable();
+
   PINDEX sz = theArray->GetSize();
   if (reference->deleteObjects && sz > 0) {
     for (PINDEX i = sz; i > newSize; i--) {
@@ -176,12 +197,13 @@ PBoolean PArrayObjects::Remove(const PObject * obj)
 
 PObject * PArrayObjects::GetAt(PINDEX index) const
 {
-  return (*theArray)[index];
+  return index < theArray->GetSize() ? theArray->GetAt(index) : NULL;
 }
 
 
 PBoolean PArrayObjects::SetAt(PINDEX index, PObject * obj)
 {
+  MakeWritable();
   if (!theArray->SetMinSize(index+1))
     return false;
   PObject * oldObj = theArray->GetAt(index);
@@ -196,6 +218,7 @@ PBoolean PArrayObjects::SetAt(PINDEX index, PObject * obj)
 
 PINDEX PArrayObjects::InsertAt(PINDEX index, PObject * obj)
 {
+  MakeWritable();
   PINDEX i = GetSize();
   SetSize(i+1);
   for (; i > index; i--)
@@ -207,6 +230,7 @@ PINDEX PArrayObjects::InsertAt(PINDEX index, PObject * obj)
 
 PObject * PArrayObjects::RemoveAt(PINDEX index)
 {
+  MakeWritable();
   PObject * obj = (*theArray)[index];
 
   PINDEX size = GetSize()-1;
@@ -249,6 +273,12 @@ PINDEX PArrayObjects::GetValuesIndex(const PObject & obj) const
 
 ///////////////////////////////////////////////////////////////////////////////
 
+#if PTRACING
+static const PINDEX ListSlowLookupDistance = 100; // Elements walked for an ordinal lookup to be slow
+static const unsigned ListSlowLookupReport = 1000; // Slow lookups before trace log warning
+#endif
+
+
 void PAbstractList::DestroyContents()
 {
   RemoveAll();
@@ -260,7 +290,18 @@ void PAbstractList::DestroyContents()
 void PAbstractList::CopyContents(const PAbstractList & list)
 {
   info = list.info;
+  m_lastElement = NULL;
+}
+
+
+#if P_HAS_MOVE_SEMANTICS
+void PAbstractList::ResetContents()
+{
+  static PListInfo * const EmptyInfo = NewEmptyContents<PListInfo>();
+  info = EmptyInfo;
+  m_lastElement = NULL;
 }
+#endif
 
 
 void PAbstractList::CloneContents(const PAbstractList * list)
@@ -269,9 +310,10 @@ void PAbstractList::CloneContents(const PAbstractList * list)
 
   info = new PListInfo;
   PAssert(info != NULL, POutOfMemory);
+  m_lastElement = NULL;
 
   while (element != NULL) {
-    Element * newElement = new Element(element->data->Clone());
+    Element * newElement = info->NewElement(element->data->Clone());
 
     if (info->head == NULL)
       info->head = info->tail = newElement;
@@ -318,7 +360,8 @@ PINDEX PAbstractList::Append(PObject * obj)
   if (PAssertNULL(obj) == NULL)
     return P_MAX_INDEX;
 
-  Element * element = new Element(obj);
+  MakeWritable();
+  Element * element = info->NewElement(obj);
   if (info->tail != NULL)
     info->tail->next = element;
   element->prev = info->tail;
@@ -336,7 +379,8 @@ void PAbstractList::Prepend(PObject * obj)
   if (PAssertNULL(obj) == NULL)
     return;
 
-  Element * element = new Element(obj);
+  MakeWritable();
+  Element * element = info->NewElement(obj);
   if (info->head != NULL)
     info->head->prev = element;
   element->prev = NULL;
@@ -344,6 +388,7 @@ void PAbstractList::Prepend(PObject * obj)
   if (info->tail == NULL)
     info->tail = element;
   info->head = element;
+  ++info->m_changes;
   ++reference->size;
 }
 
@@ -368,7 +413,7 @@ PINDEX PAbstractList::InsertAt(PINDEX index, PObject * obj)
   if (!PAssert(element != NULL, PInvalidArrayIndex))
     return P_MAX_INDEX;
 
-  Element * newElement = new Element(obj);
+  Element * newElement = info->NewElement(obj);
   if (element->prev != NULL)
     element->prev->next = newElement;
   else
@@ -376,6 +421,8 @@ PINDEX PAbstractList::InsertAt(PINDEX index, PObject * obj)
   newElement->prev = element->prev;
   newElement->next = element;
   element->prev = newElement;
+  ++info->m_changes;
+  SetLastElement(newElement, index);
 
   reference->size++;
   return index;
@@ -417,7 +464,7 @@ void PAbstractList::InsertElement(PListElement * element, PObject * obj)
     return;
   }
 
-  Element * newElement = new Element(obj);
+  Element * newElement = info->NewElement(obj);
   if (element->prev != NULL)
     element->prev->next = newElement;
   else
@@ -425,6 +472,7 @@ void PAbstractList::InsertElement(PListElement * element, PObject * obj)
   newElement->prev = element->prev;
   newElement->next = element;
   element->prev = newElement;
+  ++info->m_changes;
   ++reference->size;
 }
 
@@ -437,6 +485,9 @@ PObject * PAbstractList::RemoveElement(PListElement * elmt)
   if (elmt == NULL)
     return NULL;
 
+  // Removing the remembered element, as in RemoveAt(), moves it to the next
+  bool wasLast = elmt == m_lastElement && m_lastChange == info->m_changes;
+
   if (elmt->prev != NULL)
     elmt->prev->next = elmt->next;
   else {
@@ -453,6 +504,10 @@ PObject * PAbstractList::RemoveElement(PListElement * elmt)
       info->tail->next = NULL;
   }
 
+  ++info->m_changes;
+  if (wasLast && elmt->next != NULL)
+    SetLastElement(elmt->next, m_lastIndex);
+
   if((reference == NULL) || (reference->size == 0)){
     PAssertAlways("reference is null or reference->size == 0");
     return NULL;
@@ -464,7 +519,7 @@ PObject * PAbstractList::RemoveElement(PListElement * elmt)
     delete obj;
     obj = NULL;
   }
-  delete elmt;
+  info->DeleteElement(elmt);
   return obj;
 }
 
@@ -514,8 +569,10 @@ PINDEX PAbstractList::GetObjectsIndex(const PObject * obj) const
   Element * element = info->head;
 
   while (element != NULL) {
-    if (element->data == obj) 
+    if (element->data == obj) {
+      SetLastElement(element, index);
       return index;
+    }
     element = element->next;
     index++;
   }
@@ -531,22 +588,44 @@ PINDEX PAbstractList::GetValuesIndex(const PObject & obj) const
 }
 
 
+static PINDEX IndexDistance(PINDEX a, PINDEX b)
+{
+  return a > b ? a - b : b - a;
+}
+
+
 PListElement * PAbstractList::FindElement(PINDEX index) const
 {
-  if (index >= GetSize())
+  PINDEX size = GetSize();
+  if (index >= size)
     return NULL;
 
+  // Start from whichever of the head, tail or last element found is closest
   Element * lastElement;
   PINDEX lastIndex;
-  if (index < GetSize()/2) {
+  if (index < size/2) {
     lastIndex = 0;
     lastElement = info->head;
   }
   else {
-    lastIndex = GetSize()-1;
+    lastIndex = size-1;
     lastElement = info->tail;
   }
 
+  if (m_lastElement != NULL && m_lastChange == info->m_changes &&
+          IndexDistance(index, m_lastIndex) < IndexDistance(index, lastIndex)) {
+    lastIndex = m_lastIndex;
+    lastElement = m_lastElement;
+  }
+
+#if PTRACING
+  PTRACE_IF(2, IndexDistance(index, lastIndex) > ListSlowLookupDistance &&
+               ++info->m_slowLookups == ListSlowLookupReport, this, "PTLib",
+            "Slow access by ordinal index, " << ListSlowLookupReport << " lookups walked more than "
+            << ListSlowLookupDistance << " elements of " << size << " in list class " << GetClass()
+            << ", use an iterator");
+#endif
+
   while (lastIndex < index) {
     lastElement = lastElement->next;
     ++lastIndex;
@@ -557,6 +636,7 @@ PListElement * PAbstractList::FindElement(PINDEX index) const
     --lastIndex;
   }
 
+  SetLastElement(lastElement, index);
   return lastElement;
 }
 
@@ -575,12 +655,23 @@ PListElement * PAbstractList::FindElement(const PObject & obj, PINDEX * indexPtr
     index++;
   }
 
+  if (element != NULL)
+    SetLastElement(element, index);
+
   if (indexPtr != NULL)
     *indexPtr = index;
   return element;
 }
 
 
+void PAbstractList::SetLastElement(PListElement * element, PINDEX index) const
+{
+  m_lastElement = element;
+  m_lastIndex = index;
+  m_lastChange = info->m_changes;
+}
+
+
 PListElement::PListElement(PObject * theData)
 {
   next = prev = NULL;
@@ -619,6 +710,15 @@ void PAbstractSortedList::CopyContents(const PAbstractSortedList & list)
 }
 
 
+#if P_HAS_MOVE_SEMANTICS
+void PAbstractSortedList::ResetContents()
+{
+  static PSortedListInfo * const EmptyInfo = NewEmptyContents<PSortedListInfo>();
+  m_info = EmptyInfo;
+}
+#endif
+
+
 void PAbstractSortedList::CloneContents(const PAbstractSortedList * list)
 {
   // Remember info for when list == this
@@ -678,7 +778,8 @@ PINDEX PAbstractSortedList::Append(PObject * obj)
   if (PAssertNULL(obj) == NULL)
     return P_MAX_INDEX;
 
-  PSortedListElement * z = new PSortedListElement(&m_info->nil, obj);
+  MakeWritable();
+  PSortedListElement * z = m_info->NewElement(obj);
   PSortedListElement * x = m_info->m_root;
   PSortedListElement * y = &m_info->nil;
   while (x != &m_info->nil) {
@@ -779,7 +880,7 @@ void PAbstractSortedList::RemoveAll()
 {
   if (m_info->m_root != &m_info->nil) {
     DeleteSubTrees(m_info->m_root, reference->deleteObjects);
-    delete m_info->m_root;
+    m_info->DeleteElement(m_info->m_root);
     m_info->m_root = &m_info->nil;
     reference->size = 0;
   }
@@ -964,7 +1065,7 @@ void PAbstractSortedList::RemoveElement(PSortedListElement * node)
     x->m_colour = PSortedListElement::Black;
   }
 
-  delete y;
+  m_info->DeleteElement(y);
 
   reference->size--;
 }
@@ -1097,12 +1198,12 @@ void PAbstractSortedList::DeleteSubTrees(PSortedListElement * node, PBoolean del
 {
   if (node->m_left != &m_info->nil) {
     DeleteSubTrees(node->m_left, deleteObject);
-    delete node->m_left;
+    m_info->DeleteElement(node->m_left);
     node->m_left = &m_info->nil;
   }
   if (node->m_right != &m_info->nil) {
     DeleteSubTrees(node->m_right, deleteObject);
-    delete node->m_right;
+    m_info->DeleteElement(node->m_right);
     node->m_right = &m_info->nil;
   }
   if (deleteObject) {
@@ -1112,40 +1213,369 @@ void PAbstractSortedList::DeleteSubTrees(PSortedListElement * node, PBoolean del
 }
 
 
+
 ///////////////////////////////////////////////////////////////////////////////
 
+struct PSortedArrayLess
+{
+  bool operator()(const PObject * a, const PObject * b) const { return a->Compare(*b) == PObject::LessThan; }
+};
+
+
+PAbstractSortedArray::PAbstractSortedArray()
+  : m_info(new PSortedArrayInfo)
+{
+  PAssert(m_info != NULL, POutOfMemory);
+}
+
+
+void PAbstractSortedArray::DestroyContents()
+{
+  RemoveAll();
+  delete m_info;
+}
+
+
+void PAbstractSortedArray::CopyContents(const PAbstractSortedArray & array)
+{
+  m_info = array.m_info;
+}
+
+
+#if P_HAS_MOVE_SEMANTICS
+void PAbstractSortedArray::ResetContents()
+{
+  static PSortedArrayInfo * const EmptyInfo = NewEmptyContents<PSortedArrayInfo>();
+  m_info = EmptyInfo;
+}
+#endif
+
+
+void PAbstractSortedArray::CloneContents(const PAbstractSortedArray * array)
+{
+  // Remember info for when array == this
+  PSortedArrayInfo * otherInfo = array->m_info;
+
+  m_info = new PSortedArrayInfo;
+  PAssert(m_info != NULL, POutOfMemory);
+
+  m_info->m_objects.reserve(otherInfo->m_objects.size());
+  for (std::vector<PObject *>::const_iterator it = otherInfo->m_objects.begin(); it != otherInfo->m_objects.end(); ++it)
+    m_info->m_objects.push_back((*it)->Clone());
+  m_info->m_sortedSize = otherInfo->m_sortedSize;
+  reference->size = m_info->m_objects.size();
+}
+
+
+PBoolean PAbstractSortedArray::SetSize(PINDEX)
+{
+  return true;
+}
+
+
+PObject::Comparison PAbstractSortedArray::Compare(const PObject & obj) const
+{
+  PAssert(PIsDescendant(&obj, PAbstractSortedArray), PInvalidCast);
+  const PAbstractSortedArray & other = dynamic_cast<const PAbstractSortedArray &>(obj);
+
+  CheckSorted();
+  other.CheckSorted();
+
+  const std::vector<PObject *> & objects1 = m_info->m_objects;
+  const std::vector<PObject *> & objects2 = other.m_info->m_objects;
+  for (size_t i = 0; i < objects1.size() && i < objects2.size(); ++i) {
+    if (*objects1[i] < *objects2[i])
+      return LessThan;
+    if (*objects1[i] > *objects2[i])
+      return GreaterThan;
+  }
+
+  if (objects1.size() < objects2.size())
+    return LessThan;
+  if (objects1.size() > objects2.size())
+    return GreaterThan;
+  return EqualTo;
+}
+
+
+PINDEX PAbstractSortedArray::Append(PObject * obj)
+{
+  if (PAssertNULL(obj) == NULL)
+    return P_MAX_INDEX;
+
+  MakeWritable();
+  Sort();
+
+  // After any equal objects, same as PAbstractSortedList
+  std::vector<PObject *> & objects = m_info->m_objects;
+  std::vector<PObject *>::iterator pos = std::upper_bound(objects.begin(), objects.end(), obj, PSortedArrayLess());
+  PINDEX index = pos - objects.begin();
+  objects.insert(pos, obj);
+
+  ++m_info->m_sortedSize;
+  reference->size++;
+  return index;
+}
+
+
+void PAbstractSortedArray::AppendUnsorted(PObject * obj)
+{
+  if (PAssertNULL(obj) == NULL)
+    return;
+
+  MakeWritable();
+  m_info->m_objects.push_back(obj);
+  reference->size++;
+}
+
+
+void PAbstractSortedArray::Sort()
+{
+  if (IsSorted())
+    return;
+
+  // Stable so equal objects stay in the order they were appended
+  std::vector<PObject *> & objects = m_info->m_objects;
+  std::vector<PObject *>::iterator middle = objects.begin() + m_info->m_sortedSize;
+  std::stable_sort(middle, objects.end(), PSortedArrayLess());
+  std::inplace_merge(objects.begin(), middle, objects.end(), PSortedArrayLess());
+  m_info->m_sortedSize = objects.size();
+}
+
+
+PBoolean PAbstractSortedArray::Remove(const PObject * obj)
+{
+  Sort();
+
+  PINDEX index = GetObjectsIndex(obj);
+  if (index == P_MAX_INDEX)
+    return false;
+
+  RemoveAt(index);
+  return true;
+}
+
+
+PObject * PAbstractSortedArray::RemoveAt(PINDEX index)
+{
+  Sort();
+
+  std::vector<PObject *> & objects = m_info->m_objects;
+  if (index >= (PINDEX)objects.size())
+    return NULL;
+
+  PObject * obj = objects[index];
+  objects.erase(objects.begin() + index);
+  --m_info->m_sortedSize;
+  reference->size--;
+
+  if (reference->deleteObjects) {
+    delete obj;
+    return NULL;
+  }
+
+  return obj;
+}
+
+
+void PAbstractSortedArray::RemoveAll()
+{
+  if (m_info->m_objects.empty())
+    return;
+
+  if (reference->deleteObjects) {
+    for (std::vector<PObject *>::iterator it = m_info->m_objects.begin(); it != m_info->m_objects.end(); ++it)
+      delete *it;
+  }
+
+  m_info->m_objects.clear();
+  m_info->m_sortedSize = 0;
+  reference->size = 0;
+}
+
+
+PINDEX PAbstractSortedArray::Insert(const PObject &, PObject * obj)
+{
+  return Append(obj);
+}
+
+
+PINDEX PAbstractSortedArray::InsertAt(PINDEX, PObject * obj)
+{
+  return Append(obj);
+}
+
+
+PBoolean PAbstractSortedArray::SetAt(PINDEX, PObject *)
+{
+  return false;
+}
+
+
+PObject * PAbstractSortedArray::GetAt(PINDEX index) const
+{
+  if (index >= GetSize())
+    return NULL;
+
+  CheckSorted();
+  return m_info->m_objects[index];
+}
+
+
+PINDEX PAbstractSortedArray::LowerBound(const PObject & obj) const
+{
+  CheckSorted();
+
+  const std::vector<PObject *> & objects = m_info->m_objects;
+  return std::lower_bound(objects.begin(), objects.end(), &obj, PSortedArrayLess()) - objects.begin();
+}
+
+
+PINDEX PAbstractSortedArray::GetObjectsIndex(const PObject * obj) const
+{
+  if (obj == NULL)
+    return P_MAX_INDEX;
+
+  const std::vector<PObject *> & objects = m_info->m_objects;
+  for (PINDEX index = LowerBound(*obj); index < (PINDEX)objects.size(); ++index) {
+    if (objects[index] == obj)
+      return index;
+    if (objects[index]->Compare(*obj) != EqualTo)
+      break;
+  }
+
+  return P_MAX_INDEX;
+}
+
+
+PINDEX PAbstractSortedArray::GetValuesIndex(const PObject & obj) const
+{
+  PINDEX index = LowerBound(obj);
+  if (index < (PINDEX)m_info->m_objects.size() && m_info->m_objects[index]->Compare(obj) == EqualTo)
+    return index;
+
+  return P_MAX_INDEX;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+
+static const PINDEX HashTableInitialBuckets = 16;
+static const PINDEX HashTableMigrateCount = 2; // Buckets moved per append, must be > 1
+
+static __inline unsigned MixHashValue(PINDEX value)
+{
+  /* Finaliser from MurmurHash3, spreads the bits of the objects hash value so
+     that masking off the lower bits for the bucket index works well, even
+     for simple values like sequential integers. */
+  unsigned hash = (unsigned)value;
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6b;
+  hash ^= hash >> 13;
+  hash *= 0xc2b2ae35;
+  hash ^= hash >> 16;
+  return hash;
+}
+
+
 void PHashTableInfo::DestroyContents()
 {
-  for (PINDEX i = 0; i < GetSize(); i++) {
-    PHashTableElement * elmt = GetAt(i).m_head;
-    while (elmt != NULL) {
-      PHashTableElement * nextElmt = elmt->m_next;
-      if (elmt->m_data != NULL && reference->deleteObjects)
-        delete elmt->m_data;
-      if (deleteKeys)
-        delete elmt->m_key;
-      delete elmt;
-      elmt = nextElmt;
+  for (int table = 0; table < 2; ++table) {
+    PINDEX size;
+    PHashTableList * buckets = GetBuckets(table == 0, size);
+    for (PINDEX i = 0; i < size; i++) {
+      PHashTableElement * elmt = buckets[i].m_head;
+      while (elmt != NULL) {
+        PHashTableElement * nextElmt = elmt->m_next;
+        if (elmt->m_data != NULL && reference->deleteObjects)
+          delete elmt->m_data;
+        if (deleteKeys)
+          delete elmt->m_key;
+        DeleteElement(elmt);
+        elmt = nextElmt;
+      }
     }
   }
+  m_oldBuckets.SetSize(0);
+  m_migrateIndex = 0;
+  m_elementCount = 0;
   PAbstractArray::DestroyContents();
 }
 
 
-void PHashTableInfo::AppendElement(PObject * key, PObject * data PTRACE_PARAM(, PHashTable * owner))
+PHashTableList * PHashTableInfo::GetBuckets(bool oldBuckets, PINDEX & size) const
 {
-  PINDEX bucket = PAssertNULL(key)->HashFunction();
-  if (bucket >= GetSize())
-    SetSize(bucket+1);
+  const PBaseArray<PHashTableList> & array = oldBuckets ? m_oldBuckets : *this;
+  size = array.GetSize();
+  return const_cast<PHashTableList *>((const PHashTableList *)array);
+}
 
-  PHashTableList & list = operator[](bucket);
-  PHashTableElement * element = new PHashTableElement;
-  PAssert(element != NULL, POutOfMemory);
-  element->m_key = key;
-  element->m_data = data;
-  element->m_bucket = bucket;
-  element->m_next = NULL;
 
+PHashTableList * PHashTableInfo::GetList(unsigned hash) const
+{
+  PINDEX size;
+  PHashTableList * buckets = GetBuckets(true, size);
+  if (size > 0) {
+    PINDEX bucket = hash & (size-1);
+    if (bucket >= m_migrateIndex)
+      return &buckets[bucket];
+  }
+
+  buckets = GetBuckets(false, size);
+  return size > 0 ? &buckets[hash & (size-1)] : NULL;
+}
+
+
+PHashTableElement * PHashTableInfo::FirstElement(bool inOldBuckets, PINDEX bucket) const
+{
+  // Iteration order is the not yet migrated old buckets, then the new buckets
+  PINDEX size;
+  PHashTableList * buckets;
+  if (inOldBuckets) {
+    buckets = GetBuckets(true, size);
+    for (; bucket < size; ++bucket) {
+      if (buckets[bucket].m_head != NULL)
+        return buckets[bucket].m_head;
+    }
+    bucket = 0;
+  }
+
+  buckets = GetBuckets(false, size);
+  for (; bucket < size; ++bucket) {
+    if (buckets[bucket].m_head != NULL)
+      return buckets[bucket].m_head;
+  }
+
+  return NULL;
+}
+
+
+PHashTableElement * PHashTableInfo::LastElement(bool inOldBuckets, PINDEX bucket) const
+{
+  PINDEX size;
+  PHashTableList * buckets;
+  if (!inOldBuckets) {
+    buckets = GetBuckets(false, size);
+    for (; bucket >= 0; --bucket) {
+      if (buckets[bucket].m_tail != NULL)
+        return buckets[bucket].m_tail;
+    }
+    bucket = m_oldBuckets.GetSize()-1;
+  }
+
+  buckets = GetBuckets(true, size);
+  for (; bucket >= m_migrateIndex; --bucket) {
+    if (buckets[bucket].m_tail != NULL)
+      return buckets[bucket].m_tail;
+  }
+
+  return NULL;
+}
+
+
+void PHashTableInfo::LinkElement(PHashTableList & list, PHashTableElement * element)
+{
+  element->m_next = NULL;
   if (list.m_head == NULL) {
     element->m_prev = NULL;
     list.m_head = list.m_tail = element;
@@ -1158,6 +1588,99 @@ void PHashTableInfo::AppendElement(PObject * key, PObject * data PTRACE_PARAM(,
 
 #if PTRACING
   ++list.m_size;
+#endif
+}
+
+
+void PHashTableInfo::UnlinkElement(PHashTableList & list, PHashTableElement * element)
+{
+  if (element == list.m_head) {
+    if (element == list.m_tail)
+      list.m_head = list.m_tail = NULL;
+    else {
+      list.m_head = list.m_head->m_next;
+      list.m_head->m_prev = NULL;
+    }
+  }
+  else {
+    if (element == list.m_tail) {
+      list.m_tail = list.m_tail->m_prev;
+      list.m_tail->m_next = NULL;
+    }
+    else {
+      element->m_prev->m_next = element->m_next;
+      element->m_next->m_prev = element->m_prev;
+    }
+  }
+
+#if PTRACING
+  --list.m_size;
+#endif
+}
+
+
+void PHashTableInfo::Grow()
+{
+  // Complete any previous resize, should not really happen
+  MigrateBuckets(P_MAX_INDEX);
+
+  PINDEX newSize = GetSize()*2;
+  if (newSize == 0)
+    newSize = HashTableInitialBuckets;
+
+  /* Move the current buckets to m_oldBuckets and replace with a new, empty,
+     array without copying anything. The elements are moved across later. */
+  m_oldBuckets = *this;
+  ParentClass::operator=(ParentClass(newSize));
+  m_migrateIndex = 0;
+}
+
+
+void PHashTableInfo::MigrateBuckets(PINDEX count)
+{
+  PINDEX oldSize;
+  PHashTableList * oldBuckets = GetBuckets(true, oldSize);
+  if (oldSize == 0)
+    return;
+
+  PINDEX newSize;
+  PHashTableList * newBuckets = GetBuckets(false, newSize);
+
+  while (count-- > 0 && m_migrateIndex < oldSize) {
+    PHashTableElement * element = oldBuckets[m_migrateIndex].m_head;
+    while (element != NULL) {
+      PHashTableElement * nextElement = element->m_next;
+      LinkElement(newBuckets[element->m_hash & (newSize-1)], element);
+      element = nextElement;
+    }
+    oldBuckets[m_migrateIndex].m_head = oldBuckets[m_migrateIndex].m_tail = NULL;
+    ++m_migrateIndex;
+  }
+
+  if (m_migrateIndex >= oldSize) {
+    m_oldBuckets.SetSize(0);
+    m_migrateIndex = 0;
+  }
+}
+
+
+void PHashTableInfo::AppendElement(PObject * key, PObject * data PTRACE_PARAM(, PHashTable * owner))
+{
+  if (m_elementCount >= GetSize())
+    Grow();
+  else
+    MigrateBuckets(HashTableMigrateCount);
+
+  PHashTableElement * element = (PHashTableElement *)m_elements.Allocate();
+  element->m_key = key;
+  element->m_data = data;
+  element->m_hash = MixHashValue(PAssertNULL(key)->HashFunction());
+
+  PHashTableList & list = *GetList(element->m_hash);
+  LinkElement(list, element);
+  ++m_elementCount;
+
+#if PTRACING
   PINDEX totalSize = owner->GetSize();
   PTRACE_IF(1, list.m_size > 20 && list.m_size > totalSize/2, owner, "PTLib",
             "Poor hash function used, more than 50% of " << totalSize <<
@@ -1171,33 +1694,13 @@ PObject * PHashTableInfo::RemoveElement(const PObject & key)
   PObject * obj = NULL;
   PHashTableElement * element = GetElementAt(key);
   if (element != NULL) {
-    PHashTableList & list = operator[](element->m_bucket);
-    if (element == list.m_head) {
-      if (element == list.m_tail)
-        list.m_head = list.m_tail = NULL;
-      else {
-        list.m_head = list.m_head->m_next;
-        list.m_head->m_prev = NULL;
-      }
-    }
-    else {
-      if (element == list.m_tail) {
-        list.m_tail = list.m_tail->m_prev;
-        list.m_tail->m_next = NULL;
-      }
-      else {
-        element->m_prev->m_next = element->m_next;
-        element->m_next->m_prev = element->m_prev;
-      }
-    }
-#if PTRACING
-    --list.m_size;
-#endif
+    UnlinkElement(*GetList(element->m_hash), element);
+    --m_elementCount;
 
     obj = element->m_data;
     if (deleteKeys)
       delete element->m_key;
-    delete element;
+    DeleteElement(element);
   }
   return obj;
 }
@@ -1205,36 +1708,23 @@ PObject * PHashTableInfo::RemoveElement(const PObject & key)
 
 PHashTableElement * PHashTableInfo::GetElementAt(PINDEX index)
 {
-  PHashTableElement * element;
-  PINDEX bucket = 0;
-  while ((element = GetAt(bucket).m_head) == NULL) {
-    if (bucket >= GetSize())
-      return NULL;
-    bucket++;
-  }
-
-  for (PINDEX i = 0; i < index; ++i) {
-    if (element->m_next != NULL)
-      element = element->m_next;
-    else {
-      do {
-        if (++bucket >= GetSize())
-          return NULL;
-      } while ((element = GetAt(bucket).m_head) == NULL);
-    }
-  }
-
+  PHashTableElement * element = FirstElement(true, m_migrateIndex);
+  while (element != NULL && index-- > 0)
+    element = NextElement(element);
   return element;
 }
 
 
 PHashTableElement * PHashTableInfo::GetElementAt(const PObject & key)
 {
-  PHashTableElement * element = GetAt(key.HashFunction()).m_head;
-  while (element != NULL) {
-    if (*element->m_key == key) 
+  unsigned hash = MixHashValue(key.HashFunction());
+  PHashTableList * list = GetList(hash);
+  if (list == NULL)
+    return NULL;
+
+  for (PHashTableElement * element = list->m_head; element != NULL; element = element->m_next) {
+    if (element->m_hash == hash && *element->m_key == key)
       return element;
-    element = element->m_next;
   }
   return NULL;
 }
@@ -1243,15 +1733,11 @@ PHashTableElement * PHashTableInfo::GetElementAt(const PObject & key)
 PINDEX PHashTableInfo::GetElementsIndex(const PObject * obj, PBoolean byValue, PBoolean keys) const
 {
   PINDEX index = 0;
-  for (PINDEX i = 0; i < GetSize(); i++) {
-    PHashTableElement * element = GetAt(i).m_head;
-    while (element != NULL) {
-      PObject * keydata = keys ? element->m_key : element->m_data;
-      if (byValue ? (*keydata == *obj) : (keydata == obj))
-        return index;
-      element = element->m_next;
-      index++;
-    }
+  for (PHashTableElement * element = FirstElement(true, m_migrateIndex); element != NULL; element = NextElement(element)) {
+    PObject * keydata = keys ? element->m_key : element->m_data;
+    if (byValue ? (*keydata == *obj) : (keydata == obj))
+      return index;
+    index++;
   }
   return P_MAX_INDEX;
 }
@@ -1262,16 +1748,17 @@ PHashTableElement * PHashTableInfo::NextElement(PHashTableElement * element) con
   if (element == NULL)
     return NULL;
 
-  PINDEX bucket = element->m_bucket;
   if (element->m_next != NULL)
-    element = element->m_next;
-  else {
-    do {
-      if (++bucket >= GetSize())
-        return NULL;
-    } while ((element = GetAt(bucket).m_head) == NULL);
+    return element->m_next;
+
+  PINDEX oldSize = m_oldBuckets.GetSize();
+  if (oldSize > 0) {
+    PINDEX bucket = element->m_hash & (oldSize-1);
+    if (bucket >= m_migrateIndex)
+      return FirstElement(true, bucket+1);
   }
-  return element;
+
+  return FirstElement(false, (element->m_hash & (GetSize()-1))+1);
 }
 
 
@@ -1280,16 +1767,17 @@ PHashTableElement * PHashTableInfo::PrevElement(PHashTableElement * element) con
   if (element == NULL)
     return NULL;
 
-  PINDEX bucket = element->m_bucket;
   if (element->m_prev != NULL)
-    element = element->m_prev;
-  else {
-    do {
-      if (bucket-- == 0)
-        return NULL;
-    } while ((element = GetAt(bucket).m_tail) == NULL);
+    return element->m_prev;
+
+  PINDEX oldSize = m_oldBuckets.GetSize();
+  if (oldSize > 0) {
+    PINDEX bucket = element->m_hash & (oldSize-1);
+    if (bucket >= m_migrateIndex)
+      return LastElement(true, bucket-1);
   }
-  return element;
+
+  return LastElement(false, (element->m_hash & (GetSize()-1))-1);
 }
 
 
@@ -1317,6 +1805,24 @@ void PHashTable::CopyContents(const PHashTable & hash)
   hashTable = hash.hashTable;
 }
 
+
+#if P_HAS_MOVE_SEMANTICS
+static PHashTableInfo * NewEmptyHashTable(PBoolean deleteKeys)
+{
+  PHashTableInfo * hashTable = NewEmptyContents<PHashTableInfo>();
+  hashTable->deleteKeys = deleteKeys;
+  return hashTable;
+}
+
+
+void PHashTable::ResetContents()
+{
+  static PHashTableInfo * const WithDeleteKeys = NewEmptyHashTable(true);
+  static PHashTableInfo * const WithoutDeleteKeys = NewEmptyHashTable(false);
+  hashTable = hashTable->deleteKeys ? WithDeleteKeys : WithoutDeleteKeys;
+}
+#endif
+
   
 void PHashTable::CloneContents(const PHashTable * hash)
 {
@@ -1380,6 +1886,13 @@ void PAbstractSet::CopyContents(const PAbstractSet & )
 {
 }
 
+
+#if P_HAS_MOVE_SEMANTICS
+void PAbstractSet::ResetContents()
+{
+}
+#endif
+
   
 void PAbstractSet::CloneContents(const PAbstractSet * )
 {
@@ -1394,6 +1907,7 @@ PINDEX PAbstractSet::Append(PObject * obj)
     return P_MAX_INDEX;
   }
 
+  MakeWritable();
   ++reference->size;
   hashTable->AppendElement(obj, NULL PTRACE_PARAM(, this));
   return reference->size;
@@ -1583,6 +2097,7 @@ PObject * PAbstractDictionary::AbstractSetAt(const PObject & key, PObject * obj)
     }
   }
   else {
+    MakeWritable();
     PHashTableElement * element = hashTable->GetElementAt(key);
     if (element == NULL) {
       ++reference->size;
@@ -57,6 +57,32 @@ extern "C" int vsprintf(char *, const char *, va_list);
 PDEFINE_POOL_ALLOCATOR(PContainerReference);
 
 
+/* A short PString has its characters in the same pooled block as its
+   reference, so needs no separate heap allocation for them. */
+struct PStringShortReference : public PContainerReference
+{
+  enum { BufferSize = 28 }; // Makes the whole block 40 bytes
+
+  PStringShortReference(PINDEX initialSize)
+    : PContainerReference(initialSize)
+  {
+    shortData = true;
+    memset(m_buffer, 0, initialSize);
+  }
+
+  char m_buffer[BufferSize];
+
+  PDECLARE_POOL_ALLOCATOR();
+};
+
+PDEFINE_POOL_ALLOCATOR(PStringShortReference);
+
+static inline char * ShortBuffer(PContainerReference * reference)
+{
+  return static_cast<PStringShortReference *>(reference)->m_buffer;
+}
+
+
 #define new PNEW
 #undef  __CLASS__
 #define __CLASS__ GetClass()
@@ -102,6 +128,81 @@ PContainer::PContainer(PContainerReference & ref)
 }
 
 
+#if P_HAS_MOVE_SEMANTICS
+static PContainerReference * NewEmptyReference(bool deleteObjects)
+{
+  PMEMORY_IGNORE_ALLOCATIONS_FOR_SCOPE;
+  PContainerReference * reference = new PContainerReference(0, true);
+  reference->deleteObjects = deleteObjects;
+  return reference;
+}
+
+
+static PContainerReference & GetEmptyReference(bool deleteObjects)
+{
+  /* Shared by all moved from containers and never deleted, the count cannot
+     get to zero. Being constant, anything modifying the container copies it,
+     one for each setting of deleteObjects so that is kept across the move. */
+  static PContainerReference * const WithDelete = NewEmptyReference(true);
+  static PContainerReference * const WithoutDelete = NewEmptyReference(false);
+  return deleteObjects ? *WithDelete : *WithoutDelete;
+}
+
+
+PContainer::PContainer(PContainer && cont) noexcept
+  : reference(cont.reference)
+{
+  PAssert2(reference != NULL, cont.GetClass(), "Move of deleted container");
+
+  if (reference->constObject || reference->shortData)
+    ++reference->count;
+  else
+    cont.ResetReference();
+}
+
+
+void PContainer::MoveContents(PContainer & cont)
+{
+  if (&cont == this)
+    return;
+
+  if (reference == cont.reference) {
+    // Already sharing, just detach the source
+    if (!reference->constObject && !reference->shortData) {
+      --reference->count;
+      cont.ResetReference();
+    }
+    return;
+  }
+
+  if (reference != NULL && --reference->count == 0) {
+    DestroyContents();
+    DestroyReference();
+  }
+
+  reference = cont.reference;
+  if (reference->constObject || reference->shortData)
+    ++reference->count;
+  else
+    cont.ResetReference();
+}
+
+
+void PContainer::ResetReference()
+{
+  // The derived classes then reset their members in ResetContents()
+  reference = &GetEmptyReference(reference->deleteObjects);
+  ++reference->count;
+}
+
+
+bool PContainer::HasEmptyReference() const
+{
+  return reference != NULL && reference->constObject && reference == &GetEmptyReference(reference->deleteObjects);
+}
+#endif
+
+
 void PContainer::AssignContents(const PContainer & cont)
 {
   if(cont.reference == NULL){
@@ -116,7 +217,7 @@ void PContainer::AssignContents(const PContainer & cont)
   if (reference == cont.reference)
     return;
 
-  if (--reference->count == 0) {
+  if (reference != NULL && --reference->count == 0) {
     DestroyContents();
     DestroyReference();
   }
@@ -258,11 +359,20 @@ void PAbstractArray::CopyContents(const PAbstractArray & array)
   theArray = array.theArray;
   allocatedDynamically = array.allocatedDynamically;
 
-  if (reference->constObject)
+  if (reference->constObject || reference->shortData)
     MakeUnique();
 }
 
 
+#if P_HAS_MOVE_SEMANTICS
+void PAbstractArray::ResetContents()
+{
+  theArray = NULL;
+  allocatedDynamically = true;
+}
+#endif
+
+
 void PAbstractArray::CloneContents(const PAbstractArray * array)
 {
   elementSize = array->elementSize;
@@ -412,6 +522,7 @@ PBoolean PAbstractArray::InternalSetSize(PINDEX newSize, PBoolean force)
 
 void PAbstractArray::Attach(const void *buffer, PINDEX bufferSize)
 {
+  MakeWritable();
   if (allocatedDynamically && theArray != NULL)
     PAbstractArrayAllocator()->deallocate(theArray, elementSize*GetSize());
 
@@ -648,17 +759,38 @@ PBoolean PBitArray::Concatenate(const PBitArray & array)
 ///////////////////////////////////////////////////////////////////////////////
 
 PString::PString()
-  : PCharArray(1)
+  : PCharArray(*new PStringShortReference(1))
   , m_length(0)
 {
+  theArray = ShortBuffer(reference);
 }
 
 
 PString::PString(const PString & str)
-  : PCharArray(str)
+  : PCharArray(*str.reference)
+{
+  InternalShare(str);
+}
+
+
+#if P_HAS_MOVE_SEMANTICS
+PString::PString(PString && str) noexcept
+  : PCharArray(*str.reference)
   , m_length(str.GetLength())
 {
+  theArray = str.theArray;
+  allocatedDynamically = str.allocatedDynamically;
+
+  /* Static strings cannot be taken over, nor can the buffer of a stream, as
+     its streambuf still points to it, so take a copy */
+  if (reference->constObject || PIsDescendant(&str, PStringStream)) {
+    InternalShare(str);
+    MakeUnique();
+  }
+  else
+    str.InternalDetach();
 }
+#endif
 
 
 PString::PString(const PCharArray & buf)
@@ -669,8 +801,10 @@ PString::PString(const PCharArray & buf)
 
 
 PString::PString(const PBYTEArray & buf)
-  : m_length(0)
+  : PCharArray(*new PStringShortReference(1))
+  , m_length(0)
 {
+  theArray = ShortBuffer(reference);
   PINDEX bufSize = buf.GetSize();
   if (bufSize > 0) {
     if (buf[bufSize-1] == '\0')
@@ -681,24 +815,29 @@ PString::PString(const PBYTEArray & buf)
 
 
 PString::PString(int, const PString * str)
-  : PCharArray(*str)
-  , m_length(str->GetLength())
+  : PCharArray(*str->reference)
 {
+  InternalShare(*str);
 }
 
 
 PString::PString(const std::string & str)
-  : PCharArray(str.c_str(), str.length()+1)
-  , m_length(str.length())
+  : PCharArray(*new PStringShortReference(1))
+  , m_length(0)
 {
+  theArray = ShortBuffer(reference);
+  PINDEX len = str.length();
+  memcpy(GetPointerAndSetLength(len), str.c_str(), len);
 }
 
 
 PString::PString(char c)
-  : PCharArray(2)
+  : PCharArray(*new PStringShortReference(2))
   , m_length(1)
 {
-  *theArray = c;
+  theArray = ShortBuffer(reference);
+  theArray[0] = c;
+  theArray[1] = '\0';
 }
 
 
@@ -713,20 +852,23 @@ const PString & PString::Empty()
 
 
 PString::PString(const char * cstr)
+  : PCharArray(*new PStringShortReference(1))
+  , m_length(0)
 {
-  if (cstr == NULL)
-    MakeEmpty();
-  else {
-    m_length = (PINDEX)strlen(cstr);
-    if (SetSize(m_length+1) && m_length > 0)
-      memcpy(theArray, cstr, m_length);
+  theArray = ShortBuffer(reference);
+  if (cstr != NULL) {
+    PINDEX len = (PINDEX)strlen(cstr);
+    memcpy(GetPointerAndSetLength(len), cstr, len);
   }
 }
 
 #ifdef P_HAS_WCHAR
 
 PString::PString(const wchar_t * ustr)
+  : PCharArray(*new PStringShortReference(1))
+  , m_length(0)
 {
+  theArray = ShortBuffer(reference);
   if (ustr == NULL)
     MakeEmpty();
   else {
@@ -738,13 +880,19 @@ PString::PString(const wchar_t * ustr)
 }
 
 PString::PString(const wchar_t * ustr, PINDEX len)
+  : PCharArray(*new PStringShortReference(1))
+  , m_length(0)
 {
+  theArray = ShortBuffer(reference);
   InternalFromUCS2(ustr, len);
 }
 
 
 PString::PString(const PWCharArray & ustr)
+  : PCharArray(*new PStringShortReference(1))
+  , m_length(0)
 {
+  theArray = ShortBuffer(reference);
   PINDEX size = ustr.GetSize();
   if (size > 0 && ustr[size-1] == 0) // Stip off trailing NULL if present
     size--;
@@ -754,11 +902,12 @@ PString::PString(const PWCharArray & ustr)
 #endif // P_HAS_WCHAR
 
 PString::PString(const char * cstr, PINDEX len)
-  : PCharArray(len+1)
-  , m_length(len)
+  : PCharArray(*new PStringShortReference(1))
+  , m_length(0)
 {
+  theArray = ShortBuffer(reference);
   if (len > 0)
-    memcpy(theArray, PAssertNULL(cstr), len);
+    memcpy(GetPointerAndSetLength(len), PAssertNULL(cstr), len);
 }
 
 
@@ -818,9 +967,10 @@ static void TranslateEscapes(const char * & src, char * dst)
 
 
 PString::PString(ConversionType type, const char * str, ...)
-  : PCharArray(1)
+  : PCharArray(*new PStringShortReference(1))
   , m_length(0)
 {
+  theArray = ShortBuffer(reference);
   switch (type) {
     case Pascal :
       if (*str != '\0') {
@@ -878,61 +1028,93 @@ template <typename S, typename U> PINDEX p_signed2string(S value, unsigned base,
 
 
 PString::PString(short n)
-  : PCharArray(sizeof(short)*3+2)
-  , m_length(p_signed2string<signed int, unsigned>(n, 10, theArray))
+  : PCharArray(*new PStringShortReference(1))
+  , m_length(0)
 {
+  theArray = ShortBuffer(reference);
+  char buffer[sizeof(short)*3+2];
+  PINDEX len = p_signed2string<signed int, unsigned>(n, 10, buffer);
+  memcpy(GetPointerAndSetLength(len), buffer, len);
 }
 
 
 PString::PString(unsigned short n)
-  : PCharArray(sizeof(unsigned short)*3+1)
-  , m_length(p_unsigned2string<unsigned int>(n, 10, theArray))
+  : PCharArray(*new PStringShortReference(1))
+  , m_length(0)
 {
+  theArray = ShortBuffer(reference);
+  char buffer[sizeof(unsigned short)*3+1];
+  PINDEX len = p_unsigned2string<unsigned int>(n, 10, buffer);
+  memcpy(GetPointerAndSetLength(len), buffer, len);
 }
 
 
 PString::PString(int n)
-  : PCharArray(sizeof(int)*3+2)
-  , m_length(p_signed2string<signed int, unsigned>(n, 10, theArray))
+  : PCharArray(*new PStringShortReference(1))
+  , m_length(0)
 {
+  theArray = ShortBuffer(reference);
+  char buffer[sizeof(int)*3+2];
+  PINDEX len = p_signed2string<signed int, unsigned>(n, 10, buffer);
+  memcpy(GetPointerAndSetLength(len), buffer, len);
 }
 
 
 PString::PString(unsigned int n)
-  : PCharArray(sizeof(unsigned int)*3+1)
-  , m_length(p_unsigned2string<unsigned int>(n, 10, theArray))
+  : PCharArray(*new PStringShortReference(1))
+  , m_length(0)
 {
+  theArray = ShortBuffer(reference);
+  char buffer[sizeof(unsigned int)*3+1];
+  PINDEX len = p_unsigned2string<unsigned int>(n, 10, buffer);
+  memcpy(GetPointerAndSetLength(len), buffer, len);
 }
 
 
 PString::PString(long n)
-  : PCharArray(sizeof(long)*3+2)
-  , m_length(p_signed2string<signed long, unsigned long>(n, 10, theArray))
+  : PCharArray(*new PStringShortReference(1))
+  , m_length(0)
 {
+  theArray = ShortBuffer(reference);
+  char buffer[sizeof(long)*3+2];
+  PINDEX len = p_signed2string<signed long, unsigned long>(n, 10, buffer);
+  memcpy(GetPointerAndSetLength(len), buffer, len);
 }
 
 
 PString::PString(unsigned long n)
-  : PCharArray(sizeof(unsigned long)*3+1)
-  , m_length(p_unsigned2string<unsigned long>(n, 10, theArray))
+  : PCharArray(*new PStringShortReference(1))
+  , m_length(0)
 {
+  theArray = ShortBuffer(reference);
+  char buffer[sizeof(unsigned long)*3+1];
+  PINDEX len = p_unsigned2string<unsigned long>(n, 10, buffer);
+  memcpy(GetPointerAndSetLength(len), buffer, len);
 }
 
 
 #ifdef HAVE_LONG_LONG_INT
 PString::PString(long long n)
-  : PCharArray(sizeof(long long)*3+2)
-  , m_length(p_signed2string<signed long long, unsigned long long>(n, 10, theArray))
+  : PCharArray(*new PStringShortReference(1))
+  , m_length(0)
 {
+  theArray = ShortBuffer(reference);
+  char buffer[sizeof(long long)*3+2];
+  PINDEX len = p_signed2string<signed long long, unsigned long long>(n, 10, buffer);
+  memcpy(GetPointerAndSetLength(len), buffer, len);
 }
 #endif
 
 
 #ifdef HAVE_UNSIGNED_LONG_LONG_INT
 PString::PString(unsigned long long n)
-  : PCharArray(sizeof(unsigned long long)*3+1)
-  , m_length(p_unsigned2string<unsigned long long>(n, 10, theArray))
+  : PCharArray(*new PStringShortReference(1))
+  , m_length(0)
 {
+  theArray = ShortBuffer(reference);
+  char buffer[sizeof(unsigned long long)*3+1];
+  PINDEX len = p_unsigned2string<unsigned long long>(n, 10, buffer);
+  memcpy(GetPointerAndSetLength(len), buffer, len);
 }
 #endif
 
@@ -1004,9 +1186,13 @@ template <typename S, typename U>
 
 #define PSTRING_CONV_CTOR(paramType, signedType, unsignedType) \
 PString::PString(ConversionType type, paramType value, unsigned param) \
-  : PCharArray(sizeof(paramType)*3+1) \
+  : PCharArray(*new PStringShortReference(1)) \
+  , m_length(0) \
 { \
-  m_length = p_convert<signedType, unsignedType>(type, value, param, theArray); \
+  theArray = ShortBuffer(reference); \
+  char buffer[sizeof(paramType)*8+2]; /* Big enough for base 2 */ \
+  PINDEX len = p_convert<signedType, unsignedType>(type, value, param, buffer); \
+  memcpy(GetPointerAndSetLength(len), buffer, len); \
 }
 
 PSTRING_CONV_CTOR(unsigned char,  char,   unsigned char);
@@ -1025,8 +1211,10 @@ PSTRING_CONV_CTOR(unsigned long long, long long, unsigned long long);
 
 
 PString::PString(ConversionType type, double value, unsigned places)
-  : m_length(0)
+  : PCharArray(*new PStringShortReference(1))
+  , m_length(0)
 {
+  theArray = ShortBuffer(reference);
   switch (type) {
     case Decimal :
       sprintf("%0.*f", (int)places, value);
@@ -1073,6 +1261,7 @@ PString & PString::operator=(short n)
 {
   SetMinSize(sizeof(short)*3+1);
   m_length = p_signed2string<signed int, unsigned int>(n, 10, theArray);
+  theArray[m_length] = '\0';
   return *this;
 }
 
@@ -1081,6 +1270,7 @@ PString & PString::operator=(unsigned short n)
 {
   SetMinSize(sizeof(unsigned short)*3+1);
   m_length = p_unsigned2string<unsigned int>(n, 10, theArray);
+  theArray[m_length] = '\0';
   return *this;
 }
 
@@ -1089,6 +1279,7 @@ PString & PString::operator=(int n)
 {
   SetMinSize(sizeof(int)*3+1);
   m_length = p_signed2string<signed int, unsigned int>(n, 10, theArray);
+  theArray[m_length] = '\0';
   return *this;
 }
 
@@ -1097,6 +1288,7 @@ PString & PString::operator=(unsigned int n)
 {
   SetMinSize(sizeof(unsigned int)*3+1);
   m_length = p_unsigned2string<unsigned int>(n, 10, theArray);
+  theArray[m_length] = '\0';
   return *this;
 }
 
@@ -1105,6 +1297,7 @@ PString & PString::operator=(long n)
 {
   SetMinSize(sizeof(long)*3+1);
   m_length = p_signed2string<signed long,  unsigned long>(n, 10, theArray);
+  theArray[m_length] = '\0';
   return *this;
 }
 
@@ -1113,6 +1306,7 @@ PString & PString::operator=(unsigned long n)
 {
   SetMinSize(sizeof(unsigned long)*3+1);
   m_length = p_unsigned2string<unsigned long>(n, 10, theArray);
+  theArray[m_length] = '\0';
   return *this;
 }
 
@@ -1122,6 +1316,7 @@ PString & PString::operator=(long long n)
 {
   SetMinSize(sizeof(long long)*3+1);
   m_length = p_signed2string<signed long long, unsigned long long>(n, 10, theArray);
+  theArray[m_length] = '\0';
   return *this;
 }
 #endif
@@ -1132,6 +1327,7 @@ PString & PString::operator=(unsigned long long n)
 {
   SetMinSize(sizeof(unsigned long long)*3+1);
   m_length = p_unsigned2string<unsigned long long>(n, 10, theArray);
+  theArray[m_length] = '\0';
   return *this;
 }
 #endif
@@ -1139,8 +1335,136 @@ PString & PString::operator=(unsigned long long n)
 
 void PString::AssignContents(const PContainer & cont)
 {
-  PCharArray::AssignContents(cont);
-  m_length = ((const PString &)cont).GetLength();
+  const PString & str = (const PString &)cont;
+  if (reference == str.reference)
+    return;
+
+  if (reference != NULL && --reference->count == 0) {
+    DestroyContents();
+    DestroyReference();
+  }
+
+  reference = str.reference;
+  InternalShare(str);
+}
+
+
+void PString::InternalShare(const PString & str)
+{
+  /* Share directly rather than via PCharArray, which would take a copy of
+     short string data as it only knows how to release its own references. */
+  PAssert2(reference != NULL, str.GetClass(), "Copy of deleted string");
+  ++reference->count;
+  theArray = str.theArray;
+  allocatedDynamically = str.allocatedDynamically;
+  m_length = str.GetLength();
+
+  if (reference->constObject)
+    MakeUnique();
+}
+
+
+void PString::DestroyReference()
+{
+  if (reference->shortData)
+    delete static_cast<PStringShortReference *>(reference);
+  else
+    delete reference;
+  reference = NULL;
+}
+
+
+#if P_HAS_MOVE_SEMANTICS
+void PString::MoveContents(PContainer & cont)
+{
+  PString & str = (PString &)cont;
+  if (&str == this)
+    return;
+
+  // Static strings, or the buffer a stream still points to, cannot be taken over
+  if (str.reference->constObject || PIsDescendant(&str, PStringStream)) {
+    PString::AssignContents(str);
+    MakeUnique();
+    return;
+  }
+
+  if (reference == str.reference)
+    --reference->count;
+  else if (reference != NULL && --reference->count == 0) {
+    DestroyContents();
+    DestroyReference();
+  }
+
+  reference = str.reference;
+  theArray = str.theArray;
+  allocatedDynamically = str.allocatedDynamically;
+  m_length = str.GetLength();
+  str.InternalDetach();
+}
+#endif
+
+
+static PStringShortReference * NewEmptyShortReference()
+{
+  PMEMORY_IGNORE_ALLOCATIONS_FOR_SCOPE;
+  return new PStringShortReference(1);
+}
+
+
+static PStringShortReference & GetEmptyShortReference()
+{
+  /* Shared by all moved from strings and never deleted, the count cannot get
+     to zero, so it is never unique and anything modifying the string copies. */
+  static PStringShortReference * const Empty = NewEmptyShortReference();
+  return *Empty;
+}
+
+
+void PString::InternalDetach()
+{
+  // Our contents now belong to another string, start again empty
+  reference = &GetEmptyShortReference();
+  ++reference->count;
+  theArray = ShortBuffer(reference);
+  allocatedDynamically = false;
+  m_length = 0;
+}
+
+
+void PString::InternalSetShortSize(PINDEX newSize)
+{
+  PINDEX oldSize = GetSize();
+  PINDEX copySize = std::min(oldSize, newSize);
+
+  if (!IsUnique() || !reference->shortData) {
+    PContainerReference * newReference = new PStringShortReference(newSize);
+    if (copySize > 0)
+      memcpy(ShortBuffer(newReference), theArray, copySize);
+
+    if (--reference->count == 0) {
+      // Only release the memory, not a DestroyContents() for descendants
+      PAbstractArray::DestroyContents();
+      DestroyReference();
+    }
+    reference = newReference;
+    theArray = ShortBuffer(reference);
+    allocatedDynamically = false;
+    return;
+  }
+
+  char * buffer = ShortBuffer(reference);
+  if (theArray != buffer) {
+    // Grew onto the heap earlier, move back into our block
+    memcpy(buffer, theArray, copySize);
+    PAbstractArray::DestroyContents();
+    theArray = buffer;
+    allocatedDynamically = false;
+    oldSize = copySize;
+  }
+
+  if (newSize > oldSize)
+    memset(theArray+oldSize, 0, newSize-oldSize);
+  reference->size = newSize;
 }
 
 
@@ -1198,26 +1522,15 @@ PObject::Comparison PString::Compare(const PObject & obj) const
 
 PINDEX PString::HashFunction() const
 {
-  /* Hash function from "Data Structures and Algorithm Analysis in C++" by
-     Mark Allen Weiss, with limit of only executing over at most the first and
-     last characters to increase speed when dealing with large strings. */
-
-  switch (GetLength()) { // Use virtual function so PStringStream recalculates length
-    case 0:
-      return 0;
-    case 1:
-      return tolower(theArray[0] & 0xff) % 127;
+  /* 32 bit FNV-1a hash, case insensitive so PCaselessString keys work. The
+     hash table does the reduction to a bucket index, so full width here. */
+  PINDEX length = GetLength(); // Use virtual function so PStringStream recalculates length
+  uint32_t hash = 2166136261U;
+  for (PINDEX i = 0; i < length; i++) {
+    hash ^= tolower(theArray[i] & 0xff);
+    hash *= 16777619U;
   }
-
-  static const PINDEX MaxCount = 18; // Make sure big enough to cover whole PGloballyUniqueID::AsString()
-  PINDEX count = std::min(m_length / 2, MaxCount);
-  PINDEX hash = 0;
-  PINDEX i;
-  for (i = 0; i < count; i++)
-    hash = (hash << 5) ^ tolower(theArray[i] & 0xff) ^ hash;
-  for (i = m_length - count - 1; i < m_length; i++)
-    hash = (hash << 5) ^ tolower(theArray[i] & 0xff) ^ hash;
-  return PABSINDEX(hash) % 127;
+  return (PINDEX)hash;
 }
 
 
@@ -1232,7 +1545,11 @@ PBoolean PString::SetSize(PINDEX newSize)
   if (newSize < 1)
     newSize = 1;
 
-  if (!InternalSetSize(newSize, !IsUnique()))
+  if (newSize <= PStringShortReference::BufferSize) {
+    if (newSize != GetSize() || !IsUnique())
+      InternalSetShortSize(newSize);
+  }
+  else if (!InternalSetSize(newSize, !IsUnique()))
     return false;
 
   if (GetLength() >= newSize) {
@@ -1249,7 +1566,10 @@ PBoolean PString::MakeUnique()
   if (IsUnique())
     return true;
 
-  InternalSetSize(GetSize(), true);
+  if (GetSize() <= PStringShortReference::BufferSize)
+    InternalSetShortSize(GetSize());
+  else
+    InternalSetSize(GetSize(), true);
   return false;
 }
 
@@ -2318,12 +2638,10 @@ streambuf::int_type PStringStream::Buffer::overflow(int_type c)
     if (fixedBufferSize)
       return EOF;
 
-    size_t gpos = gptr() - eback();
-    size_t ppos = pptr() - pbase();
-    char * newptr = string.GetPointer(string.GetSize() + 32);
-    setp(newptr, newptr + string.GetSize() - 1);
-    pbump(ppos);
-    setg(newptr, newptr + gpos, newptr + ppos);
+    // Grow geometrically, or building big strings is quadratic
+    PINDEX size = string.GetSize();
+    if (!SetBufferSize(size + std::max(size, (PINDEX)32)))
+      return EOF;
   }
 
   if (c != EOF) {
@@ -2335,6 +2653,21 @@ streambuf::int_type PStringStream::Buffer::overflow(int_type c)
 }
 
 
+bool PStringStream::Buffer::SetBufferSize(PINDEX size)
+{
+  size_t gpos = gptr() - eback();
+  size_t ppos = pptr() - pbase();
+  if (!string.SetSize(size))
+    return false;
+
+  char * newptr = string.GetPointer();
+  setp(newptr, newptr + string.GetSize() - 1);
+  pbump(ppos);
+  setg(newptr, newptr + gpos, newptr + ppos);
+  return true;
+}
+
+
 streambuf::int_type PStringStream::Buffer::underflow()
 {
   return gptr() >= egptr() ? EOF : *gptr();
@@ -2471,6 +2804,27 @@ PINDEX PStringStream::GetLength() const
 }
 
 
+bool PStringStream::Reserve(PINDEX capacity)
+{
+  if (capacity < GetSize())
+    return true;
+
+  PStringStream::Buffer * buf = dynamic_cast<PStringStream::Buffer *>(rdbuf());
+  return buf != NULL && buf->SetBufferSize(capacity+1);
+}
+
+
+PBoolean PStringStream::MakeMinimumSize()
+{
+  PStringStream::Buffer * buf = dynamic_cast<PStringStream::Buffer *>(rdbuf());
+  if (buf == NULL)
+    return false;
+
+  PINDEX length = std::max(GetLength(), buf->GetWritePosition());
+  return buf->SetBufferSize(length+1);
+}
+
+
 void PStringStream::AssignContents(const PContainer & cont)
 {
   PString::AssignContents(cont);
@@ -42,6 +42,11 @@
 #include <fstream>
 #include <ctype.h>
 #include <limits>
+
+#if defined(__GNUC__)
+#include <cxxabi.h>
+#endif
+
 #ifdef _WIN32
 #include <ptlib/msos/ptlib/debstrm.h>
 #if defined(_MSC_VER) && !defined(_WIN32_WCE)
@@ -325,8 +330,393 @@ PObject::Comparison PSmartPointer::Compare(const PObject & obj) const
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+// Arena allocation
+
+PArena::PArena(size_t blockSize)
+  : m_blockSize((blockSize + Alignment-1) & ~(size_t)(Alignment-1))
+  , m_blocks(NULL)
+  , m_next(NULL)
+  , m_end(NULL)
+  , m_bytesUsed(0)
+  , m_blockCount(0)
+{
+}
+
+
+void * PArena::AllocateBlock(size_t size)
+{
+  static const size_t HeaderSize = (sizeof(Block) + Alignment-1) & ~(size_t)(Alignment-1);
+
+  // Large allocations get a block of their own, so the current block is not wasted
+  bool dedicated = size > m_blockSize/4;
+
+  Block * block = (Block *)::operator new(HeaderSize + (dedicated ? size : m_blockSize));
+  ++m_blockCount;
+  char * data = (char *)block + HeaderSize;
+
+  if (dedicated && m_blocks != NULL) {
+    block->m_next = m_blocks->m_next;
+    m_blocks->m_next = block;
+    return data;
+  }
+
+  block->m_next = m_blocks;
+  m_blocks = block;
+  if (dedicated)
+    m_next = m_end = NULL;
+  else {
+    m_next = data + size;
+    m_end = data + m_blockSize;
+  }
+  return data;
+}
+
+
+void PArena::Release()
+{
+  while (m_blocks != NULL) {
+    Block * next = m_blocks->m_next;
+    ::operator delete(m_blocks);
+    m_blocks = next;
+  }
+
+  m_next = m_end = NULL;
+  m_bytesUsed = 0;
+  m_blockCount = 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Fixed size pool allocation
+
+#if (__cplusplus >= 201103L) || (defined(_MSC_VER) && _MSC_VER >= 1900)
+  #define P_POOL_THREAD_CACHE 1
+#else
+  #define P_POOL_THREAD_CACHE 0
+#endif
+
+static const unsigned MaxCachedPools = 32;      // Pools beyond this always use the depot
+static const unsigned PoolCacheLimit = 64;      // Blocks in a thread cache before half go back
+static const size_t   PoolChunkSize  = 16384;   // Bytes obtained from heap at a time
+
+struct PFixedSizePoolThreadCache
+{
+  void   * m_head;
+  unsigned m_count;
+  unsigned m_allocations;
+  unsigned m_cacheHits;
+};
+
+typedef std::vector<PFixedSizePool *> PFixedSizePoolList;
+
+// Neither of these are ever deleted, pools may be used during static destruction
+static PCriticalSection & GetPoolListMutex()
+{
+  static PCriticalSection * mutex = new PCriticalSection;
+  return *mutex;
+}
+
+static PFixedSizePoolList & GetPoolList()
+{
+  static PFixedSizePoolList * pools = new PFixedSizePoolList;
+  return *pools;
+}
+
+
+#if P_POOL_THREAD_CACHE
+
+static thread_local PFixedSizePoolThreadCache t_poolCaches[MaxCachedPools];
+static thread_local unsigned t_poolCacheLimit = PoolCacheLimit;
+
+class PFixedSizePoolCacheFlusher
+{
+  public:
+    // Calling this constructs the thread_local instance, so destructor runs at thread exit
+    void Activate() { }
+
+    ~PFixedSizePoolCacheFlusher()
+    {
+      // Anything released from now on in this thread goes straight to the depot
+      t_poolCacheLimit = 0;
+
+      PWaitAndSignal lock(GetPoolListMutex());
+      PFixedSizePoolList & pools = GetPoolList();
+      for (size_t i = 0; i < pools.size() && i < MaxCachedPools; ++i)
+        pools[i]->Flush(t_poolCaches[i], 0);
+    }
+};
+
+static thread_local PFixedSizePoolCacheFlusher t_poolCacheFlusher;
+
+#endif // P_POOL_THREAD_CACHE
+
+
+PFixedSizePool::PFixedSizePool(unsigned index, size_t blockSize, const char * className, PCriticalSection & mutex)
+  : m_index(index)
+  , m_blockSize((std::max(blockSize, sizeof(Block)) + sizeof(void *)-1) & ~(sizeof(void *)-1))
+  , m_className(className)
+  , m_mutex(mutex)
+  , m_depot(NULL)
+  , m_depotBlocks(0)
+  , m_bytesHeld(0)
+  , m_allocations(0)
+  , m_cacheHits(0)
+{
+}
+
+
+PFixedSizePool & PFixedSizePool::Get(size_t blockSize, const char * className)
+{
+  PWaitAndSignal lock(GetPoolListMutex());
+  PFixedSizePoolList & pools = GetPoolList();
+  PFixedSizePool * pool = new PFixedSizePool((unsigned)pools.size(), blockSize, className, *new PCriticalSection);
+  pools.push_back(pool);
+  return *pool;
+}
+
+
+void * PFixedSizePool::Allocate()
+{
+#if P_POOL_THREAD_CACHE
+  if (m_index < MaxCachedPools) {
+    PFixedSizePoolThreadCache & cache = t_poolCaches[m_index];
+    ++cache.m_allocations;
+    Block * block = (Block *)cache.m_head;
+    if (block == NULL)
+      return Refill(cache);
+
+    cache.m_head = block->m_next;
+    --cache.m_count;
+    ++cache.m_cacheHits;
+    return block;
+  }
+#endif
+
+  PWaitAndSignal lock(m_mutex);
+  ++m_allocations;
+  if (m_depot == NULL)
+    m_depot = NewChunk();
+  Block * block = m_depot;
+  m_depot = block->m_next;
+  --m_depotBlocks;
+  return block;
+}
+
+
+void PFixedSizePool::Deallocate(void * ptr)
+{
+  if (ptr == NULL)
+    return;
+
+  Block * block = (Block *)ptr;
+
+#if P_POOL_THREAD_CACHE
+  if (m_index < MaxCachedPools) {
+    PFixedSizePoolThreadCache & cache = t_poolCaches[m_index];
+    block->m_next = (Block *)cache.m_head;
+    cache.m_head = block;
+    if (++cache.m_count == 1)
+      t_poolCacheFlusher.Activate(); // Thread may only ever release, never Refill()
+    if (cache.m_count > t_poolCacheLimit)
+      Flush(cache, t_poolCacheLimit/2);
+    return;
+  }
+#endif
+
+  PWaitAndSignal lock(m_mutex);
+  block->m_next = m_depot;
+  m_depot = block;
+  ++m_depotBlocks;
+}
+
+
+void * PFixedSizePool::Refill(PFixedSizePoolThreadCache & cache)
+{
+#if P_POOL_THREAD_CACHE
+  t_poolCacheFlusher.Activate();
+  unsigned batch = t_poolCacheLimit/2;
+#else
+  unsigned batch = 0;
+#endif
+
+  PWaitAndSignal lock(m_mutex);
+  FlushStatistics(cache);
+
+  if (m_depot == NULL)
+    m_depot = NewChunk();
+
+  Block * block = m_depot;
+  m_depot = block->m_next;
+  --m_depotBlocks;
+
+  while (batch-- > 0 && m_depot != NULL) {
+    Block * cached = m_depot;
+    m_depot = cached->m_next;
+    --m_depotBlocks;
+    cached->m_next = (Block *)cache.m_head;
+    cache.m_head = cached;
+    ++cache.m_count;
+  }
+
+  return block;
+}
+
+
+void PFixedSizePool::Flush(PFixedSizePoolThreadCache & cache, unsigned keep)
+{
+  PWaitAndSignal lock(m_mutex);
+  FlushStatistics(cache);
+
+  while (cache.m_count > keep) {
+    Block * block = (Block *)cache.m_head;
+    cache.m_head = block->m_next;
+    --cache.m_count;
+    block->m_next = m_depot;
+    m_depot = block;
+    ++m_depotBlocks;
+  }
+}
+
+
+void PFixedSizePool::FlushStatistics(PFixedSizePoolThreadCache & cache)
+{
+  m_allocations += cache.m_allocations;
+  m_cacheHits += cache.m_cacheHits;
+  cache.m_allocations = cache.m_cacheHits = 0;
+}
+
+
+PFixedSizePool::Block * PFixedSizePool::NewChunk()
+{
+  size_t count = std::max(PoolChunkSize/m_blockSize, (size_t)PoolCacheLimit);
+  char * chunk = (char *)::operator new(count*m_blockSize);
+  m_bytesHeld += count*m_blockSize;
+  m_depotBlocks += count;
+
+  for (size_t i = 0; i < count-1; ++i)
+    ((Block *)(chunk + i*m_blockSize))->m_next = (Block *)(chunk + (i+1)*m_blockSize);
+  ((Block *)(chunk + (count-1)*m_blockSize))->m_next = NULL;
+
+  return (Block *)chunk;
+}
+
+
+void PFixedSizePool::GetStatistics(Statistics & stats)
+{
+  PWaitAndSignal lock(m_mutex);
+
+#if P_POOL_THREAD_CACHE
+  if (m_index < MaxCachedPools)
+    FlushStatistics(t_poolCaches[m_index]);
+#endif
+
+  stats.m_className = m_className;
+  stats.m_blockSize = m_blockSize;
+  stats.m_allocations = m_allocations;
+  stats.m_cacheHits = m_cacheHits;
+  stats.m_bytesHeld = m_bytesHeld;
+  stats.m_depotBlocks = m_depotBlocks;
+}
+
+
+void PFixedSizePool::GetAllStatistics(StatisticsList & stats)
+{
+  PWaitAndSignal lock(GetPoolListMutex());
+  PFixedSizePoolList & pools = GetPoolList();
+  stats.resize(pools.size());
+  for (size_t i = 0; i < pools.size(); ++i)
+    pools[i]->GetStatistics(stats[i]);
+}
+
+
+void PFixedSizePool::PrintStatistics(ostream & strm)
+{
+  StatisticsList stats;
+  GetAllStatistics(stats);
+
+  std::ios::fmtflags flags = strm.flags();
+  std::streamsize precision = strm.precision();
+
+  strm << setw(24) << left << "Class" << right
+       << setw(6)  << "Size"
+       << setw(14) << "Allocations"
+       << setw(8)  << "Hit%"
+       << setw(10) << "Held"
+       << setw(8)  << "Free"
+       << '\n';
+  for (StatisticsList::iterator it = stats.begin(); it != stats.end(); ++it)
+    strm << setw(24) << left << it->m_className << right
+         << setw(6)  << it->m_blockSize
+         << setw(14) << it->m_allocations
+         << setw(8)  << setprecision(1) << fixed
+                     << (it->m_allocations > 0 ? it->m_cacheHits*100.0/it->m_allocations : 0.0)
+         << setw(10) << it->m_bytesHeld
+         << setw(8)  << it->m_depotBlocks
+         << '\n';
+
+  strm.flags(flags);
+  strm.precision(precision);
+  strm.flush();
+}
+
+
 
 //////////////////////////////////////////////////////////////////////////////////////////
+// Memory usage by class
+
+#if PMEMORY_CHECK || P_MEMORY_ACCOUNTING
+static bool CompareMemoryUsage(const PMemoryUsage::ClassInfo & info1, const PMemoryUsage::ClassInfo & info2)
+{
+  return info1.m_bytes > info2.m_bytes;
+}
+#endif
+
+
+std::string PMemoryUsage::GetClassName(const char * className)
+{
+#if defined(__GNUC__)
+  int status;
+  char * demangled = abi::__cxa_demangle(className, NULL, NULL, &status);
+  if (demangled != NULL) {
+    std::string name(demangled);
+    runtime_free(demangled);
+    return name;
+  }
+#endif
+  return className;
+}
+
+
+void PMemoryUsage::PrintClasses(ostream & strm, size_t maxClasses)
+{
+  ClassList classes;
+  if (!GetClasses(classes)) {
+    strm << "Memory usage by class is not available" << endl;
+    return;
+  }
+
+  if (maxClasses > 0 && classes.size() > maxClasses)
+    classes.resize(maxClasses);
+
+  std::ios::fmtflags flags = strm.flags();
+
+  strm << right
+       << setw(10) << "Objects"
+       << setw(14) << "Bytes"
+       << setw(14) << "Allocations"
+       << "  Class\n";
+  for (ClassList::iterator it = classes.begin(); it != classes.end(); ++it)
+    strm << setw(10) << it->m_objects
+         << setw(14) << it->m_bytes
+         << setw(14) << it->m_allocations
+         << "  " << GetClassName(it->m_className)
+         << '\n';
+
+  strm.flags(flags);
+  strm.flush();
+}
+
 
 #if PMEMORY_CHECK
 
@@ -912,6 +1302,65 @@ void PMemoryHeap::InternalDumpObjectsSince(DWORD objectNumber, ostream & strm)
 }
 
 
+void PMemoryHeap::InternalGetClasses(PMemoryUsage::ClassInfo * & infos, size_t & count)
+{
+  // Cannot use new while walking the heap, so gather into a plain C array
+  size_t allocated = 0;
+  for (Header * obj = listHead; obj != NULL; obj = obj->next) {
+    size_t i = 0;
+    while (i < count && infos[i].m_className != obj->className)
+      ++i;
+
+    if (i == count) {
+      if (count == allocated) {
+        allocated += 256;
+        PMemoryUsage::ClassInfo * grown = (PMemoryUsage::ClassInfo *)realloc(infos, allocated*sizeof(*infos));
+        if (grown == NULL)
+          return;
+        infos = grown;
+      }
+      infos[count++] = PMemoryUsage::ClassInfo(obj->className);
+    }
+
+    ++infos[i].m_objects;
+    infos[i].m_bytes += obj->size;
+  }
+}
+
+
+bool PMemoryUsage::GetClasses(ClassList & classes)
+{
+  ClassInfo * infos = NULL;
+  size_t count = 0;
+
+  {
+    PMemoryHeap::Wrapper mem;
+    if (mem->m_state != PMemoryHeap::e_Active)
+      return false;
+    mem->InternalGetClasses(infos, count);
+  }
+
+  classes.clear();
+  for (size_t i = 0; i < count; ++i) {
+    if (infos[i].m_className == NULL)
+      infos[i].m_className = "(not PObject)";
+    ClassList::iterator it = classes.begin();
+    while (it != classes.end() && strcmp(it->m_className, infos[i].m_className) != 0)
+      ++it;
+    if (it == classes.end())
+      classes.push_back(infos[i]);
+    else {
+      it->m_objects += infos[i].m_objects;
+      it->m_bytes += infos[i].m_bytes;
+    }
+  }
+  free(infos);
+
+  std::sort(classes.begin(), classes.end(), CompareMemoryUsage);
+  return true;
+}
+
+
 #else // PMEMORY_CHECK
 
 #if defined(_MSC_VER) && defined(_DEBUG) && !defined(_WIN32_WCE)
@@ -1085,6 +1534,226 @@ void operator delete[](void * ptr)
 #endif // PMEMORY_CHECK
 
 
+#if !PMEMORY_CHECK
+
+#if P_MEMORY_ACCOUNTING
+
+static const unsigned MemoryUsagePageSize = 64;
+static const unsigned MemoryUsageMaxPages = 64;  // Classes beyond 4096 are all counted as "other"
+
+struct PMemoryUsageCounters
+{
+  atomic<PInt64>  m_objects;
+  atomic<PInt64>  m_bytes;
+  atomic<PUInt64> m_allocations;
+
+  // Only the owning thread writes, so no locked read-modify-write is needed
+  void Add(PInt64 objects, PInt64 bytes)
+  {
+    m_objects.store(m_objects.load(memory_order_relaxed) + objects, memory_order_relaxed);
+    m_bytes.store(m_bytes.load(memory_order_relaxed) + bytes, memory_order_relaxed);
+    if (objects > 0)
+      m_allocations.store(m_allocations.load(memory_order_relaxed) + objects, memory_order_relaxed);
+  }
+
+  void AddTo(PMemoryUsage::ClassInfo & info) const
+  {
+    info.m_objects += m_objects.load(memory_order_relaxed);
+    info.m_bytes += m_bytes.load(memory_order_relaxed);
+    info.m_allocations += m_allocations.load(memory_order_relaxed);
+  }
+};
+
+struct PMemoryUsagePage
+{
+  PMemoryUsageCounters m_counters[MemoryUsagePageSize];
+};
+
+struct PMemoryUsagePages
+{
+  PMemoryUsagePage * m_page[MemoryUsageMaxPages];
+  bool               m_ended;
+};
+
+struct PMemoryUsageRegistry
+{
+  PMemoryUsageRegistry()
+    : m_classes(1, PMemoryUsage::ClassInfo("(other)"))
+  {
+  }
+
+  PCriticalSection                  m_mutex;
+  std::map<std::string, unsigned>   m_indexes;
+  PMemoryUsage::ClassList           m_classes; // Name, and totals from threads that have ended
+  std::vector<PMemoryUsagePages *>  m_threads;
+};
+
+// Never deleted, objects may be deleted during static destruction
+static PMemoryUsageRegistry & GetMemoryUsageRegistry()
+{
+  static PMemoryUsageRegistry * registry = new PMemoryUsageRegistry;
+  return *registry;
+}
+
+
+static thread_local PMemoryUsagePages t_memoryUsagePages;
+
+class PMemoryUsageThread
+{
+  public:
+    // Calling this constructs the thread_local instance, so destructor runs at thread exit
+    void Activate() { }
+
+    ~PMemoryUsageThread()
+    {
+      PMemoryUsageRegistry & registry = GetMemoryUsageRegistry();
+      PWaitAndSignal lock(registry.m_mutex);
+
+      // Anything released from now on in this thread is counted directly in the registry
+      t_memoryUsagePages.m_ended = true;
+
+      registry.m_threads.erase(std::find(registry.m_threads.begin(), registry.m_threads.end(), &t_memoryUsagePages));
+
+      for (unsigned page = 0; page < MemoryUsageMaxPages; ++page) {
+        if (t_memoryUsagePages.m_page[page] == NULL)
+          continue;
+        for (unsigned i = 0; i < MemoryUsagePageSize; ++i) {
+          unsigned index = page*MemoryUsagePageSize + i;
+          if (index < registry.m_classes.size())
+            t_memoryUsagePages.m_page[page]->m_counters[i].AddTo(registry.m_classes[index]);
+        }
+        delete t_memoryUsagePages.m_page[page];
+        t_memoryUsagePages.m_page[page] = NULL;
+      }
+    }
+};
+
+static thread_local PMemoryUsageThread t_memoryUsageThread;
+
+
+static void CountMemoryUsage(unsigned index, PInt64 objects, PInt64 bytes)
+{
+  PMemoryUsagePages & pages = t_memoryUsagePages;
+  PMemoryUsagePage * page = pages.m_page[index/MemoryUsagePageSize];
+  if (page != NULL) {
+    page->m_counters[index%MemoryUsagePageSize].Add(objects, bytes);
+    return;
+  }
+
+  PMemoryUsageRegistry & registry = GetMemoryUsageRegistry();
+  PWaitAndSignal lock(registry.m_mutex);
+
+  if (pages.m_ended) {
+    PMemoryUsage::ClassInfo & info = registry.m_classes[index];
+    info.m_objects += objects;
+    info.m_bytes += bytes;
+    if (objects > 0)
+      info.m_allocations += objects;
+    return;
+  }
+
+  // First use of this page of classes by this thread
+  if (std::find(registry.m_threads.begin(), registry.m_threads.end(), &pages) == registry.m_threads.end()) {
+    t_memoryUsageThread.Activate();
+    registry.m_threads.push_back(&pages);
+  }
+
+  page = new PMemoryUsagePage();
+  page->m_counters[index%MemoryUsagePageSize].Add(objects, bytes);
+  pages.m_page[index/MemoryUsagePageSize] = page;
+}
+
+
+unsigned PMemoryUsage::Register(const char * className)
+{
+  PMemoryUsageRegistry & registry = GetMemoryUsageRegistry();
+  PWaitAndSignal lock(registry.m_mutex);
+
+  // The same class may be registered from different modules, count them together
+  std::map<std::string, unsigned>::iterator it = registry.m_indexes.find(className);
+  if (it != registry.m_indexes.end())
+    return it->second;
+
+  if (registry.m_classes.size() >= MemoryUsagePageSize*MemoryUsageMaxPages)
+    return 0;
+
+  unsigned index = (unsigned)registry.m_classes.size();
+  registry.m_indexes[className] = index;
+  registry.m_classes.push_back(ClassInfo(className));
+  return index;
+}
+
+
+void * PMemoryUsage::Allocate(size_t nSize, unsigned index)
+{
+  void * ptr = ::operator new(nSize);
+  CountMemoryUsage(index, 1, nSize);
+  return ptr;
+}
+
+
+void * PMemoryUsage::Allocate(size_t nSize, unsigned index, const std::nothrow_t & nt)
+{
+  void * ptr = ::operator new(nSize, nt);
+  if (ptr != NULL)
+    CountMemoryUsage(index, 1, nSize);
+  return ptr;
+}
+
+
+void PMemoryUsage::Deallocate(void * ptr, size_t nSize, unsigned index)
+{
+  if (ptr == NULL)
+    return;
+
+  CountMemoryUsage(index, -1, -(PInt64)nSize);
+  ::operator delete(ptr);
+}
+
+
+bool PMemoryUsage::GetClasses(ClassList & classes)
+{
+  {
+    PMemoryUsageRegistry & registry = GetMemoryUsageRegistry();
+    PWaitAndSignal lock(registry.m_mutex);
+
+    classes = registry.m_classes;
+    for (std::vector<PMemoryUsagePages *>::iterator it = registry.m_threads.begin(); it != registry.m_threads.end(); ++it) {
+      PMemoryUsagePages & pages = **it;
+      for (unsigned page = 0; page < MemoryUsageMaxPages; ++page) {
+        if (pages.m_page[page] == NULL)
+          continue;
+        for (unsigned i = 0; i < MemoryUsagePageSize; ++i) {
+          unsigned index = page*MemoryUsagePageSize + i;
+          if (index < classes.size())
+            pages.m_page[page]->m_counters[i].AddTo(classes[index]);
+        }
+      }
+    }
+  }
+
+  ClassList::iterator it = classes.begin();
+  while (it != classes.end()) {
+    if (it->m_allocations == 0)
+      it = classes.erase(it);
+    else
+      ++it;
+  }
+
+  std::sort(classes.begin(), classes.end(), CompareMemoryUsage);
+  return true;
+}
+
+#else // P_MEMORY_ACCOUNTING
+
+bool PMemoryUsage::GetClasses(ClassList &)
+{
+  return false;
+}
+
+#endif // P_MEMORY_ACCOUNTING
+
+#endif // !PMEMORY_CHECK
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -1371,6 +2040,331 @@ istream & istream::operator>>(PUInt64 & v)
 
 ///////////////////////////////////////////////////////////////////////////////
 
+namespace PProfiling
+{
+  class EscapedHTML
+  {
+    private:
+      const std::string m_str;
+
+    public:
+      EscapedHTML(const std::string & str)
+        : m_str(str)
+      {
+      }
+
+    friend ostream & operator<<(ostream & strm, const EscapedHTML & e)
+    {
+      for (size_t i = 0; i < e.m_str.length(); ++i) {
+        switch (e.m_str[i]) {
+          case '"':
+            strm << "&quot;";
+            break;
+          case '<':
+            strm << "&lt;";
+            break;
+          case '>':
+            strm << "&gt;";
+            break;
+          case '&':
+            strm << "&amp;";
+            break;
+          default:
+            strm << e.m_str[i];
+        }
+      }
+      return strm;
+    }
+  };
+
+  struct Histogram::Shard
+  {
+    atomic<unsigned> m_buckets[BucketCount];
+    atomic<uint64_t> m_sum;
+    atomic<uint64_t> m_minimum;
+    atomic<uint64_t> m_maximum;
+    char             m_padding[64]; // Keep next shard off our cache line
+  };
+
+
+  /* Each thread is given the next shard in turn the first time it records,
+     so up to ShardCount threads never touch each others counters. */
+  static unsigned GetShardIndex()
+  {
+#ifdef P_THREAD_LOCAL
+    static atomic<unsigned> s_nextShard(0);
+    static P_THREAD_LOCAL unsigned s_shard; // Index plus one, zero is unassigned
+    if (s_shard == 0)
+      s_shard = s_nextShard++ % Histogram::ShardCount + 1;
+    return s_shard - 1;
+#else
+    return (unsigned)(((size_t)PThread::GetCurrentThreadId() >> 4) % Histogram::ShardCount);
+#endif
+  }
+
+
+  Histogram::Histogram(const std::string & name)
+    : m_name(name)
+    , m_shards(new Shard[ShardCount])
+  {
+    Reset();
+  }
+
+
+  Histogram::~Histogram()
+  {
+    delete [] m_shards;
+  }
+
+
+  unsigned Histogram::GetBucket(uint64_t value)
+  {
+    if (value >= (1ULL << MaxValueBits))
+      return BucketCount - 1;
+
+    // Number of bits below the linear sub-bucket range
+    unsigned shift = 0;
+    while ((value >> shift) >= 2*SubBucketCount)
+      ++shift;
+
+    return shift*SubBucketCount + (unsigned)(value >> shift);
+  }
+
+
+  uint64_t Histogram::GetBucketLimit(unsigned bucket)
+  {
+    if (bucket < 2*SubBucketCount)
+      return bucket;
+
+    unsigned shift = bucket/SubBucketCount - 1;
+    uint64_t subBucket = bucket - shift*SubBucketCount;
+    return ((subBucket+1) << shift) - 1;
+  }
+
+
+  void Histogram::Record(uint64_t value)
+  {
+    Shard & shard = m_shards[GetShardIndex()];
+
+    ++shard.m_buckets[GetBucket(value)];
+    shard.m_sum += value;
+
+    uint64_t current = shard.m_minimum.load();
+    while (value < current && !shard.m_minimum.compare_exchange_strong(current, value))
+      ;
+
+    current = shard.m_maximum.load();
+    while (value > current && !shard.m_maximum.compare_exchange_strong(current, value))
+      ;
+  }
+
+
+  void Histogram::Record(const PTimeInterval & interval)
+  {
+    PInt64 value = interval.GetMicroSeconds();
+    Record(value > 0 ? (uint64_t)value : 0);
+  }
+
+
+  uint64_t Histogram::GetTime()
+  {
+#if defined(_WIN32)
+    static LARGE_INTEGER frequency;
+    if (frequency.QuadPart == 0)
+      QueryPerformanceFrequency(&frequency);
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return now.QuadPart/frequency.QuadPart*1000000 + now.QuadPart%frequency.QuadPart*1000000/frequency.QuadPart;
+#elif defined(CLOCK_MONOTONIC)
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec*1000000ULL + ts.tv_nsec/1000;
+#else
+    timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec*1000000ULL + tv.tv_usec;
+#endif
+  }
+
+
+  Histogram::Snapshot::Snapshot()
+    : m_count(0)
+    , m_sum(0)
+    , m_minimum(0)
+    , m_maximum(0)
+    , m_buckets(BucketCount)
+  {
+  }
+
+
+  uint64_t Histogram::Snapshot::GetPercentile(double percentile) const
+  {
+    if (m_count == 0)
+      return 0;
+
+    // Rank of the value, rounded up
+    double rank = m_count*percentile/100;
+    uint64_t target = (uint64_t)rank;
+    if (target < rank || target < 1)
+      ++target;
+
+    uint64_t total = 0;
+    for (unsigned bucket = 0; bucket < m_buckets.size(); ++bucket) {
+      total += m_buckets[bucket];
+      if (total >= target)
+        return std::min(GetBucketLimit(bucket), m_maximum);
+    }
+
+    return m_maximum;
+  }
+
+
+  void Histogram::GetSnapshot(Snapshot & snapshot) const
+  {
+    snapshot = Snapshot();
+    snapshot.m_minimum = std::numeric_limits<uint64_t>::max();
+
+    for (unsigned i = 0; i < ShardCount; ++i) {
+      const Shard & shard = m_shards[i];
+      for (unsigned bucket = 0; bucket < BucketCount; ++bucket) {
+        unsigned count = shard.m_buckets[bucket].load();
+        snapshot.m_buckets[bucket] += count;
+        snapshot.m_count += count;
+      }
+      snapshot.m_sum += shard.m_sum.load();
+      snapshot.m_minimum = std::min(snapshot.m_minimum, (uint64_t)shard.m_minimum.load());
+      snapshot.m_maximum = std::max(snapshot.m_maximum, (uint64_t)shard.m_maximum.load());
+    }
+
+    if (snapshot.m_count == 0)
+      snapshot.m_minimum = 0;
+  }
+
+
+  void Histogram::Reset()
+  {
+    for (unsigned i = 0; i < ShardCount; ++i) {
+      Shard & shard = m_shards[i];
+      for (unsigned bucket = 0; bucket < BucketCount; ++bucket)
+        shard.m_buckets[bucket].store(0);
+      shard.m_sum.store(0);
+      shard.m_minimum.store(std::numeric_limits<uint64_t>::max());
+      shard.m_maximum.store(0);
+    }
+  }
+
+
+  struct HistogramRegistry : std::map<std::string, Histogram *>
+  {
+    ~HistogramRegistry()
+    {
+      for (iterator it = begin(); it != end(); ++it)
+        delete it->second;
+    }
+
+    static HistogramRegistry & Get()
+    {
+      static HistogramRegistry s_registry;
+      return s_registry;
+    }
+
+    Histogram & GetHistogram(const std::string & name)
+    {
+      PWaitAndSignal lock(m_mutex);
+      iterator it = find(name);
+      if (it == end())
+        it = insert(value_type(name, new Histogram(name))).first;
+      return *it->second;
+    }
+
+    PCriticalSection m_mutex;
+  };
+
+
+  Histogram & GetHistogram(const std::string & name)
+  {
+    return HistogramRegistry::Get().GetHistogram(name);
+  }
+
+
+  void DumpHistograms(ostream & strm, bool html)
+  {
+    static const double Percentiles[] = { 50, 90, 99, 99.9 };
+    static const char * const PercentileNames[] = { "p50", "p90", "p99", "p99.9" };
+
+    HistogramRegistry & registry = HistogramRegistry::Get();
+    PWaitAndSignal lock(registry.m_mutex);
+
+    std::streamsize nameWidth = 0;
+    for (HistogramRegistry::iterator it = registry.begin(); it != registry.end(); ++it) {
+      std::streamsize len = it->first.length();
+      if (len > nameWidth)
+        nameWidth = len;
+    }
+    nameWidth += 2;
+
+    if (html) {
+      strm << "<H2>Latency histograms (microseconds)</H2>"
+              "<table border=1 cellspacing=0 cellpadding=8>"
+              "<tr><th align=left>Name<th>Count<th>Minimum";
+      for (PINDEX i = 0; i < PARRAYSIZE(Percentiles); ++i)
+        strm << "<th>" << PercentileNames[i];
+      strm << "<th>Maximum<th>Mean";
+    }
+    else
+      strm << "Latency histograms (microseconds):";
+
+    for (HistogramRegistry::iterator it = registry.begin(); it != registry.end(); ++it) {
+      Histogram::Snapshot snapshot;
+      it->second->GetSnapshot(snapshot);
+
+      if (html) {
+        strm << "<tr><td>" << EscapedHTML(it->first)
+             << "<td align=right>" << snapshot.m_count
+             << "<td align=right>" << snapshot.m_minimum;
+        for (PINDEX i = 0; i < PARRAYSIZE(Percentiles); ++i)
+          strm << "<td align=right>" << snapshot.GetPercentile(Percentiles[i]);
+        strm << "<td align=right>" << snapshot.m_maximum
+             << "<td align=right>" << snapshot.GetMean();
+      }
+      else {
+        strm << "\n   " << left << setw(nameWidth) << it->first << right
+             << " count=" << setw(10) << snapshot.m_count
+             << " min=" << setw(8) << snapshot.m_minimum;
+        for (PINDEX i = 0; i < PARRAYSIZE(Percentiles); ++i)
+          strm << ' ' << PercentileNames[i] << '=' << setw(8) << snapshot.GetPercentile(Percentiles[i]);
+        strm << " max=" << setw(10) << snapshot.m_maximum
+             << " mean=" << setw(8) << snapshot.GetMean();
+      }
+    }
+
+    if (html)
+      strm << "</table>";
+  }
+
+
+  void TraceHistograms(unsigned PTRACE_PARAM(level))
+  {
+#if PTRACING
+    if (PTrace::CanTrace(level)) {
+      ostream & trace = PTRACE_BEGIN(level, "Profile");
+      DumpHistograms(trace, false);
+      trace << PTrace::End;
+    }
+#endif
+  }
+
+
+  void ResetHistograms()
+  {
+    HistogramRegistry & registry = HistogramRegistry::Get();
+    PWaitAndSignal lock(registry.m_mutex);
+    for (HistogramRegistry::iterator it = registry.begin(); it != registry.end(); ++it)
+      it->second->Reset();
+  }
+};
+
+
 #if P_PROFILING
 // Currently only supported in GNU && *nix
 
@@ -1839,42 +2833,6 @@ namespace PProfiling
   }
 
 
-  class EscapedHTML
-  {
-    private:
-      const std::string m_str;
-
-    public:
-      EscapedHTML(const std::string & str)
-        : m_str(str)
-      {
-      }
-
-    friend ostream & operator<<(ostream & strm, const EscapedHTML & e)
-    {
-      for (size_t i = 0; i < e.m_str.length(); ++i) {
-        switch (e.m_str[i]) {
-          case '"':
-            strm << "&quot;";
-            break;
-          case '<':
-            strm << "&lt;";
-            break;
-          case '>':
-            strm << "&gt;";
-            break;
-          case '&':
-            strm << "&amp;";
-            break;
-          default:
-            strm << e.m_str[i];
-        }
-      }
-      return strm;
-    }
-  };
-
-
   void Analysis::ToHTML(ostream & strm) const
   {
     strm << "<H2>Summary profile</H2>"
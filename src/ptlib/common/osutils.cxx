@@ -107,6 +107,15 @@ class PSimpleThread : public PThread
 #define new PNEW
 
 
+#ifdef P_THREAD_LOCAL
+/* Fast path for PThread::Current(), so it does not need the process wide
+   thread mutex. Only threads created by PTLib, and the process itself, are
+   cached. External threads can be deleted by the house keeping thread at
+   any time, so they always use the slow path. */
+static P_THREAD_LOCAL PThread * s_currentThread;
+#endif
+
+
 #ifndef __NUCLEUS_PLUS__
 static ostream * PErrorStream = &cerr;
 #else
@@ -134,10 +143,13 @@ void PSetErrorStream(ostream * s)
 
 unsigned PTrace::MaxStackWalk = 32;
 
+unsigned GetRotateVal(long nOffset, unsigned options);
+
 class PTraceInfo : public PTrace
 {
-  /* NOTE you cannot have any complex types in this structure. Anything
-     that might do an asert or PTRACE will crash due to recursion.
+  /* NOTE nothing in this structure may do an assert or PTRACE, that will
+     crash due to recursion. Members used on the asynchronous path, where
+     no lock is taken, are atomic or thread local.
    */
 
 public:
@@ -149,10 +161,29 @@ public:
   PTimeInterval   m_startTick;
   PString         m_rolloverPattern;
   unsigned        m_lastRotate;
-  ios::fmtflags   m_oldStreamFlags;
+  ios::fmtflags   m_oldStreamFlags; // Protected by Lock(), thread local streams use ThreadLocalInfo
   std::streamsize m_oldPrecision;
   long			  m_offset;
 
+  // Asynchronous output, a bounded multi-producer queue of completed lines
+  struct AsyncLine {
+    atomic<unsigned> m_sequence;
+    PStringStream  * m_text;
+    unsigned         m_level;
+  };
+  AsyncLine       * m_asyncQueue;
+  unsigned          m_asyncQueueSize;
+  atomic<unsigned>  m_asyncEnqueuePos;
+  unsigned          m_asyncDequeuePos; // Protected by Lock()
+  bool              m_asyncBlockWhenFull;
+  atomic<bool>      m_asyncRunning;
+  atomic<bool>      m_asyncWaiting;
+  atomic<unsigned>  m_asyncDropped;
+  bool              m_asyncStarting;
+  bool              m_asyncShutdown;
+  PThread         * m_asyncWriter;
+  PSyncPoint      * m_asyncSignal;
+
 
 #if defined(_WIN32)
   CRITICAL_SECTION mutex;
@@ -190,12 +221,16 @@ PTHREAD_MUTEX_RECURSIVE_NP
       : m_traceLevel(1)
       , m_traceBlockIndentLevel(0)
       , m_prefixLength(0)
+      , m_oldStreamFlags(ios::left)
+      , m_oldPrecision(0)
     { }
 
     PStack<PStringStream> m_traceStreams;
     unsigned              m_traceLevel;
     unsigned              m_traceBlockIndentLevel;
     PINDEX                m_prefixLength;
+    ios::fmtflags         m_oldStreamFlags;
+    std::streamsize       m_oldPrecision;
   };
   PThreadLocalStorage<ThreadLocalInfo> m_threadStorage;
 
@@ -214,7 +249,19 @@ PTHREAD_MUTEX_RECURSIVE_NP
     , m_oldStreamFlags(ios::left)
     , m_oldPrecision(0)
 	, m_offset(0)
+    , m_asyncQueue(NULL)
+    , m_asyncQueueSize(1024)
+    , m_asyncDequeuePos(0)
+    , m_asyncBlockWhenFull(false)
+    , m_asyncStarting(false)
+    , m_asyncShutdown(false)
+    , m_asyncWriter(NULL)
+    , m_asyncSignal(NULL)
   {
+    m_asyncEnqueuePos.store(0);
+    m_asyncRunning.store(false);
+    m_asyncWaiting.store(false);
+    m_asyncDropped.store(0);
     InitMutex();
   }
 
@@ -247,6 +294,10 @@ PTHREAD_MUTEX_RECURSIVE_NP
 
   ~PTraceInfo()
   {
+    StopAsyncWriter(true);
+    delete [] m_asyncQueue;
+    delete m_asyncSignal;
+
     if (m_stream != &cerr && m_stream != &cout)
       delete m_stream;
   }
@@ -284,6 +335,10 @@ PTHREAD_MUTEX_RECURSIVE_NP
     if ((m_options & HasFilePermissions) == 0)
       m_options |= HasFilePermissions | (PFileInfo::DefaultPerms << FilePermissionShift);
 
+    // Writer thread is started on first trace output
+    if ((oldOptions & AsynchronousOutput) != 0 && (m_options & AsynchronousOutput) == 0)
+      StopAsyncWriter(false);
+
 #if P_SYSTEMLOG
     bool syslogBit = (m_options&SystemLogStream) != 0;
     bool syslogStrm = dynamic_cast<PSystemLog *>(m_stream) != NULL;
@@ -299,6 +354,54 @@ PTHREAD_MUTEX_RECURSIVE_NP
 
   bool HasOption(unsigned options) const { return (m_options & options) != 0; }
 
+  bool CheckRotate()
+  {
+    if (m_filename.IsEmpty() || !HasOption(RotateLogMask))
+      return false;
+
+    unsigned rotateVal = GetRotateVal(m_offset, m_options);
+    if (rotateVal == m_lastRotate && m_stream != &cerr)
+      return false;
+
+    m_lastRotate = rotateVal;
+    OpenTraceFile(m_filename, true);
+    return true;
+  }
+
+  void OutputLine(const PString & text, unsigned level)
+  {
+    *m_stream << text;
+
+    if (HasOption(SystemLogStream)) {
+      // Get the trace level for this message and set the stream width to that
+      // level so that the PSystemLog can extract the log level back out of the
+      // ios structure. There could be portability issues with this though it
+      // should work pretty universally.
+      m_stream->width(level + 1);
+      m_stream->flush();
+    }
+    else
+      *m_stream << '\n';
+  }
+
+  void FlushStream()
+  {
+    // System log has already flushed each line in OutputLine()
+    if (!HasOption(SystemLogStream))
+      m_stream->flush();
+  }
+
+  bool IsAsyncQueueEmpty() const
+  {
+    return m_asyncQueue[m_asyncDequeuePos & (m_asyncQueueSize-1)].m_sequence.load() != m_asyncDequeuePos + 1;
+  }
+
+  void StartAsyncWriter();
+  void StopAsyncWriter(bool shutdown);
+  void EnqueueAsync(PStringStream * text, unsigned level);
+  unsigned WriteAsyncQueue(unsigned maxLines);
+  void AsyncWriterMain();
+
   void OpenTraceFile(const char * newFilename, bool outputFirstLog)
   {
     PMEMORY_IGNORE_ALLOCATIONS_FOR_SCOPE;
@@ -519,6 +622,8 @@ ostream & PTrace::PrintInfo(ostream & strm, bool crlf)
     strm << " object";
   if (info.m_options&ContextIdentifier)
     strm << " context";
+  if (info.m_options&AsynchronousOutput)
+    strm << " async";
 
   switch (info.m_options&RotateLogMask) {
     case RotateDaily :
@@ -613,6 +718,8 @@ void PTrace::Initialise(const PArgList & args,
         operation(options, RotateMinutely);
       else if (optStr.NumCompare("append", P_MAX_INDEX, pos) == PObject::EqualTo)
         operation(options, AppendToFile);
+      else if (optStr.NumCompare("async", P_MAX_INDEX, pos) == PObject::EqualTo)
+        operation(options, AsynchronousOutput);
       else if (optStr.NumCompare("ax", P_MAX_INDEX, pos) == PObject::EqualTo)
         operation(options, (PFileInfo::WorldExecute|PFileInfo::GroupExecute|PFileInfo::UserExecute) << FilePermissionShift);
       else if (optStr.NumCompare("aw", P_MAX_INDEX, pos) == PObject::EqualTo)
@@ -724,6 +831,23 @@ unsigned PTrace::GetLevel()
 }
 
 
+void PTrace::SetAsynchronousQueue(unsigned size, bool blockWhenFull)
+{
+  PTraceInfo & info = PTraceInfo::Instance();
+  info.Lock();
+  if (info.m_asyncQueue == NULL)
+    info.m_asyncQueueSize = PMAX(size, 2U);
+  info.m_asyncBlockWhenFull = blockWhenFull;
+  info.Unlock();
+}
+
+
+unsigned PTrace::GetAsynchronousDropped()
+{
+  return PTraceInfo::Instance().m_asyncDropped.load();
+}
+
+
 PBoolean PTrace::CanTrace(unsigned level)
 {
   return PProcess::IsInitialised() && level <= GetLevel();
@@ -741,6 +865,7 @@ ostream & PTraceInfo::InternalBegin(bool topLevel, unsigned level, const char *
   PThread * thread = NULL;
   PTraceInfo::ThreadLocalInfo * threadInfo = NULL;
   ostream * streamPtr = m_stream;
+  bool locked = false;
 
   if (topLevel) {
     if (PProcess::IsInitialised()) {
@@ -754,16 +879,12 @@ ostream & PTraceInfo::InternalBegin(bool topLevel, unsigned level, const char *
       }
     }
 
-    Lock();
-
-    if (!m_filename.IsEmpty() && HasOption(RotateLogMask)) {
-      unsigned rotateVal = GetRotateVal(m_offset, m_options);
-      if (rotateVal != m_lastRotate || GetStream() == &cerr) {
-        m_lastRotate = rotateVal;
-        OpenTraceFile(m_filename, true);
-        if (threadInfo == NULL)
-          streamPtr = m_stream;
-      }
+    // When asynchronous, the writer thread does rotation and a thread local stream needs no lock
+    if (threadInfo == NULL || !m_asyncRunning.load()) {
+      Lock();
+      locked = true;
+      if (CheckRotate() && threadInfo == NULL)
+        streamPtr = m_stream;
     }
   }
 
@@ -772,8 +893,14 @@ ostream & PTraceInfo::InternalBegin(bool topLevel, unsigned level, const char *
   // Before we do new trace, make sure we clear any errors on the stream
   stream.clear();
 
-  m_oldStreamFlags = stream.flags();
-  m_oldPrecision   = stream.precision();
+  if (threadInfo == NULL) {
+    m_oldStreamFlags = stream.flags();
+    m_oldPrecision   = stream.precision();
+  }
+  else {
+    threadInfo->m_oldStreamFlags = stream.flags();
+    threadInfo->m_oldPrecision   = stream.precision();
+  }
 
   if (!HasOption(SystemLogStream)) {
     if (HasOption(DateAndTime)) {
@@ -861,7 +988,8 @@ ostream & PTraceInfo::InternalBegin(bool topLevel, unsigned level, const char *
   else {
     threadInfo->m_traceLevel = level;
     threadInfo->m_prefixLength = threadInfo->m_traceStreams.Top().GetLength();
-    Unlock();
+    if (locked)
+      Unlock();
   }
 
   return stream;
@@ -878,12 +1006,9 @@ ostream & PTraceInfo::InternalEnd(ostream & paramStream)
 {
   PTraceInfo::ThreadLocalInfo * threadInfo = PProcess::IsInitialised() ? m_threadStorage.Get() : NULL;
 
-  paramStream.flags(m_oldStreamFlags);
-  paramStream.precision(m_oldPrecision);
-
-  unsigned currentLevel;
-
   if (threadInfo != NULL && !threadInfo->m_traceStreams.IsEmpty()) {
+    paramStream.flags(threadInfo->m_oldStreamFlags);
+    paramStream.precision(threadInfo->m_oldPrecision);
     PStringStream * stackStream = threadInfo->m_traceStreams.Pop();
     if (!PAssert(&paramStream == stackStream, PLogicError))
       return paramStream;
@@ -894,38 +1019,181 @@ ostream & PTraceInfo::InternalEnd(ostream & paramStream)
       if (len < 8)
         stackStream->Splice("      ", tab, 0);
     }
+
+    if (HasOption(AsynchronousOutput) && !m_asyncRunning.load())
+      StartAsyncWriter();
+
+    if (m_asyncRunning.load()) {
+      EnqueueAsync(stackStream, threadInfo->m_traceLevel);
+      return paramStream;
+    }
+
     Lock();
-    *m_stream << *stackStream;
+    WriteAsyncQueue(UINT_MAX); // Anything left over from asynchronous mode, keeps order
+    OutputLine(*stackStream, threadInfo->m_traceLevel);
     delete stackStream;
-
-    currentLevel = threadInfo->m_traceLevel;
   }
   else {
+    // Inherit lock from PTrace::Begin()
+    paramStream.flags(m_oldStreamFlags);
+    paramStream.precision(m_oldPrecision);
+
     if (!PAssert(&paramStream == m_stream, PLogicError)) {
       Unlock();
       return paramStream;
     }
 
-    currentLevel = m_currentLevel;
-    // Inherit lock from PTrace::Begin()
+    OutputLine(PString::Empty(), m_currentLevel);
   }
 
-  if (HasOption(SystemLogStream)) {
-    // Get the trace level for this message and set the stream width to that
-    // level so that the PSystemLog can extract the log level back out of the
-    // ios structure. There could be portability issues with this though it
-    // should work pretty universally.
-    m_stream->width(currentLevel + 1);
-  }
-  else
-    *m_stream << '\n';
-  m_stream->flush();
+  FlushStream();
 
   Unlock();
   return paramStream;
 }
 
 
+void PTraceInfo::StartAsyncWriter()
+{
+  Lock();
+
+  // Check m_asyncStarting as thread creation may trace, and so get here again
+  if (m_asyncWriter == NULL && !m_asyncStarting && !m_asyncShutdown) {
+    m_asyncStarting = true;
+
+    if (m_asyncQueue == NULL) {
+      unsigned size = 2;
+      while (size < m_asyncQueueSize)
+        size <<= 1;
+      m_asyncQueueSize = size;
+      m_asyncQueue = new AsyncLine[size];
+      for (unsigned i = 0; i < size; ++i)
+        m_asyncQueue[i].m_sequence.store(i);
+      m_asyncSignal = new PSyncPoint;
+    }
+
+    m_asyncRunning.store(true);
+    m_asyncWriter = new PThreadObj<PTraceInfo>(*this, &PTraceInfo::AsyncWriterMain, false, "PTrace Writer");
+
+    m_asyncStarting = false;
+  }
+
+  Unlock();
+}
+
+
+void PTraceInfo::StopAsyncWriter(bool shutdown)
+{
+  Lock();
+  if (shutdown)
+    m_asyncShutdown = true;
+  PThread * writer = m_asyncWriter;
+  m_asyncWriter = NULL;
+  m_asyncRunning.store(false);
+  Unlock();
+
+  if (writer == NULL)
+    return;
+
+  m_asyncSignal->Signal();
+  writer->WaitForTermination();
+  delete writer;
+
+  // Catch anything queued while the writer was stopping
+  Lock();
+  if (WriteAsyncQueue(UINT_MAX) > 0)
+    FlushStream();
+  Unlock();
+}
+
+
+void PTraceInfo::EnqueueAsync(PStringStream * text, unsigned level)
+{
+  unsigned mask = m_asyncQueueSize - 1;
+
+  unsigned pos = m_asyncEnqueuePos.load();
+  for (;;) {
+    AsyncLine & line = m_asyncQueue[pos & mask];
+    int diff = (int)(line.m_sequence.load() - pos);
+    if (diff == 0) {
+      if (m_asyncEnqueuePos.compare_exchange_strong(pos, pos + 1))
+        break;
+    }
+    else if (diff > 0)
+      pos = m_asyncEnqueuePos.load();
+    else if (m_asyncBlockWhenFull && m_asyncRunning.load() && PThread::Current() != m_asyncWriter) {
+      // Full, give writer a chance to catch up
+      m_asyncSignal->Signal();
+      PThread::Yield();
+      pos = m_asyncEnqueuePos.load();
+    }
+    else {
+      ++m_asyncDropped;
+      delete text;
+      return;
+    }
+  }
+
+  AsyncLine & line = m_asyncQueue[pos & mask];
+  line.m_text = text;
+  line.m_level = level;
+  line.m_sequence.store(pos + 1);
+
+  if (m_asyncWaiting.exchange(false))
+    m_asyncSignal->Signal();
+}
+
+
+unsigned PTraceInfo::WriteAsyncQueue(unsigned maxLines)
+{
+  if (m_asyncQueue == NULL)
+    return 0;
+
+  unsigned mask = m_asyncQueueSize - 1;
+  unsigned count = 0;
+
+  // Single consumer, as always called with Lock() held
+  while (count < maxLines) {
+    AsyncLine & line = m_asyncQueue[m_asyncDequeuePos & mask];
+    if (line.m_sequence.load() != m_asyncDequeuePos + 1)
+      break;
+
+    PStringStream * text = line.m_text;
+    unsigned level = line.m_level;
+    line.m_sequence.store(m_asyncDequeuePos + mask + 1);
+    ++m_asyncDequeuePos;
+
+    OutputLine(*text, level);
+    delete text;
+    ++count;
+  }
+
+  return count;
+}
+
+
+void PTraceInfo::AsyncWriterMain()
+{
+  while (m_asyncRunning.load()) {
+    Lock();
+    CheckRotate();
+    // Limit the batch so synchronous output is not held up for too long
+    unsigned count = WriteAsyncQueue(1000);
+    if (count > 0)
+      FlushStream();
+    Unlock();
+
+    if (count == 0) {
+      // Producers signal when they see this flag, so check again after setting it
+      m_asyncWaiting.store(true);
+      if (IsAsyncQueueEmpty())
+        m_asyncSignal->Wait(100);
+      m_asyncWaiting.store(false);
+    }
+  }
+}
+
+
 PTrace::Block::Block(const char * fileName, int lineNum, const char * traceName)
   : file(fileName)
   , line(lineNum)
@@ -1060,6 +1328,14 @@ void PDirectory::CloneContents(const PDirectory * d)
 }
 
 
+#if P_HAS_MOVE_SEMANTICS
+void PDirectory::ResetContents()
+{
+  // CopyContents() does not share anything, the source keeps its own
+}
+#endif
+
+
 bool PDirectory::Create(const PString & p, int perm, bool recurse)
 {
   PAssert(!p.IsEmpty(), "attempt to create dir with empty name");
@@ -1275,8 +1551,7 @@ void PTimer::InternalStart(bool once, int64_t resetTime)
   if (resetTime > 0) {
     m_absoluteTime = Tick() + GetResetTime();
     list->m_timersMutex.Wait();
-    list->m_timers[m_handle] = this;
-    m_running = true;
+    list->InternalAdd(*this);
     list->m_timersMutex.Signal();
 
     PProcess::Current().SignalTimerChange();
@@ -1295,8 +1570,7 @@ void PTimer::Stop(bool wait)
     /* Take out of timer list first, so when callback is waited for it's
        completion it cannot then be called again. */
     list->m_timersMutex.Wait();
-    PAssert(list->m_timers.erase(m_handle) == 1 || !m_running, PLogicError);
-    m_running = false;
+    PAssert(list->InternalRemove(*this) || !m_running, PLogicError);
     list->m_timersMutex.Signal();
 
     if (wait) {
@@ -1340,6 +1614,9 @@ void PTimer::OnTimeout()
 
 PTimer::List::List()
   : m_threadPool(10, 0, "OnTimeout")
+#if PTRACING
+  , m_highWaterMark(0)
+#endif
 {
 }
 
@@ -1357,6 +1634,35 @@ void PTimer::List::Timeout::Work()
   }
 }
 
+// called with m_timersMutex locked
+void PTimer::List::InternalAdd(PTimer & timer)
+{
+  m_timers[timer.m_handle] = &timer;
+  m_expiries.insert(ExpiryKey(timer.m_absoluteTime, timer.m_handle));
+  timer.m_running = true;
+
+#if PTRACING
+  if (m_timers.size() > m_highWaterMark) {
+    m_highWaterMark = m_timers.size();
+    if (m_highWaterMark % 10000 == 0) {
+      PTRACE(3, NULL, PTraceModule(), "Timer high water mark: " << m_highWaterMark);
+    }
+  }
+#endif
+}
+
+
+// called with m_timersMutex locked
+bool PTimer::List::InternalRemove(PTimer & timer)
+{
+  if (timer.m_running) {
+    m_expiries.erase(ExpiryKey(timer.m_absoluteTime, timer.m_handle));
+    timer.m_running = false;
+  }
+  return m_timers.erase(timer.m_handle) == 1;
+}
+
+
 bool PTimer::List::OnTimeout(PIdGenerator::Handle handle)
 {
   PTimer * timer = NULL;
@@ -1382,7 +1688,10 @@ bool PTimer::List::OnTimeout(PIdGenerator::Handle handle)
   }
 
   // Must be outside of m_timersMutex and timer->m_timerMutex mutexes
-  timer->OnTimeout();
+  {
+    PPROFILE_HISTOGRAM("PTimer callback");
+    timer->OnTimeout();
+  }
   timer->m_callbackMutex.Signal();
   return true; // Done
 }
@@ -1397,31 +1706,45 @@ PTimeInterval PTimer::List::Process()
 
   m_timersMutex.Wait();
 
-  for (TimerMap::iterator it = m_timers.begin(); it != m_timers.end(); ++it) {
-    PTimer & timer = *it->second;
-    if (timer.m_running) {
-      PTimeInterval delta = timer.m_absoluteTime - now;
-      if (delta > 0) {
-        if (nextInterval > delta)
-          nextInterval = delta;
-      }
-      else if (timer.m_callbackMutex.Try()) {
-        /* PTimer is stopped and completely removed from the list before it's
-           properties are changed from the external code, making this thread
-           safe without a mutex. */
-        if (timer.m_oneshot)
-          timer.m_running = false;
-        else {
-          timer.m_absoluteTime = now + timer.GetResetTime();
-          if (nextInterval > timer.GetResetTime())
-            nextInterval = timer.GetResetTime();
-        }
-        timer.m_callbackMutex.Signal();
+  /* Only the expired timers at the front of the ordered set are visited. Any
+     whose callback is still running are left in place and retried next time. */
+  ExpirySet::iterator it = m_expiries.begin();
+  while (it != m_expiries.end() && it->first <= now) {
+    PIdGenerator::Handle handle = it->second;
+    TimerMap::iterator timerIt = m_timers.find(handle);
+    if (!PAssert(timerIt != m_timers.end(), PLogicError)) {
+      m_expiries.erase(it++);
+      continue;
+    }
 
-        m_threadPool.AddWork(new Timeout(it->first));
-        PTRACE(6, &timer, "Timer: " << timer << " work added, lateness=" << -delta);
-      }
+    PTimer & timer = *timerIt->second;
+    if (!timer.m_callbackMutex.Try()) {
+      ++it;
+      continue;
+    }
+
+    /* PTimer is stopped and completely removed from the list before it's
+       properties are changed from the external code, making this thread
+       safe without a mutex. */
+    PTRACE_PARAM(PTimeInterval lateness = now - timer.m_absoluteTime);
+    m_expiries.erase(it++);
+    if (timer.m_oneshot)
+      timer.m_running = false;
+    else {
+      // Reset time is always positive, so re-insertion is after "now" and not revisited
+      timer.m_absoluteTime = now + timer.GetResetTime();
+      m_expiries.insert(ExpiryKey(timer.m_absoluteTime, handle));
     }
+    timer.m_callbackMutex.Signal();
+
+    m_threadPool.AddWork(new Timeout(handle));
+    PTRACE(6, &timer, "Timer: " << timer << " work added, lateness=" << lateness);
+  }
+
+  if (it != m_expiries.end()) {
+    PTimeInterval delta = it->first - now;
+    if (nextInterval > delta)
+      nextInterval = delta;
   }
 
   m_timersMutex.Signal();
@@ -1429,7 +1752,7 @@ PTimeInterval PTimer::List::Process()
   if (nextInterval < 10)
     nextInterval = 10;
 
-  PTRACE(6, NULL, PTraceModule(), m_timers.size() << " timers processed, next=" << nextInterval);
+  PTRACE(6, NULL, PTraceModule(), m_timers.size() << " timers, next=" << nextInterval);
   return nextInterval;
 }
 
@@ -2291,6 +2614,11 @@ void PProcess::PreShutdown()
 
   m_shuttingDown = true;
 
+#if PTRACING
+  // Flush and stop any asynchronous trace output, before threads get terminated
+  PTraceInfo::Instance().StopAsyncWriter(true);
+#endif
+
   // Get rid of the house keeper (majordomocide)
   if (m_houseKeeper != NULL && m_houseKeeper->GetThreadId() != PThread::GetCurrentThreadId()) {
     PTRACE(4, "Terminating housekeeper thread.");
@@ -2565,6 +2893,12 @@ void PProcess::InternalThreadEnded(PThread * thread)
   if (it != m_activeThreads.end() && it->second == thread)
     m_activeThreads.erase(it); // Not already gone, or re-used the thread ID for new thread.
 
+#ifdef P_THREAD_LOCAL
+  // Usually called in the context of the ending thread, so clear its cache
+  if (s_currentThread == thread)
+    s_currentThread = NULL;
+#endif
+
   // All of this is carefully constructed to avoid race condition deleting "thread"
   if (thread->IsAutoDelete()) {
     thread->SetNoAutoDelete();
@@ -2615,12 +2949,22 @@ PThread * PThread::Current()
   if (!PProcess::IsInitialised())
     return NULL;
 
+#ifdef P_THREAD_LOCAL
+  if (s_currentThread != NULL)
+    return s_currentThread;
+#endif
+
   PProcess & process = PProcess::Current();
 
   PWaitAndSignal mutex(process.m_threadMutex);
   PProcess::ThreadMap::iterator it = process.m_activeThreads.find(GetCurrentThreadId());
-  if (it != process.m_activeThreads.end() && !it->second->IsTerminated())
+  if (it != process.m_activeThreads.end() && !it->second->IsTerminated()) {
+#ifdef P_THREAD_LOCAL
+    if (it->second->m_type != e_IsExternal)
+      s_currentThread = it->second;
+#endif
     return it->second;
+  }
 
   if (process.m_shuttingDown)
     return NULL;
@@ -177,7 +177,7 @@ PObject::Comparison PChannel::Compare(const PObject & obj) const
 
 PINDEX PChannel::HashFunction() const
 {
-  return GetHandle()%97;
+  return GetHandle();
 }
 
 
@@ -928,6 +928,14 @@ PChannel * PIndirectChannel::GetBaseWriteChannel() const
 }
 
 
+bool PIndirectChannel::HasBufferedData() const
+{
+  PReadWaitAndSignal mutex(channelPointerMutex);
+  const PIndirectChannel * indirect = dynamic_cast<const PIndirectChannel *>(readChannel);
+  return indirect != NULL && indirect->HasBufferedData();
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // PFile
 
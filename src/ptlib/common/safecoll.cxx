@@ -43,8 +43,7 @@
 /////////////////////////////////////////////////////////////////////////////
 
 PSafeObject::PSafeObject(PSafeObject * indirectLock)
-  : m_safeReferenceCount(0)
-  , m_safelyBeingRemoved(false)
+  : m_safeState(0)
   , m_safeInUse(indirectLock != NULL ? indirectLock->m_safeInUse : &m_safeInUseMutex)
 {
 }
@@ -52,14 +51,12 @@ PSafeObject::PSafeObject(PSafeObject * indirectLock)
 
 PBoolean PSafeObject::SafeReference()
 {
-#if PTRACING
-  unsigned count = 0;
-  {
-    PWaitAndSignal mutex(m_safetyMutex);
-    if (!m_safelyBeingRemoved)
-      count = ++m_safeReferenceCount;
-  }
+  uint32_t state = m_safeState.load();
+  while ((state & SafeRemovedFlag) == 0 && !m_safeState.compare_exchange_strong(state, state+1))
+    ;
 
+#if PTRACING
+  unsigned count = (state & SafeRemovedFlag) != 0 ? 0 : (state+1);
   unsigned level = count == 0  || m_traceContextIdentifier == 1234567890 ? 3 : 7;
   if (PTrace::CanTrace(level)) {
     ostream & trace = PTRACE_BEGIN(level);
@@ -73,56 +70,41 @@ PBoolean PSafeObject::SafeReference()
     }
     trace << PTrace::End;
   }
-  return count > 0;
-#else
-  PWaitAndSignal mutex(m_safetyMutex);
-  if (m_safelyBeingRemoved)
-    return false;
-  ++m_safeReferenceCount;
-  return true;
 #endif
+
+  return (state & SafeRemovedFlag) == 0;
 }
 
 
 PBoolean PSafeObject::SafeDereference()
 {
-  PBoolean mayBeDeleted = false;
-#if PTRACING
-  unsigned tracedReferenceCount;
-#endif
-
-  m_safetyMutex.Wait();
-  if (PAssert(m_safeReferenceCount > 0, PLogicError)) {
-    m_safeReferenceCount--;
-    mayBeDeleted = m_safeReferenceCount == 0 && !m_safelyBeingRemoved;
-  }
-#if PTRACING
-  tracedReferenceCount = m_safeReferenceCount;
-#endif
-  m_safetyMutex.Signal();
+  uint32_t state = m_safeState.load();
+  do {
+    if (!PAssert((state & ~SafeRemovedFlag) > 0, PLogicError))
+      return false;
+  } while (!m_safeState.compare_exchange_strong(state, state-1));
 
   PTRACE(m_traceContextIdentifier == 1234567890 ? 3 : 7,
-         GetClass() << ' ' << (void *)this << " decremented reference count to " << tracedReferenceCount);
+         GetClass() << ' ' << (void *)this << " decremented reference count to " << ((state-1) & ~SafeRemovedFlag));
 
-  return mayBeDeleted;
+  // Count reached zero and SafeRemove() was not called
+  return state == 1;
 }
 
 
 PBoolean PSafeObject::LockReadOnly() const
 {
   PTRACE(m_traceContextIdentifier == 1234567890 ? 3 : 7, "Waiting read ("<<(void *)this<<")");
-  m_safetyMutex.Wait();
-
-  if (m_safelyBeingRemoved) {
-    m_safetyMutex.Signal();
+  if (IsSafelyBeingRemoved()) {
     PTRACE(6, "Being removed while waiting read ("<<(void *)this<<")");
     return false;
   }
 
-  if (m_safeInUse->m_fileOrName == NULL)
+  if (m_safeInUse->m_fileOrName == NULL) {
+    PWaitAndSignal mutex(m_safetyMutex);
+    if (m_safeInUse->m_fileOrName == NULL)
       m_safeInUse->m_fileOrName = typeid(*this).name();
-
-  m_safetyMutex.Signal();
+  }
 
   m_safeInUse->StartRead();
   PTRACE(m_traceContextIdentifier == 1234567890 ? 3 : 7, "Locked read ("<<(void *)this<<")");
@@ -140,18 +122,16 @@ void PSafeObject::UnlockReadOnly() const
 PBoolean PSafeObject::LockReadWrite()
 {
   PTRACE(m_traceContextIdentifier == 1234567890 ? 3 : 7, "Waiting readWrite ("<<(void *)this<<")");
-  m_safetyMutex.Wait();
-
-  if (m_safelyBeingRemoved) {
-    m_safetyMutex.Signal();
+  if (IsSafelyBeingRemoved()) {
     PTRACE(6, "Being removed while waiting readWrite ("<<(void *)this<<")");
     return false;
   }
 
-  if (m_safeInUse->m_fileOrName == NULL)
+  if (m_safeInUse->m_fileOrName == NULL) {
+    PWaitAndSignal mutex(m_safetyMutex);
+    if (m_safeInUse->m_fileOrName == NULL)
       m_safeInUse->m_fileOrName = typeid(*this).name();
-
-  m_safetyMutex.Signal();
+  }
 
   m_safeInUse->StartWrite();
   PTRACE(m_traceContextIdentifier == 1234567890 ? 3 : 7, "Locked readWrite ("<<(void *)this<<")");
@@ -168,16 +148,21 @@ void PSafeObject::UnlockReadWrite()
 
 void PSafeObject::SafeRemove()
 {
-  m_safetyMutex.Wait();
-  m_safelyBeingRemoved = true;
-  m_safetyMutex.Signal();
+  InternalSetSafelyBeingRemoved(true);
+}
+
+
+void PSafeObject::InternalSetSafelyBeingRemoved(bool removed)
+{
+  uint32_t state = m_safeState.load();
+  while (!m_safeState.compare_exchange_strong(state, removed ? (state | SafeRemovedFlag) : (state & ~SafeRemovedFlag)))
+    ;
 }
 
 
 PBoolean PSafeObject::SafelyCanBeDeleted() const
 {
-  PWaitAndSignal mutex(m_safetyMutex);
-  return m_safelyBeingRemoved && m_safeReferenceCount == 0;
+  return m_safeState.load() == SafeRemovedFlag;
 }
 
 
@@ -284,7 +269,7 @@ PSafeCollection::~PSafeCollection()
     else {
       // If anything still has a PSafePtr .. "detach" it from the collection so
       // will be deleted whan that PSafePtr finally goes out of scope.
-      i->m_safelyBeingRemoved = false;
+      i->InternalSetSafelyBeingRemoved(false);
     }
   }
 
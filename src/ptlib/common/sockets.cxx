@@ -37,6 +37,10 @@
 
 #include <ctype.h>
 
+#if P_HAS_EPOLL
+  #include <sys/epoll.h>
+#endif
+
 #define PTraceModule() "Socket"
 
 #ifdef P_VXWORKS
@@ -67,6 +71,8 @@ extern "C" void inet_ntoa_b(struct in_addr inetAddress, char *pString);
 
 static int g_defaultIpAddressFamily = PF_INET;  // PF_UNSPEC;   // default to IPV4
 static bool g_suppressCanonicalName = false;
+static PTimeInterval g_nameCacheFoundTimeout(0, 0, 5);
+static PTimeInterval g_nameCacheNotFoundTimeout(0, 30);
 
 static PIPSocket::Address loopback4(127,0,0,1);
 static PIPSocket::Address broadcast4(INADDR_BROADCAST);
@@ -97,6 +103,13 @@ bool PIPSocket::GetSuppressCanonicalName()
 }
 
 
+void PIPSocket::SetNameCacheTimeouts(const PTimeInterval & found, const PTimeInterval & notFound)
+{
+  g_nameCacheFoundTimeout = found;
+  g_nameCacheNotFoundTimeout = notFound;
+}
+
+
 int PIPSocket::GetDefaultIpAddressFamily()
 {
   return g_defaultIpAddressFamily;
@@ -270,11 +283,16 @@ class PIPCacheData : public PObject
     const PIPSocket::Address & GetHostAddress() const { return address; }
     const PStringArray& GetHostAliases() const { return aliases; }
     PBoolean HasAged() const;
+    bool NeedsRefresh() const;
+    void SetRefreshFailed() { refreshFailed = true; }
   private:
+    PTimeInterval GetTimeout() const;
+
     PString            hostname;
     PIPSocket::Address address;
     PStringArray       aliases;
     PTime              birthDate;
+    bool               refreshFailed;
 };
 
 
@@ -287,8 +305,26 @@ class PHostByName : PHostByName_private
     PBoolean GetHostName(const PString & name, PString & hostname);
     PBoolean GetHostAddress(const PString & name, PIPSocket::Address & address);
     PBoolean GetHostAliases(const PString & name, PStringArray & aliases);
+    bool GetHostAddressAsync(const PString & name, const PIPSocket::HostAddressNotifier & notifier);
   private:
     PIPCacheData * GetHost(const PString & name);
+    bool MakeKey(const PString & name, PString & key) const;
+
+    // A DNS query in progress, shared by all threads wanting the same name
+    struct Lookup
+    {
+      Lookup() : m_waiters(0) { }
+      PSyncPoint     m_done;
+      unsigned       m_waiters;
+      std::vector<PIPSocket::HostAddressNotifier> m_notifiers;
+    };
+    typedef std::map<PString, Lookup *> LookupMap;
+    LookupMap m_lookups;
+
+    Lookup * StartLookup(const PString & name, const PString & key, bool background);
+    PIPCacheData * CompleteLookup(const PString & name, const PString & key);
+    void BackgroundLookup(PString name);
+
     PMutex mutex;
   friend void PIPSocket::ClearNameCache();
 };
@@ -312,7 +348,7 @@ class PIPCacheKey : public PObject
       { return new PIPCacheKey(*this); }
 
     PINDEX HashFunction() const
-      { return (addr[1] + addr[2] + addr[3])%41; }
+      { return (addr[0] << 24) | (addr[1] << 16) | (addr[2] << 8) | addr[3]; }
 
   private:
     PIPSocket::Address addr;
@@ -347,6 +383,7 @@ static PHostByAddr & pHostByAddr()
 
 PIPCacheData::PIPCacheData(struct hostent * host_info, const char * original)
   : address(PIPSocket::GetInvalidAddress())
+  , refreshFailed(false)
 {
   if (host_info == NULL)
     return;
@@ -385,6 +422,7 @@ PIPCacheData::PIPCacheData(struct hostent * host_info, const char * original)
 
 PIPCacheData::PIPCacheData(struct addrinfo * addr_info, const char * original)
   : address(PIPSocket::GetInvalidAddress())
+  , refreshFailed(false)
 {
   PINDEX i;
   if (addr_info == NULL)
@@ -449,20 +487,32 @@ void PIPCacheData::AddEntry(struct addrinfo * addr_info)
 #endif // HAS_GETADDRINFO
 
 
+#if (defined(_WIN32) || defined(WINDOWS)) && !defined(__NUCLEUS_MNT__)
 static PTimeInterval GetConfigTime(const char * /*key*/, DWORD dflt)
 {
   //PConfig cfg("DNS Cache");
   //return cfg.GetInteger(key, dflt);
   return dflt;
 }
+#endif
+
+
+PTimeInterval PIPCacheData::GetTimeout() const
+{
+  return address.IsValid() ? g_nameCacheFoundTimeout : g_nameCacheNotFoundTimeout;
+}
 
 
 PBoolean PIPCacheData::HasAged() const
 {
-  static PTimeInterval retirement = GetConfigTime("Age Limit", 300000); // 5 minutes
-  PTime now;
-  PTimeInterval age = now - birthDate;
-  return age > retirement;
+  return birthDate.GetElapsed() > GetTimeout();
+}
+
+
+bool PIPCacheData::NeedsRefresh() const
+{
+  // Only good entries are refreshed early, in the last tenth of their life, and only once
+  return address.IsValid() && !refreshFailed && birthDate.GetElapsed()*10 > GetTimeout()*9;
 }
 
 
@@ -506,11 +556,41 @@ PBoolean PHostByName::GetHostAliases(const PString & name, PStringArray & aliase
 }
 
 
-PIPCacheData * PHostByName::GetHost(const PString & name)
+bool PHostByName::GetHostAddressAsync(const PString & name, const PIPSocket::HostAddressNotifier & notifier)
 {
+  PIPSocket::Address address = PIPSocket::GetInvalidAddress();
+
   mutex.Wait();
 
-  PString key = name;
+  PString key;
+  if (MakeKey(name, key)) {
+    PIPCacheData * host = GetAt(key);
+    if (host == NULL || host->HasAged()) {
+      // Join the query in progress, or start one, and get told when it is done
+      LookupMap::iterator it = m_lookups.find(key);
+      Lookup * lookup = it != m_lookups.end() ? it->second : StartLookup(name, key, true);
+      lookup->m_notifiers.push_back(notifier);
+      mutex.Signal();
+      return false;
+    }
+
+    if (host->NeedsRefresh() && m_lookups.find(key) == m_lookups.end())
+      StartLookup(name, key, true);
+
+    address = host->GetHostAddress();
+  }
+
+  mutex.Signal();
+
+  PString hostname = name;
+  notifier(hostname, address);
+  return true;
+}
+
+
+bool PHostByName::MakeKey(const PString & name, PString & key) const
+{
+  key = name;
   PINDEX len = key.GetLength();
 
   // Check for a legal hostname as per RFC952
@@ -519,7 +599,7 @@ PIPCacheData * PHostByName::GetHost(const PString & name)
       key.FindSpan("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-.") != P_MAX_INDEX ||
       key[len-1] == '-') {
     PTRACE_IF(3, key[0] != '[', "Illegal RFC952 characters in DNS name \"" << key << '"');
-    return NULL;
+    return false;
   }
 
   // We lowercase this way rather than toupper() as that is locale dependent, and DNS names aren't.
@@ -528,110 +608,215 @@ PIPCacheData * PHostByName::GetHost(const PString & name)
       key[i] &= 0x5f;
   }
 
+  return true;
+}
+
+
+PIPCacheData * PHostByName::GetHost(const PString & name)
+{
+  mutex.Wait();
+
+  PString key;
+  if (!MakeKey(name, key))
+    return NULL;
+
   PIPCacheData * host = GetAt(key);
-  int localErrNo = NO_DATA;
+  if (host != NULL && !host->HasAged()) {
+    // Still good, but if nearly expired get a fresh copy without blocking the caller
+    if (host->NeedsRefresh() && m_lookups.find(key) == m_lookups.end())
+      StartLookup(name, key, true);
+  }
+  else {
+    LookupMap::iterator it = m_lookups.find(key);
+    if (it == m_lookups.end()) {
+      StartLookup(name, key, false);
+      host = CompleteLookup(name, key);
+    }
+    else {
+      // Another thread is already asking, wait for its answer
+      Lookup * lookup = it->second;
+      ++lookup->m_waiters;
+      mutex.Signal();
+      lookup->m_done.Wait();
+      mutex.Wait();
+
+      // Wake the next waiter, the last one out cleans up
+      if (--lookup->m_waiters > 0)
+        lookup->m_done.Signal();
+      else
+        delete lookup;
+
+      host = GetAt(key);
+    }
 
-  if (host != NULL && host->HasAged()) {
-    SetAt(key, NULL);
-    host = NULL;
+    if (host == NULL)
+      return NULL; // Cache was cleared while we were waiting
   }
 
-  if (host == NULL) {
-    mutex.Signal();
+  return host->GetHostAddress().IsValid() ? host : NULL;
+}
+
+
+PHostByName::Lookup * PHostByName::StartLookup(const PString & name, const PString & key, bool background)
+{
+  Lookup * lookup = new Lookup;
+  m_lookups[key] = lookup;
+
+  if (background)
+    new PThreadObj1Arg<PHostByName, PString>(*this, name, &PHostByName::BackgroundLookup, true, "DNS Lookup");
+
+  return lookup;
+}
+
+
+void PHostByName::BackgroundLookup(PString name)
+{
+  PString key;
+  MakeKey(name, key);
+
+  mutex.Wait();
+  CompleteLookup(name, key);
+  mutex.Signal();
+}
+
+
+static PIPCacheData * QueryHostByName(const PString & name)
+{
+  PIPCacheData * host;
+  int localErrNo = NO_DATA;
 
 #if HAS_GETADDRINFO
 
-    struct addrinfo *res = NULL;
-    struct addrinfo hints;
-    memset(&hints, 0, sizeof(hints));
-    if (!g_suppressCanonicalName)
-      hints.ai_flags = AI_CANONNAME;
-    hints.ai_family = g_defaultIpAddressFamily;
+  struct addrinfo *res = NULL;
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  if (!g_suppressCanonicalName)
+    hints.ai_flags = AI_CANONNAME;
+  hints.ai_family = g_defaultIpAddressFamily;
+  localErrNo = getaddrinfo((const char *)name, NULL , &hints, &res);
+  if (localErrNo != 0) {
+    hints.ai_family = g_defaultIpAddressFamily == AF_INET6 ? AF_INET : AF_INET6;
     localErrNo = getaddrinfo((const char *)name, NULL , &hints, &res);
-    if (localErrNo != 0) {
-      hints.ai_family = g_defaultIpAddressFamily == AF_INET6 ? AF_INET : AF_INET6;
-      localErrNo = getaddrinfo((const char *)name, NULL , &hints, &res);
-    }
-    host = new PIPCacheData(localErrNo != NETDB_SUCCESS ? NULL : res, name);
-    if (res != NULL)
-      freeaddrinfo(res);
+  }
+  host = new PIPCacheData(localErrNo != NETDB_SUCCESS ? NULL : res, name);
+  if (res != NULL)
+    freeaddrinfo(res);
 
 #else // HAS_GETADDRINFO
 
-    int retry = 3;
-    struct hostent * host_info;
+  int retry = 3;
+  struct hostent * host_info;
 
 #ifdef P_AIX
 
-    struct hostent_data ht_data;
-    memset(&ht_data, 0, sizeof(ht_data));
-    struct hostent hostEnt;
-    do {
-      host_info = &hostEnt;
-      ::gethostbyname_r(name,
-                        host_info,
-                        &ht_data);
-      localErrNo = h_errno;
-    } while (localErrNo == TRY_AGAIN && --retry > 0);
+  struct hostent_data ht_data;
+  memset(&ht_data, 0, sizeof(ht_data));
+  struct hostent hostEnt;
+  do {
+    host_info = &hostEnt;
+    ::gethostbyname_r(name,
+                      host_info,
+                      &ht_data);
+    localErrNo = h_errno;
+  } while (localErrNo == TRY_AGAIN && --retry > 0);
 
 #elif defined(P_RTEMS) || defined(P_CYGWIN) || defined(P_MINGW)
 
-    host_info = ::gethostbyname(name);
-    localErrNo = h_errno;
+  host_info = ::gethostbyname(name);
+  localErrNo = h_errno;
 
 #elif defined P_VXWORKS
 
-    struct hostent hostEnt;
-    host_info = Vx_gethostbyname((char *)name, &hostEnt);
-    localErrNo = h_errno;
+  struct hostent hostEnt;
+  host_info = Vx_gethostbyname((char *)name, &hostEnt);
+  localErrNo = h_errno;
 
 #elif defined P_LINUX || defined(P_GNU_HURD) || defined(P_ANDROID)
 
-    char buffer[REENTRANT_BUFFER_LEN];
-    struct hostent hostEnt;
-    do {
-      if (::gethostbyname_r(name,
-                            &hostEnt,
-                            buffer, REENTRANT_BUFFER_LEN,
-                            &host_info,
-                            &localErrNo) == 0)
-        localErrNo = NETDB_SUCCESS;
-    } while (localErrNo == TRY_AGAIN && --retry > 0);
+  char buffer[REENTRANT_BUFFER_LEN];
+  struct hostent hostEnt;
+  do {
+    if (::gethostbyname_r(name,
+                          &hostEnt,
+                          buffer, REENTRANT_BUFFER_LEN,
+                          &host_info,
+                          &localErrNo) == 0)
+      localErrNo = NETDB_SUCCESS;
+  } while (localErrNo == TRY_AGAIN && --retry > 0);
 
 #elif (defined(P_PTHREADS) && !defined(P_THREAD_SAFE_LIBC)) || defined(__NUCLEUS_PLUS__)
 
-    char buffer[REENTRANT_BUFFER_LEN];
-    struct hostent hostEnt;
-    do {
-      host_info = ::gethostbyname_r(name,
-                                    &hostEnt,
-                                    buffer, REENTRANT_BUFFER_LEN,
-                                    &localErrNo);
-    } while (localErrNo == TRY_AGAIN && --retry > 0);
+  char buffer[REENTRANT_BUFFER_LEN];
+  struct hostent hostEnt;
+  do {
+    host_info = ::gethostbyname_r(name,
+                                  &hostEnt,
+                                  buffer, REENTRANT_BUFFER_LEN,
+                                  &localErrNo);
+  } while (localErrNo == TRY_AGAIN && --retry > 0);
 
 #else
 
-    host_info = ::gethostbyname(name);
-    localErrNo = h_errno;
+  host_info = ::gethostbyname(name);
+  localErrNo = h_errno;
 
 #endif
 
-    if (localErrNo != NETDB_SUCCESS || retry == 0)
-      host_info = NULL;
-    host = new PIPCacheData(host_info, name);
+  if (localErrNo != NETDB_SUCCESS || retry == 0)
+    host_info = NULL;
+  host = new PIPCacheData(host_info, name);
 
 #endif //HAS_GETADDRINFO
 
-    mutex.Wait();
+  PTRACE_IF(4, !host->GetHostAddress().IsValid(), "Name lookup of \"" << name << "\" failed: errno=" << localErrNo);
+  return host;
+}
 
-    SetAt(key, host);
+
+PIPCacheData * PHostByName::CompleteLookup(const PString & name, const PString & key)
+{
+  // Called with mutex locked, and a Lookup for key already in m_lookups
+  mutex.Signal();
+  PIPCacheData * host = QueryHostByName(name);
+  mutex.Wait();
+
+  // A failed early refresh keeps the good entry until it has really aged
+  PIPCacheData * existing = GetAt(key);
+  if (!host->GetHostAddress().IsValid() && existing != NULL &&
+       existing->GetHostAddress().IsValid() && !existing->HasAged()) {
+    PTRACE(3, "Refresh of \"" << name << "\" failed, keeping cached " << existing->GetHostAddress());
+    delete host;
+    host = existing;
+    host->SetRefreshFailed();
   }
+  else
+    SetAt(key, host);
 
-  if (host->GetHostAddress().IsValid())
+  LookupMap::iterator it = m_lookups.find(key);
+  Lookup * lookup = it->second;
+  m_lookups.erase(it);
+
+  std::vector<PIPSocket::HostAddressNotifier> notifiers;
+  notifiers.swap(lookup->m_notifiers);
+
+  if (lookup->m_waiters > 0)
+    lookup->m_done.Signal();
+  else
+    delete lookup;
+
+  if (notifiers.empty())
     return host;
 
-  PTRACE(4, "Name lookup of \"" << name << "\" failed: errno=" << localErrNo);
-  return NULL;
+  PIPSocket::Address address = host->GetHostAddress();
+  PString hostname = name;
+
+  mutex.Signal();
+  for (size_t i = 0; i < notifiers.size(); ++i)
+    notifiers[i](hostname, address);
+  mutex.Wait();
+
+  // May have changed while unlocked
+  return GetAt(key);
 }
 
 
@@ -1007,6 +1192,276 @@ PChannel::Errors PSocket::Select(SelectList & read,
 }
 
 
+//////////////////////////////////////////////////////////////////////////////
+// PSocketReactor
+
+PSocketReactor::PSocketReactor()
+  : m_thread(NULL)
+  , m_running(false)
+  , m_interrupted(false)
+#if P_HAS_EPOLL
+  , m_epoll(::epoll_create1(EPOLL_CLOEXEC))
+#endif
+{
+#if P_HAS_EPOLL
+  if (::pipe(m_interruptPipe) < 0)
+    m_interruptPipe[0] = m_interruptPipe[1] = -1;
+  else {
+    ::fcntl(m_interruptPipe[0], F_SETFL, O_NONBLOCK);
+    ::fcntl(m_interruptPipe[1], F_SETFL, O_NONBLOCK);
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = m_interruptPipe[0];
+    ::epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_interruptPipe[0], &ev);
+  }
+  PTRACE_IF(1, m_epoll < 0 || m_interruptPipe[0] < 0, "Could not create epoll reactor: errno=" << errno);
+#endif
+}
+
+
+PSocketReactor::~PSocketReactor()
+{
+  Stop();
+
+#if P_HAS_EPOLL
+  if (m_epoll >= 0)
+    ::close(m_epoll);
+  if (m_interruptPipe[0] >= 0) {
+    ::close(m_interruptPipe[0]);
+    ::close(m_interruptPipe[1]);
+  }
+#endif
+}
+
+
+bool PSocketReactor::Add(PSocket & socket, const Notifier & notifier)
+{
+  int handle = socket.GetHandle();
+  if (handle < 0)
+    return false;
+
+  PWaitAndSignal mutex(m_mutex);
+
+  EntryMap::iterator it = m_entries.find(handle);
+  if (it != m_entries.end()) {
+    if (it->second.m_socket == &socket) {
+      it->second.m_notifier = notifier;
+      return true;
+    }
+
+    /* A different socket was closed without being removed, and its handle
+       has been reused. Closing the handle usually drops it from epoll, so
+       it must be registered again. */
+    PTRACE(4, "Replacing stale reactor entry for handle " << handle);
+    m_entries.erase(it);
+  }
+
+#if P_HAS_EPOLL
+  struct epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.fd = handle;
+  if (::epoll_ctl(m_epoll, EPOLL_CTL_ADD, handle, &ev) < 0 &&
+        (errno != EEXIST || ::epoll_ctl(m_epoll, EPOLL_CTL_MOD, handle, &ev) < 0)) {
+    PTRACE(2, "Could not add " << socket << " to reactor: errno=" << errno);
+    return false;
+  }
+#endif
+
+  m_entries[handle] = Entry(&socket, notifier);
+  PTRACE(5, "Added " << socket << " to reactor, size=" << m_entries.size());
+
+#if !P_HAS_EPOLL
+  // Wake up wait so the new socket is included
+  Interrupt();
+#endif
+  return true;
+}
+
+
+bool PSocketReactor::Remove(PSocket & socket)
+{
+  PWaitAndSignal dispatch(m_dispatchMutex);
+  PWaitAndSignal mutex(m_mutex);
+
+  EntryMap::iterator it;
+  int handle = socket.GetHandle();
+  if (handle >= 0)
+    it = m_entries.find(handle);
+  else {
+    // Already closed, so the handle it was registered with is not known
+    for (it = m_entries.begin(); it != m_entries.end(); ++it) {
+      if (it->second.m_socket == &socket)
+        break;
+    }
+  }
+
+  if (it == m_entries.end() || it->second.m_socket != &socket)
+    return false;
+
+#if P_HAS_EPOLL
+  ::epoll_ctl(m_epoll, EPOLL_CTL_DEL, it->first, NULL);
+#endif
+  m_entries.erase(it);
+  PTRACE(5, "Removed " << socket << " from reactor, size=" << m_entries.size());
+  return true;
+}
+
+
+PINDEX PSocketReactor::GetSize() const
+{
+  PWaitAndSignal mutex(m_mutex);
+  return m_entries.size();
+}
+
+
+void PSocketReactor::InternalWait(std::vector<int> & handles, const PTimeInterval & timeout, PChannel::Errors & error)
+{
+  error = PChannel::NoError;
+
+#if P_HAS_EPOLL
+  static const int MaxEvents = 256;
+  struct epoll_event events[MaxEvents];
+
+  int count;
+  do {
+    PPROFILE_SYSTEM(
+      count = ::epoll_wait(m_epoll, events, MaxEvents, timeout == PMaxTimeInterval ? -1 : (int)timeout.GetMilliSeconds());
+    );
+  } while (count < 0 && errno == EINTR);
+
+  if (count < 0) {
+    PTRACE(2, "epoll_wait failed: errno=" << errno);
+    error = PChannel::Miscellaneous;
+    return;
+  }
+
+  for (int i = 0; i < count; ++i) {
+    int fd = events[i].data.fd;
+    if (fd == m_interruptPipe[0]) {
+      char buf[16];
+      while (::read(fd, buf, sizeof(buf)) > 0)
+        ;
+      error = PChannel::Interrupted;
+    }
+    else
+      handles.push_back(fd);
+  }
+#else
+  PSocket::SelectList read;
+  {
+    PWaitAndSignal mutex(m_mutex);
+    for (EntryMap::iterator it = m_entries.begin(); it != m_entries.end(); ++it)
+      read += *it->second.m_socket;
+  }
+
+  if (read.IsEmpty()) {
+    // Nothing to wait on, just wait for an Add() or Interrupt()
+    PTimeInterval delay = timeout;
+    if (delay > 100)
+      delay = 100;
+    PThread::Sleep(delay);
+  }
+  else {
+    /* Can't interrupt a select on an arbitrary thread, so wait in small
+       slices so new sockets and Interrupt() are noticed reasonably quickly. */
+    error = PSocket::Select(read, timeout < 100 ? timeout : PTimeInterval(100));
+    for (PSocket::SelectList::iterator it = read.begin(); it != read.end(); ++it)
+      handles.push_back(it->GetHandle());
+  }
+#endif
+
+  if (m_interrupted.exchange(false))
+    error = PChannel::Interrupted;
+}
+
+
+PChannel::Errors PSocketReactor::Select(PSocket::SelectList & ready, const PTimeInterval & timeout)
+{
+  std::vector<int> handles;
+  PChannel::Errors error;
+  InternalWait(handles, timeout, error);
+
+  PWaitAndSignal mutex(m_mutex);
+  for (std::vector<int>::iterator it = handles.begin(); it != handles.end(); ++it) {
+    EntryMap::iterator entry = m_entries.find(*it);
+    if (entry != m_entries.end() && entry->second.m_socket->GetHandle() == *it)
+      ready += *entry->second.m_socket;
+  }
+
+  return error;
+}
+
+
+PChannel::Errors PSocketReactor::Process(const PTimeInterval & timeout)
+{
+  std::vector<int> handles;
+  PChannel::Errors error;
+  InternalWait(handles, timeout, error);
+
+  PWaitAndSignal dispatch(m_dispatchMutex);
+  for (std::vector<int>::iterator it = handles.begin(); it != handles.end(); ++it) {
+    Entry entry;
+    {
+      PWaitAndSignal mutex(m_mutex);
+      EntryMap::iterator found = m_entries.find(*it);
+      if (found == m_entries.end() || found->second.m_socket->GetHandle() != *it)
+        continue; // Removed, or closed, while we were waiting
+      entry = found->second;
+    }
+
+    if (!entry.m_notifier.IsNULL())
+      entry.m_notifier(*this, *entry.m_socket);
+  }
+
+  return error;
+}
+
+
+void PSocketReactor::Interrupt()
+{
+  m_interrupted = true;
+#if P_HAS_EPOLL
+  static const char ch = 0;
+  PAssertOS(::write(m_interruptPipe[1], &ch, 1) == 1 || errno == EAGAIN);
+#endif
+}
+
+
+bool PSocketReactor::Start(const char * threadName, PThread::Priority priority)
+{
+  if (m_thread != NULL)
+    return true;
+
+  m_running = true;
+  m_thread = new PThreadObj<PSocketReactor>(*this, &PSocketReactor::ThreadMain, false, threadName, priority);
+  return true;
+}
+
+
+void PSocketReactor::Stop()
+{
+  if (m_thread == NULL)
+    return;
+
+  m_running = false;
+  Interrupt();
+  PAssert(m_thread->WaitForTermination(10000), "Socket reactor thread did not terminate");
+  delete m_thread;
+  m_thread = NULL;
+}
+
+
+void PSocketReactor::ThreadMain()
+{
+  PTRACE(4, "Socket reactor started");
+  while (m_running)
+    Process();
+  PTRACE(4, "Socket reactor stopped");
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+
 PBoolean PSocket::ConvertOSError(P_INT_PTR libcReturnValue, ErrorGroup group)
 {
   if (PChannel::ConvertOSError(libcReturnValue, group))
@@ -1153,6 +1608,18 @@ PBoolean PIPSocket::GetHostAddress(const PString & hostname, Address & addr)
 }
 
 
+bool PIPSocket::GetHostAddressAsync(const PString & hostname, const HostAddressNotifier & notifier)
+{
+  Address addr;
+  if (!hostname.IsEmpty() && !addr.FromString(hostname))
+    return pHostByName().GetHostAddressAsync(hostname, notifier);
+
+  PString name = hostname;
+  notifier(name, hostname.IsEmpty() ? GetInvalidAddress() : addr);
+  return true;
+}
+
+
 PStringArray PIPSocket::GetHostAliases(const PString & hostname)
 {
   PStringArray aliases;
@@ -2377,6 +2844,43 @@ void PTCPSocket::OnOutOfBand(const void *, PINDEX)
 }
 
 
+bool PTCPSocket::SendFile(PFile & file, off_t offset, off_t length)
+{
+  if (CheckNotOpen())
+    return false;
+
+  if (!file.IsOpen())
+    return SetErrorValues(NotOpen, EBADF, LastWriteError);
+
+  flush();
+
+#if P_HAS_SENDFILE
+  if (os_sendfile(file, offset, length))
+    return true;
+
+  // Some file systems do not support it, so fall back to copying
+  if (lastErrorNumber[LastWriteError] != EINVAL && lastErrorNumber[LastWriteError] != ENOSYS)
+    return false;
+
+  PTRACE(4, "Cannot use sendfile for " << file.GetFilePath() << ", copying instead");
+#endif
+
+  if (!file.SetPosition(offset))
+    return SetErrorValues(Miscellaneous, EINVAL, LastWriteError);
+
+  PBYTEArray buffer((PINDEX)PMIN(length, (off_t)65536));
+  while (length > 0) {
+    if (!file.Read(buffer.GetPointer(), (PINDEX)PMIN(length, (off_t)buffer.GetSize())) || file.GetLastReadCount() == 0)
+      return SetErrorValues(Miscellaneous, EIO, LastWriteError);
+    if (!Write(buffer, file.GetLastReadCount()))
+      return false;
+    length -= file.GetLastReadCount();
+  }
+
+  return true;
+}
+
+
 //////////////////////////////////////////////////////////////////////////////
 // PIPDatagramSocket
 
@@ -2425,13 +2929,15 @@ PBoolean PIPDatagramSocket::InternalReadFrom(Slice * slices, size_t sliceCount,
 
   PIPSocket::sockaddr_wrapper sa;
   socklen_t size = sa.GetSize();
-  if (!os_vread(slices, sliceCount, 0, sa, &size))
+  bool ok = os_vread(slices, sliceCount, 0, sa, &size);
+  if (!ok && GetErrorCode(LastReadError) != BufferTooSmall)
     return false;
 
+  // Truncated datagrams still have a sender
   ipAndPort.SetAddress(sa.GetIP());
   ipAndPort.SetPort(sa.GetPort());
 
-  return true;
+  return ok;
 }
 
 
@@ -2540,6 +3046,59 @@ PBoolean PIPDatagramSocket::InternalWriteTo(const Slice * slices, size_t sliceCo
 }
 
 
+#if !P_HAS_RECVMMSG
+
+bool PIPDatagramSocket::ReadFromMulti(Datagrams & datagrams)
+{
+  PINDEX count = 0;
+  PTimeInterval oldTimeout = readTimeout;
+
+  // First one waits, the rest only take what is already queued
+  while (count < (PINDEX)datagrams.size()) {
+    Datagram & datagram = datagrams[count];
+    datagram.m_data.MakeUnique();
+    Slice slice(datagram.m_data.GetPointer(), datagram.m_data.GetSize());
+    datagram.m_truncated = false;
+    if (!InternalReadFrom(&slice, 1, datagram.m_ipAndPort)) {
+      // A truncated datagram has still been taken off the socket
+      if (GetErrorCode(LastReadError) != BufferTooSmall)
+        break;
+      datagram.m_truncated = true;
+    }
+    datagram.m_length = lastReadCount;
+    ++count;
+    readTimeout = 0;
+  }
+
+  readTimeout = oldTimeout;
+  lastReadCount = count;
+
+  if (count == 0)
+    return false;
+
+  return SetErrorValues(NoError, 0, LastReadError);
+}
+
+
+bool PIPDatagramSocket::WriteToMulti(const Datagrams & datagrams)
+{
+  PINDEX count = 0;
+
+  while (count < (PINDEX)datagrams.size()) {
+    const Datagram & datagram = datagrams[count];
+    Slice slice((void *)(const BYTE *)datagram.m_data, datagram.m_length);
+    if (!InternalWriteTo(&slice, 1, datagram.m_ipAndPort))
+      break;
+    ++count;
+  }
+
+  lastWriteCount = count;
+  return count == (PINDEX)datagrams.size();
+}
+
+#endif // P_HAS_RECVMMSG
+
+
 //////////////////////////////////////////////////////////////////////////////
 // PUDPSocket
 
@@ -2648,6 +3207,16 @@ bool PUDPSocket::InternalReadFrom(Slice * slices, size_t sliceCount, PIPSocketAd
 }
 
 
+bool PUDPSocket::ReadFromMulti(Datagrams & datagrams)
+{
+  if (!PIPDatagramSocket::ReadFromMulti(datagrams))
+    return false;
+
+  InternalSetLastReceiveAddress(datagrams[lastReadCount-1].m_ipAndPort);
+  return true;
+}
+
+
 PBoolean PUDPSocket::Read(void * buf, PINDEX len)
 {
   PIPSocketAddressAndPort dummy;
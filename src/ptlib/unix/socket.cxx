@@ -52,6 +52,10 @@
 #include <sys/socket.h>
 #endif
 
+#if P_HAS_SENDFILE
+#include <sys/sendfile.h>
+#endif
+
 #ifdef HAVE_NET_IF_H
   #include <net/if.h>
 #endif
@@ -533,6 +537,114 @@ bool PSocket::os_vwrite(const Slice * slices, size_t sliceCount, int flags, stru
   return false;
 }
 
+
+#if P_HAS_RECVMMSG
+
+bool PIPDatagramSocket::ReadFromMulti(Datagrams & datagrams)
+{
+  lastReadCount = 0;
+
+  if (CheckNotOpen())
+    return false;
+
+  unsigned count = datagrams.size();
+  if (count == 0)
+    return SetErrorValues(BadParameter, EINVAL, LastReadError);
+
+  std::vector<mmsghdr> msgs(count);
+  std::vector<Slice> slices(count);
+  std::vector<sockaddr_storage> addrs(count);
+  memset(&msgs[0], 0, count*sizeof(mmsghdr));
+
+  for (unsigned i = 0; i < count; ++i) {
+    datagrams[i].m_data.MakeUnique(); // Copies of a Datagram share the buffer
+    slices[i].SetBase(datagrams[i].m_data.GetPointer());
+    slices[i].SetLength(datagrams[i].m_data.GetSize());
+    msgs[i].msg_hdr.msg_iov     = &slices[i];
+    msgs[i].msg_hdr.msg_iovlen  = 1;
+    msgs[i].msg_hdr.msg_name    = &addrs[i];
+    msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+  }
+
+  do {
+    // read as many packets as are queued, up to count
+    PPROFILE_SYSTEM(
+      int result = ::recvmmsg(os_handle, &msgs[0], count, 0, NULL);
+    );
+    if (ConvertOSError(result, LastReadError)) {
+      for (int i = 0; i < result; ++i) {
+        // Every entry has been taken off the socket, so keep going past a truncated one
+        datagrams[i].m_truncated = (msgs[i].msg_hdr.msg_flags&MSG_TRUNC) != 0;
+        PTRACE_IF(4, datagrams[i].m_truncated, "Truncated packet " << i << " in multiple read");
+        datagrams[i].m_length = msgs[i].msg_len;
+        datagrams[i].m_ipAndPort = PIPSocketAddressAndPort((sockaddr *)&addrs[i], msgs[i].msg_hdr.msg_namelen);
+        ++lastReadCount;
+      }
+      return lastReadCount > 0;
+    }
+  } while (lastErrorNumber[LastReadError] == EWOULDBLOCK && PXSetIOBlock(PXReadBlock, readTimeout));
+
+  return false;
+}
+
+
+bool PIPDatagramSocket::WriteToMulti(const Datagrams & datagrams)
+{
+  lastWriteCount = 0;
+
+  if (CheckNotOpen())
+    return false;
+
+  unsigned count = datagrams.size();
+  std::vector<mmsghdr> msgs(count);
+  std::vector<Slice> slices(count);
+  std::vector<sockaddr_storage> addrs(count);
+  if (count > 0)
+    memset(&msgs[0], 0, count*sizeof(mmsghdr));
+
+  for (unsigned i = 0; i < count; ++i) {
+    const Datagram & datagram = datagrams[i];
+    const Address & addr = datagram.m_ipAndPort.GetAddress();
+    if (!addr.IsValid() || datagram.m_ipAndPort.GetPort() == 0)
+      return SetErrorValues(BadParameter, EINVAL, LastWriteError);
+
+    if (addr.IsAny() || addr.IsBroadcast()) {
+      // Broadcast needs socket options changed per packet, do it the slow way
+      for (lastWriteCount = 0; lastWriteCount < (PINDEX)count; ++lastWriteCount) {
+        Slice slice((void *)(const BYTE *)datagrams[lastWriteCount].m_data, datagrams[lastWriteCount].m_length);
+        if (!InternalWriteTo(&slice, 1, datagrams[lastWriteCount].m_ipAndPort))
+          return false;
+      }
+      return true;
+    }
+
+    PIPSocket::sockaddr_wrapper sa(datagram.m_ipAndPort);
+    memcpy(&addrs[i], (sockaddr *)sa, sa.GetSize());
+
+    slices[i].SetBase((void *)(const BYTE *)datagram.m_data);
+    slices[i].SetLength(datagram.m_length);
+    msgs[i].msg_hdr.msg_iov     = &slices[i];
+    msgs[i].msg_hdr.msg_iovlen  = 1;
+    msgs[i].msg_hdr.msg_name    = &addrs[i];
+    msgs[i].msg_hdr.msg_namelen = sa.GetSize();
+  }
+
+  while (lastWriteCount < (PINDEX)count) {
+    // write the packets, kernel may not take them all in one go
+    PPROFILE_SYSTEM(
+      int result = ::sendmmsg(os_handle, &msgs[lastWriteCount], count - lastWriteCount, 0);
+    );
+    if (ConvertOSError(result, LastWriteError))
+      lastWriteCount += result;
+    else if (lastErrorNumber[LastWriteError] != EWOULDBLOCK || !PXSetIOBlock(PXWriteBlock, writeTimeout))
+      return false;
+  }
+
+  return true;
+}
+
+#endif // P_HAS_RECVMMSG
+
 #else // P_RECVMSG
 
 bool PSocket::os_vread(Slice * slices, size_t sliceCount, int flags, struct sockaddr * addr, socklen_t * addrlen)
@@ -631,6 +743,30 @@ PBoolean PTCPSocket::Read(void * buf, PINDEX maxLen)
 }
 
 
+#if P_HAS_SENDFILE
+
+bool PTCPSocket::os_sendfile(PFile & file, off_t & offset, off_t & length)
+{
+  while (length > 0) {
+    // Linux will not do more than about 2GB in one call
+    size_t count = (size_t)PMIN(length, (off_t)0x7ffff000);
+    PPROFILE_SYSTEM(
+      ssize_t result = ::sendfile(os_handle, file.GetHandle(), &offset, count);
+    );
+    if (result == 0)
+      return SetErrorValues(Miscellaneous, EIO, LastWriteError); // File got shorter
+    if (ConvertOSError(result, LastWriteError))
+      length -= result;
+    else if (lastErrorNumber[LastWriteError] != EWOULDBLOCK || !PXSetIOBlock(PXWriteBlock, writeTimeout))
+      return false;
+  }
+
+  return true;
+}
+
+#endif // P_HAS_SENDFILE
+
+
 PBoolean PSocket::Read(void * buf, PINDEX len)
 {
   if (os_handle < 0)